@@ -28,6 +28,7 @@
 #include <stdsc/stdsc_log.hpp>
 #include <stdsc/stdsc_state.hpp>
 #include <stdsc/stdsc_utility.hpp>
+#include <stdsc/stdsc_compression.hpp>
 
 #include <sses_share/sses_fhekey_container.hpp>
 #include <sses_share/sses_computation_param.hpp>
@@ -54,6 +55,9 @@ struct Option
     std::string gender;
     std::string meds;
     std::string sides;
+    std::string append_filepath;
+    bool compression = false;
+    bool print_stats = false;
 };
 
 struct CallbackParam
@@ -108,7 +112,7 @@ static void print_usage_and_exit(const char* progname)
 {
     printf(
         "Usage: %s [-i IP Address] [-p PORT] [-c FHE context setting file] [-k FHE key ID] "
-        "age gender list-of-query-medicines query-side-effects\n",
+        "[-a CSV file of records to append] [-z] [-s] age gender list-of-query-medicines query-side-effects\n",
         progname);
     exit(1);
 }
@@ -130,7 +134,7 @@ static void print_option(const Option& option)
 static void init(Option& option, int argc, char* argv[])
 {
     int opt;
-    while ((opt = getopt(argc, argv, "i:p:c:k:h")) != -1)
+    while ((opt = getopt(argc, argv, "i:p:c:k:a:zsh")) != -1)
     {
         switch (opt)
         {
@@ -146,6 +150,15 @@ static void init(Option& option, int argc, char* argv[])
             case 'k':
                 option.fhe_key_id = std::stoi(optarg);
                 break;
+            case 'a':
+                option.append_filepath = optarg;
+                break;
+            case 'z':
+                option.compression = true;
+                break;
+            case 's':
+                option.print_stats = true;
+                break;
             case 'h':
             default:
                 print_usage_and_exit(argv[0]);
@@ -184,6 +197,7 @@ static void exec(const Option& option)
     STDSC_LOG_INFO("Prepared encryption keys. (key_id:%d)", key_id);
 
     sses_client::Client client(option.hostname.c_str(), option.port.c_str(), context, pubkey, seckey);
+    client.set_compression(option.compression);
     client.connect();
     STDSC_LOG_INFO("Connected to %s:%s", option.hostname.c_str(), option.port.c_str());
 
@@ -191,6 +205,25 @@ static void exec(const Option& option)
                             keycont.filepath(key_id, sses_share::KeyKind_t::kKindContext),
                             keycont.filepath(key_id, sses_share::KeyKind_t::kKindPubKey));
 
+    if (!client.wait_db_ready(key_id)) {
+        STDSC_LOG_ERR("DB of the key could not be set up. (key_id:%d)", key_id);
+        return;
+    }
+
+    if (!option.append_filepath.empty()) {
+        auto result = client.append_records(option.append_filepath);
+        for (const auto id : result.conflict_ids) {
+            STDSC_LOG_ERR("Record ID already exists. (id:%d)", id);
+        }
+        if (!result.status) {
+            STDSC_LOG_ERR("Records could not be appended. (%s)",
+                          option.append_filepath.c_str());
+            return;
+        }
+        STDSC_LOG_INFO("Appended records: %lu. (skipped: %lu, keys: %lu)",
+                       result.num_applied, result.num_skipped, result.num_keys);
+    }
+
     auto mask = sses_share::sses_mask_compute_mask(option.age, option.gender);
 
     sses_share::EncData encmask(pubkey);
@@ -204,8 +237,19 @@ static void exec(const Option& option)
                       option.sides,
                       encmask,
                       callback_func, &callback_param);
+    STDSC_LOG_INFO("Estimated cost of query #%d: %lu records",
+                   queryID, client.estimated_cost(queryID));
 
     client.wait(queryID);
+
+    if (option.compression) {
+        STDSC_LOG_INFO("Compression: [%s]",
+                       stdsc::compression_stats().to_string().c_str());
+    }
+
+    if (option.print_stats) {
+        std::cout << client.server_stats();
+    }
 }
 
 int main(int argc, char* argv[])
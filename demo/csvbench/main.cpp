@@ -0,0 +1,217 @@
+/*
+ * Copyright 2020 Yamana Laboratory, Waseda University
+ * Supported by JST CREST Grant Number JPMJCR1503, Japan.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE‐2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdlib.h>
+#include <unistd.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <sses_share/sses_define.hpp>
+#include <sses_server/sses_server_csv_reader.hpp>
+
+/* Micro-benchmark of parsing the DB source CSV.
+ * Prints one CSV line per parser: parser,bytes,rows,sec,GB/s */
+
+struct Option
+{
+    std::string csv_filepath = SSES_DEFAULT_SERVER_DB_SRC_FILEAPATH;
+    uint32_t copies = 1;
+    uint32_t repeats = 3;
+};
+
+void init(Option& option, int argc, char* argv[])
+{
+    int opt;
+    opterr = 0;
+    while ((opt = getopt(argc, argv, "f:x:n:h")) != -1)
+    {
+        switch (opt)
+        {
+            case 'f':
+                option.csv_filepath = optarg;
+                break;
+            case 'x':
+                option.copies = std::max(1, std::stoi(optarg));
+                break;
+            case 'n':
+                option.repeats = std::max(1, std::stoi(optarg));
+                break;
+            case 'h':
+            default:
+                printf(
+                  "Usage: %s [-f CSV filepath] [-x Copies] [-n Repeats]\n",
+                  argv[0]);
+                exit(1);
+        }
+    }
+}
+
+/* header line followed by the rows repeated `copies` times */
+static std::string load_text(const std::string& filepath, const uint32_t copies)
+{
+    std::ifstream ifs(filepath, std::ios::binary);
+    if (!ifs)
+    {
+        throw std::runtime_error("Failed to open " + filepath);
+    }
+    std::stringstream ss;
+    ss << ifs.rdbuf();
+    auto src = ss.str();
+
+    auto pos = src.find('\n');
+    auto header = src.substr(0, pos + 1);
+    auto rows = (std::string::npos == pos) ? std::string() : src.substr(pos + 1);
+    if (!rows.empty() && '\n' != rows.back())
+    {
+        rows.push_back('\n');
+    }
+
+    std::string text = header;
+    text.reserve(header.size() + rows.size() * copies);
+    for (uint32_t i = 0; i < copies; ++i)
+    {
+        text += rows;
+    }
+    return text;
+}
+
+/* sums the integer columns so that the parse cannot be optimized out */
+static size_t parse_reader(sses_server::CsvReader& reader, int64_t& checksum)
+{
+    const size_t cols[] = {reader.column("id"), reader.column("medicine_id"),
+                           reader.column("symptom_id"), reader.column("age"),
+                           reader.column("gender")};
+    std::vector<sses_server::CsvReader::Field> fields;
+    size_t rows = 0;
+    while (reader.next(fields))
+    {
+        for (auto c : cols)
+        {
+            if (c < fields.size() && 0 < fields[c].size)
+            {
+                checksum += sses_server::CsvReader::to_int(fields[c]);
+            }
+        }
+        ++rows;
+    }
+    return rows;
+}
+
+/* getline and a string per field, as the DB setup used to parse */
+static size_t parse_getline(const std::string& text, int64_t& checksum)
+{
+    std::istringstream iss(text);
+    std::string line;
+    std::getline(iss, line);
+    const size_t cols[] = {0, 1, 2, 8, 9};
+    size_t rows = 0;
+    while (std::getline(iss, line))
+    {
+        std::vector<std::string> fields;
+        std::istringstream ls(line);
+        std::string field;
+        while (std::getline(ls, field, ','))
+        {
+            fields.push_back(field);
+        }
+        for (auto c : cols)
+        {
+            if (c < fields.size() && !fields[c].empty())
+            {
+                checksum += std::stoll(fields[c]);
+            }
+        }
+        ++rows;
+    }
+    return rows;
+}
+
+template <class Func>
+static void bench(const char* name, const size_t bytes, const uint32_t repeats,
+                  Func func)
+{
+    double best = 0;
+    size_t rows = 0;
+    int64_t checksum = 0;
+    for (uint32_t i = 0; i < repeats; ++i)
+    {
+        auto start = std::chrono::steady_clock::now();
+        rows = func(checksum);
+        std::chrono::duration<double> elapsed =
+          std::chrono::steady_clock::now() - start;
+        if (0 == i || elapsed.count() < best)
+        {
+            best = elapsed.count();
+        }
+    }
+    printf("%s,%lu,%lu,%.6f,%.3f\n", name, bytes, rows, best,
+           bytes / std::max(best, 1e-9) / 1e9);
+    if (0 == checksum)
+    {
+        fprintf(stderr, "%s: no integers were parsed\n", name);
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    Option option;
+    init(option, argc, argv);
+
+    try
+    {
+        const auto text = load_text(option.csv_filepath, option.copies);
+
+        // the file parser reads through the page cache like DB setup does
+        char tmp_filepath[] = "/tmp/csvbench_XXXXXX";
+        int fd = mkstemp(tmp_filepath);
+        if (fd < 0 || static_cast<ssize_t>(text.size())
+                        != ::write(fd, text.data(), text.size()))
+        {
+            throw std::runtime_error("Failed to write temporary CSV");
+        }
+        ::close(fd);
+
+        printf("parser,bytes,rows,sec,GB/s\n");
+        bench("CsvReader(file)", text.size(), option.repeats, [&](int64_t& sum) {
+            sses_server::CsvReader reader(tmp_filepath);
+            return parse_reader(reader, sum);
+        });
+        bench("CsvReader(text)", text.size(), option.repeats, [&](int64_t& sum) {
+            auto reader = sses_server::CsvReader::from_text(text);
+            return parse_reader(reader, sum);
+        });
+        bench("getline", text.size(), option.repeats, [&](int64_t& sum) {
+            return parse_getline(text, sum);
+        });
+
+        ::unlink(tmp_filepath);
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << "Err: " << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
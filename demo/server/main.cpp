@@ -24,6 +24,7 @@
 #include <stdsc/stdsc_callback_function_container.hpp>
 #include <stdsc/stdsc_exception.hpp>
 #include <stdsc/stdsc_log.hpp>
+#include <stdsc/stdsc_packet.hpp>
 #include <stdsc/stdsc_state.hpp>
 
 #include <sses_share/sses_define.hpp>
@@ -43,13 +44,17 @@ struct Option
     uint32_t max_results = SSES_DEFAULT_MAX_RESULTS;
     uint32_t max_result_lifetime_sec = SSES_DEFAULT_MAX_RESULT_LIFETIME_SEC;
     uint32_t num_threads = SSES_DEFAULT_NUM_THREADS;
+    size_t max_result_bytes = SSES_DEFAULT_MAX_RESULT_BYTES;
+    std::string result_spill_dir = SSES_DEFAULT_RESULT_SPILL_DIR;
+    uint64_t max_query_cost = SSES_DEFAULT_MAX_QUERY_COST;
+    size_t max_db_bytes = SSES_DEFAULT_MAX_DB_DISK_BYTES;
 };
 
 void init(Option& option, int argc, char* argv[])
 {
     int opt;
     opterr = 0;
-    while ((opt = getopt(argc, argv, "p:d:f:q:r:l:h")) != -1)
+    while ((opt = getopt(argc, argv, "p:d:f:q:r:l:t:m:s:c:b:h")) != -1)
     {
         switch (opt)
         {
@@ -74,11 +79,25 @@ void init(Option& option, int argc, char* argv[])
             case 't':
                 option.num_threads = std::stol(optarg);
                 break;
+            case 'm':
+                option.max_result_bytes = std::stoul(optarg) * 1024 * 1024;
+                break;
+            case 's':
+                option.result_spill_dir = optarg;
+                break;
+            case 'c':
+                option.max_query_cost = std::stoull(optarg);
+                break;
+            case 'b':
+                option.max_db_bytes = std::stoul(optarg) * 1024 * 1024;
+                break;
             case 'h':
             default:
                 printf(
                   "Usage: %s [-p PORT] [-q Max Queries] [-r max_results] [-l Max Result Lifetime] "
-                  "[-t NThreads] [-d DB direcotry] [-f DB of medical records (CSV file)]\n",
+                  "[-t NThreads] [-d DB direcotry] [-f DB of medical records (CSV file)] "
+                  "[-m Max Result Memory (MB)] [-s Result Spill directory] [-c Max Query Cost] "
+                  "[-b Max DB Disk (MB)]\n",
                   argv[0]);
                 exit(1);
         }
@@ -93,11 +112,11 @@ void exec(Option& option)
     {
         std::shared_ptr<stdsc::CallbackFunction> cb_enckeys(
           new sses_server::CallbackFunctionEncryptionKeys());
-        callback.set(sses_share::kControlCodeDataEncKeys, cb_enckeys);
+        callback.set(sses_share::kControlCodeStreamEncKeys, cb_enckeys);
 
         std::shared_ptr<stdsc::CallbackFunction> cb_query(
           new sses_server::CallbackFunctionQuery());
-        callback.set(sses_share::kControlCodeUpDownloadQuery, cb_query);
+        callback.set(sses_share::kControlCodeStreamQuery, cb_query);
 
         std::shared_ptr<stdsc::CallbackFunction> cb_pirres(
           new sses_server::CallbackFunctionChunkResultRequest());
@@ -110,6 +129,26 @@ void exec(Option& option)
         std::shared_ptr<stdsc::CallbackFunction> cb_cancelquery(
           new sses_server::CallbackFunctionCancelQuery());
         callback.set(sses_share::kControlCodeDataCancelQuery, cb_cancelquery);
+
+        std::shared_ptr<stdsc::CallbackFunction> cb_append(
+          new sses_server::CallbackFunctionAppendRecords());
+        callback.set(sses_share::kControlCodeUpDownloadAppendRecords, cb_append);
+
+        std::shared_ptr<stdsc::CallbackFunction> cb_querystatus(
+          new sses_server::CallbackFunctionQueryStatus());
+        callback.set(sses_share::kControlCodeUpDownloadQueryStatus, cb_querystatus);
+
+        std::shared_ptr<stdsc::CallbackFunction> cb_dbstatus(
+          new sses_server::CallbackFunctionDBStatus());
+        callback.set(sses_share::kControlCodeUpDownloadDBStatus, cb_dbstatus);
+
+        std::shared_ptr<stdsc::CallbackFunction> cb_stats(
+          new sses_server::CallbackFunctionStats());
+        callback.set(sses_share::kControlCodeDownloadStats, cb_stats);
+
+        std::shared_ptr<stdsc::CallbackFunction> cb_disconnect(
+          new sses_server::CallbackFunctionDisconnect());
+        callback.set(stdsc::kControlCodeDisConnected, cb_disconnect);
     }
     
     std::shared_ptr<sses_server::Server> server(new sses_server::Server(
@@ -121,7 +160,11 @@ void exec(Option& option)
       option.max_queries,
       option.max_results,
       option.max_result_lifetime_sec,
-      option.num_threads));
+      option.num_threads,
+      option.max_result_bytes,
+      option.result_spill_dir.c_str(),
+      option.max_query_cost,
+      option.max_db_bytes));
 
     server->start();
     server->wait();
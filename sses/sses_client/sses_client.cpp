@@ -15,9 +15,14 @@
  * limitations under the License.
  */
 
+#include <unistd.h>
+#include <chrono>
 #include <cstring>
 #include <fstream>
+#include <future>
 #include <memory>
+#include <mutex>
+#include <unordered_map>
 #include <vector>
 
 #include <stdsc/stdsc_buffer.hpp>
@@ -31,10 +36,9 @@
 #include <sses_share/sses_srv2cliparam.hpp>
 #include <sses_share/sses_plaindata.hpp>
 #include <sses_share/sses_packet.hpp>
-#include <sses_share/sses_fhe_utility.hpp>
 #include <sses_share/sses_encdata.hpp>
 #include <sses_client/sses_client.hpp>
-#include <sses_client/sses_client_result_thread.hpp>
+#include <sses_client/sses_client_task_thread.hpp>
 #include <sses_client/sses_client_record.hpp>
 
 //#define ENABLE_LOCAL_DEBUG
@@ -45,10 +49,20 @@
 namespace sses_client
 {
 
-struct ResultCallback
+/**
+ * Query whose results are received in background. Passed from the I/O
+ * thread to the decrypt pool and back as the results are processed.
+ */
+struct AsyncQuery
 {
-    std::shared_ptr<ResultThread> thread;
-    ResultThreadParam param;
+    int32_t query_id;
+    int32_t key_id;
+    stdsc::Buffer rbuffer; ///< encrypted results of chunks
+    std::vector<std::pair<int, int>> matches;
+    QueryResult result;
+    std::promise<QueryResult> promise;
+    cbfunc_t cbfunc;
+    void* cbargs;
 };
 
 struct Client::Impl
@@ -62,8 +76,14 @@ struct Client::Impl
           context_(context),
           pubkey_(pubkey),
           seckey_(seckey),
-          client_()
+          client_(),
+          num_decrypt_threads_(SSES_DEFAULT_CLIENT_DECRYPT_THREADS),
+          poll_interval_usec_(SSES_DEFAULT_CLIENT_POLL_INTERVAL_USEC),
+          polling_(false)
     {
+        // bulk payloads bypass the socket if the server is on this host
+        // ("unix:<path>" endpoint), no effect otherwise
+        client_.set_shared_memory(true);
     }
 
     ~Impl(void)
@@ -78,9 +98,15 @@ struct Client::Impl
 
     void disconnect(void)
     {
+        stop_threads();
         client_.close();
     }
 
+    void set_compression(const bool enable)
+    {
+        client_.set_compression(enable ? stdsc::kCodecZlib : stdsc::kCodecNone);
+    }
+
     void register_enckeys(const int32_t key_id,
                           const std::string& context_filepath,
                           const std::string& pubkey_filepath)
@@ -94,26 +120,76 @@ struct Client::Impl
         c2s_param.pubkey_stream_sz = sses_share::utility::file_size(pubkey_filepath);
         splaindata.push(c2s_param);
 
-        auto sz = (splaindata.stream_size()
-                   + c2s_param.context_stream_sz
-                   + c2s_param.pubkey_stream_sz);
-        stdsc::BufferStream sbuffstream(sz);
+        stdsc::BufferStream sbuffstream(splaindata.stream_size());
         std::iostream stream(&sbuffstream);
-
         splaindata.save(stream);
-        sses_share::fhe_utility::write_to_binary_stream(
-            stream, sbuffstream.data(), context_filepath);
-        sses_share::fhe_utility::write_to_binary_stream(
-            stream, sbuffstream.data(), pubkey_filepath);
 
+        // key files are sent from disk as they are
         stdsc::Buffer* sbuffer = &sbuffstream;
-        client_.send_data_blocking(sses_share::kControlCodeDataEncKeys, *sbuffer);
+        client_.send_stream_blocking(sses_share::kControlCodeStreamEncKeys, *sbuffer,
+                                     {context_filepath, pubkey_filepath});
 
         STDSC_LOG_INFO("Finish encryption key registration. "
                        "[keyID:%d, context_sz:%ld, pubkey_sz:%ld]",
                        key_id, c2s_param.context_stream_sz, c2s_param.pubkey_stream_sz);
     }
     
+    bool wait_db_ready(const int32_t key_id, const uint32_t timeout_sec,
+                       const uint32_t retry_interval_usec)
+    {
+        STDSC_LOG_INFO("Start waiting for DB. [keyID:%d]", key_id);
+
+        sses_share::PlainData<sses_share::C2SDBStatusParam> splaindata;
+        sses_share::C2SDBStatusParam c2s_param;
+        c2s_param.key_id = key_id;
+        splaindata.push(c2s_param);
+
+        auto sz = splaindata.stream_size();
+        stdsc::BufferStream sbuffstream(sz);
+        std::iostream stream(&sbuffstream);
+
+        splaindata.save(stream);
+
+        const auto deadline =
+            std::chrono::steady_clock::now() + std::chrono::seconds(timeout_sec);
+        while (true)
+        {
+            stdsc::Buffer* sbuffer = &sbuffstream;
+            stdsc::Buffer rbuffer;
+            client_.send_recv_data_blocking(
+              sses_share::kControlCodeUpDownloadDBStatus, *sbuffer, rbuffer);
+
+            stdsc::BufferStream rbuffstream(rbuffer);
+            std::iostream rstream(&rbuffstream);
+            sses_share::PlainData<sses_share::S2CDBStatusParam> rplaindata;
+            rplaindata.load(rstream);
+            const auto& param = rplaindata.data();
+
+            if (param.status == sses_share::kDBStatusReady) {
+                break;
+            }
+            if (param.status != sses_share::kDBStatusPending &&
+                param.status != sses_share::kDBStatusBuilding) {
+                STDSC_LOG_WARN("DB is not set up. [keyID:%d, status:%d]",
+                               key_id, param.status);
+                return false;
+            }
+
+            if (deadline <= std::chrono::steady_clock::now()) {
+                STDSC_LOG_WARN("Timed out waiting for DB. [keyID:%d, status:%d, progress:%u%%]",
+                               key_id, param.status, param.progress);
+                return false;
+            }
+
+            STDSC_LOG_INFO("Waiting for DB. [keyID:%d, status:%d, progress:%u%%]",
+                           key_id, param.status, param.progress);
+            usleep(retry_interval_usec);
+        }
+
+        STDSC_LOG_INFO("Finish waiting for DB. [keyID:%d]", key_id);
+        return true;
+    }
+
     int32_t send_query(const int32_t key_id,
                        const size_t age,
                        const std::string& gender,
@@ -126,43 +202,56 @@ struct Client::Impl
 
         sses_share::ComputationParam param;
         param.age = age;
-        std::strncpy(param.gender, gender.c_str(), SSES_DEFAULT_SIZE_OF_STR_FOR_TRANSDATA);
-        std::strncpy(param.meds, meds.c_str(), SSES_DEFAULT_SIZE_OF_STR_FOR_TRANSDATA);
-        std::strncpy(param.sides, sides.c_str(), SSES_DEFAULT_SIZE_OF_STR_FOR_TRANSDATA);
-        
+        param.gender = gender;
+        param.med_ids = sses_share::ComputationParam::parse_ids(meds);
+        param.side_ids = sses_share::ComputationParam::parse_ids(sides);
 
-        STDSC_LOG_INFO("Setup param for Query. [age:%lu, gender:%s, meds:%s, sides:%s]",
-                        param.age,
-                        param.gender,
-                        param.meds,
-                        param.sides);
+        STDSC_LOG_INFO("Setup param for Query. [%s]", param.to_string().c_str());
         
         sses_share::PlainData<sses_share::C2SQueryParam> splaindata;
         sses_share::C2SQueryParam c2s_param;
-        c2s_param.comp_param = param;
+        c2s_param.comp_param_stream_sz = sses_share::encoded_size(param);
         c2s_param.key_id = key_id;
         c2s_param.encdata_stream_sz = encdata.stream_size();
         splaindata.push(c2s_param);
     
-        auto sz = splaindata.stream_size() + c2s_param.encdata_stream_sz;
+        auto sz = splaindata.stream_size() + c2s_param.comp_param_stream_sz
+            + c2s_param.encdata_stream_sz;
         stdsc::BufferStream sbuffstream(sz);
         std::iostream stream(&sbuffstream);
     
         splaindata.save(stream);
+        std::vector<char> comp_param_buff(c2s_param.comp_param_stream_sz);
+        sses_share::encode(param, comp_param_buff.data());
+        stream.write(comp_param_buff.data(), comp_param_buff.size());
         encdata.save(stream);
     
+        // the server decodes the ciphertexts following the head as they arrive
+        auto head_sz = splaindata.stream_size() + c2s_param.comp_param_stream_sz;
         stdsc::Buffer* sbuffer = &sbuffstream;
         stdsc::Buffer rbuffer;
-        client_.send_recv_data_blocking(
-          sses_share::kControlCodeUpDownloadQuery, *sbuffer, rbuffer);
+        client_.send_recv_stream_blocking(
+          sses_share::kControlCodeStreamQuery, *sbuffer, head_sz, rbuffer);
     
         stdsc::BufferStream rbuffstream(rbuffer);
         std::iostream rstream(&rbuffstream);
-        sses_share::PlainData<int32_t> rplaindata;
+        sses_share::PlainData<sses_share::S2CQueryAckParam> rplaindata;
         rplaindata.load(rstream);
+        const auto& ack = rplaindata.data();
 
-        STDSC_LOG_INFO("Finish sending query.");
-        return rplaindata.data();
+        if (ack.query_id < 0) {
+            STDSC_LOG_WARN("Query was rejected by server. [estimated cost:%lu, DB status:%d]",
+                           ack.estimated_cost, ack.db_status);
+        }
+        else
+        {
+            std::lock_guard<std::mutex> lock(mtx_);
+            costmap_[ack.query_id] = ack.estimated_cost;
+        }
+
+        STDSC_LOG_INFO("Finish sending query. [queryID:%d, estimated cost:%lu]",
+                       ack.query_id, ack.estimated_cost);
+        return ack.query_id;
     }
     
     void recv_results(const int32_t query_id, bool& status, std::vector<Record>& records)
@@ -171,9 +260,31 @@ struct Client::Impl
 
         STDSC_LOG_INFO("Start subscribing to the results of each chunk.");
 
+        stdsc::Buffer rbuffer;
+        sses_share::S2CChunkResultParam s2c_param;
+        recv_chunk_results(query_id, true, rbuffer, s2c_param);
+
+        status = (s2c_param.status == sses_share::kServerResultStatusSuccess);
+        if (status)
+        {
+            std::vector<std::pair<int, int>> matches;
+            decrypt_chunk_results(query_id, rbuffer, matches);
+            recv_records(query_id, s2c_param.key_id, matches, records);
+        } else {
+            STDSC_LOG_WARN("The status of result for queryID %d is NOT success.", query_id);
+        }
+    }
+
+    /* request the encrypted results of each chunk. if not wait, the status
+       is kServerResultStatusPending while the query is computed */
+    void recv_chunk_results(const int32_t query_id, const bool wait,
+                            stdsc::Buffer& rbuffer,
+                            sses_share::S2CChunkResultParam& s2c_param)
+    {
         sses_share::PlainData<sses_share::C2SChunkResreqParam> splaindata;
         sses_share::C2SChunkResreqParam c2s_param;
         c2s_param.query_id = query_id;
+        c2s_param.wait = wait ? 1 : 0;
         splaindata.push(c2s_param);
     
         auto sz = splaindata.stream_size();
@@ -183,7 +294,6 @@ struct Client::Impl
         splaindata.save(stream);
     
         stdsc::Buffer* sbuffer = &sbuffstream;
-        stdsc::Buffer rbuffer;
         client_.send_recv_data_blocking(
           sses_share::kControlCodeUpDownloadChunkResult, *sbuffer, rbuffer);
 
@@ -192,129 +302,511 @@ struct Client::Impl
     
         sses_share::PlainData<sses_share::S2CChunkResultParam> rplaindata;
         rplaindata.load(rstream);
-        auto& s2c_param = rplaindata.data();
+        s2c_param = rplaindata.data();
+
+        if (s2c_param.status != sses_share::kServerResultStatusPending)
+        {
+            STDSC_LOG_INFO("Received result of each chunk for queryID %d. [status:%d]",
+                           query_id, s2c_param.status);
+        }
+    }
+
+    /* request the status of queries. kServerResultStatusPending while
+       each query is computed */
+    std::vector<sses_share::S2CQueryStatusParam>
+    recv_query_status(const std::vector<int32_t>& query_ids)
+    {
+        sses_share::PlainData<sses_share::C2SQueryStatusParam> splaindata;
+        for (const auto query_id : query_ids) {
+            sses_share::C2SQueryStatusParam c2s_param;
+            c2s_param.query_id = query_id;
+            splaindata.push(c2s_param);
+        }
+
+        auto sz = splaindata.stream_size();
+        stdsc::BufferStream sbuffstream(sz);
+        std::iostream stream(&sbuffstream);
+
+        splaindata.save(stream);
 
+        stdsc::Buffer* sbuffer = &sbuffstream;
+        stdsc::Buffer rbuffer;
+        client_.send_recv_data_blocking(
+          sses_share::kControlCodeUpDownloadQueryStatus, *sbuffer, rbuffer);
+
+        stdsc::BufferStream rbuffstream(rbuffer);
+        std::iostream rstream(&rbuffstream);
+
+        sses_share::PlainData<sses_share::S2CQueryStatusParam> rplaindata;
+        rplaindata.load(rstream);
+        return rplaindata.vdata();
+    }
+
+    /* decrypt the results of each chunk and find 0's inside */
+    void decrypt_chunk_results(const int32_t query_id, const stdsc::Buffer& rbuffer,
+                               std::vector<std::pair<int, int>>& ret) const
+    {
+        STDSC_LOG_INFO("Start proccesing result of each chunk for queryID %d.", query_id);
+
+        stdsc::BufferStream rbuffstream(rbuffer);
+        std::iostream rstream(&rbuffstream);
+
+        sses_share::PlainData<sses_share::S2CChunkResultParam> rplaindata;
+        rplaindata.load(rstream);
+
+        // encrypted results follow only if the query was completed
         sses_share::EncData enc_data(pubkey_);
         enc_data.load(rstream);
-        
-        STDSC_LOG_INFO("Received result of each chunk for queryID %d. [status:%d, Nresults:%lu]",
-                       query_id, s2c_param.status, enc_data.vdata().size());
-        
-        if (s2c_param.status == sses_share::kServerResultStatusSuccess)
-        {
-            STDSC_LOG_INFO("Start proccesing result of each chunk for queryID %d.", query_id);
             
-            auto& chunk_res = enc_data.vdata();
+        auto& chunk_res = enc_data.vdata();
 
 #ifdef ENABLE_LOCAL_DEBUG
-            STDSC_LOG_INFO("[DBG] Num of chunk_res (%lu) : ", chunk_res.size());
-            for (auto& ctxt : chunk_res) {
-                MYDBG_DECRYPT(ctxt);
-            }
+        STDSC_LOG_INFO("[DBG] Num of chunk_res (%lu) : ", chunk_res.size());
+        for (auto& ctxt : chunk_res) {
+            MYDBG_DECRYPT(ctxt);
+        }
 #endif
-            NTL::ZZX G = context_.alMod.getFactorsOverZZ()[0];
-            EncryptedArray ea(context_, G);
+        NTL::ZZX G = context_.alMod.getFactorsOverZZ()[0];
+        EncryptedArray ea(context_, G);
 
-            std::vector<std::pair<int, int>> ret;
-            for (size_t i = 0; i < chunk_res.size(); ++i)
-            {
-                std::vector<long> decrypted;
-                ea.decrypt(chunk_res[i], seckey_, decrypted);
+        for (size_t i = 0; i < chunk_res.size(); ++i)
+        {
+            std::vector<long> decrypted;
+            ea.decrypt(chunk_res[i], seckey_, decrypted);
 
 #ifdef ENABLE_LOCAL_DEBUG
-                printf("[DBG] Num of decrypted chunk_res (%lu) : ", decrypted.size());
-                for (size_t j=0; j<5; ++j) {
-                    printf("%ld ", decrypted[j]);
-                }
-                printf("\n");
+            printf("[DBG] Num of decrypted chunk_res (%lu) : ", decrypted.size());
+            for (size_t j=0; j<5; ++j) {
+                printf("%ld ", decrypted[j]);
+            }
+            printf("\n");
 #endif
 
-                for (size_t j = 0; j < decrypted.size(); ++j) {
-                    if (decrypted[j] == 0) {
-                        ret.push_back(std::make_pair(i, j));
-                    }
+            for (size_t j = 0; j < decrypted.size(); ++j) {
+                if (decrypted[j] == 0) {
+                    ret.push_back(std::make_pair(i, j));
                 }
             }
+        }
 
-            STDSC_LOG_INFO("Decrypt the result. find 0's inside. [N:%lu]", ret.size());
+        STDSC_LOG_INFO("Decrypt the result. find 0's inside. [N:%lu]", ret.size());
 
-            STDSC_LOG_INFO("Finish proccesing result of each chunk for queryID %d.", query_id);
+        STDSC_LOG_INFO("Finish proccesing result of each chunk for queryID %d.", query_id);
+    }
 
-            
-            STDSC_LOG_INFO("Start subscribing to the results.");            
+    /* request the records selected by the decrypted results */
+    void recv_records(const int32_t query_id, const int32_t key_id,
+                      const std::vector<std::pair<int, int>>& ret,
+                      std::vector<Record>& records)
+    {
+        STDSC_LOG_INFO("Start subscribing to the results.");            
 
-            sses_share::PlainData<sses_share::C2SResreqParam> splaindata_param;
-            sses_share::C2SResreqParam c2s_param;
-            c2s_param.query_id = query_id;
-            c2s_param.key_id = s2c_param.key_id;
-            splaindata_param.push(c2s_param);
+        sses_share::PlainData<sses_share::C2SResreqParam> splaindata_param;
+        sses_share::C2SResreqParam c2s_param;
+        c2s_param.query_id = query_id;
+        c2s_param.key_id = key_id;
+        splaindata_param.push(c2s_param);
             
-            sses_share::PlainData<sses_share::C2SSelectedInfo> splaindata_selinfo;
-            for (const auto& pair : ret) {
-                sses_share::C2SSelectedInfo c2s_selinfo;
-                c2s_selinfo.chunk_id = pair.first;
-                c2s_selinfo.pos_id = pair.second;
-                splaindata_selinfo.push(c2s_selinfo);
-            }
+        sses_share::PlainData<sses_share::C2SSelectedInfo> splaindata_selinfo;
+        for (const auto& pair : ret) {
+            sses_share::C2SSelectedInfo c2s_selinfo;
+            c2s_selinfo.chunk_id = pair.first;
+            c2s_selinfo.pos_id = pair.second;
+            splaindata_selinfo.push(c2s_selinfo);
+        }
 
 #ifdef ENABLE_LOCAL_DEBUG
-            printf("[DBG] selinfo (%lu) : ", splaindata_selinfo.vdata().size());
-            for (const auto& v : splaindata_selinfo.vdata()) {
-                printf("(%d,%d) ", v.chunk_id, v.pos_id);
-            }
-            printf("\n");
+        printf("[DBG] selinfo (%lu) : ", splaindata_selinfo.vdata().size());
+        for (const auto& v : splaindata_selinfo.vdata()) {
+            printf("(%d,%d) ", v.chunk_id, v.pos_id);
+        }
+        printf("\n");
 #endif
             
-            auto sz = splaindata_param.stream_size() + splaindata_selinfo.stream_size();
-            stdsc::BufferStream sbuffstream(sz);
-            std::iostream stream(&sbuffstream);
+        auto sz = splaindata_param.stream_size() + splaindata_selinfo.stream_size();
+        stdsc::BufferStream sbuffstream(sz);
+        std::iostream stream(&sbuffstream);
             
-            splaindata_param.save(stream);
-            splaindata_selinfo.save(stream);
+        splaindata_param.save(stream);
+        splaindata_selinfo.save(stream);
             
-            stdsc::Buffer* sbuffer = &sbuffstream;
-            stdsc::Buffer rbuffer;
-            client_.send_recv_data_blocking(
-                sses_share::kControlCodeUpDownloadResult, *sbuffer, rbuffer);
+        stdsc::Buffer* sbuffer = &sbuffstream;
+        stdsc::Buffer rbuffer;
+        client_.send_recv_data_blocking(
+            sses_share::kControlCodeUpDownloadResult, *sbuffer, rbuffer);
 
-            stdsc::BufferStream rbuffstream(rbuffer);
-            std::iostream rstream(&rbuffstream);
-    
-            sses_share::S2CResultParam s2c_param;
-            rstream >> s2c_param;
+        sses_share::S2CResultParam s2c_param;
+        sses_share::decode(rbuffer.data(), rbuffer.size(), s2c_param);
 
 #ifdef ENABLE_LOCAL_DEBUG
-            printf("[DBG] s2c_param:\n");
-            std::cout << s2c_param;
+        printf("[DBG] s2c_param:\n");
+        std::cout << s2c_param;
 #endif
             
-            for (size_t i=0; i<s2c_param.numRes; ++i) {
-                Record record;
-                record.id_ = s2c_param.recordIds[i];
-                
-                record.medicinIds_.resize(s2c_param.numMeds[i]);
-                record.symptomIds_.resize(s2c_param.numSides[i]);
-                
-                const auto& srcMed = s2c_param.medIds[i];
-                const auto& srcSide = s2c_param.sideIds[i];
-
-                std::copy(srcMed.begin(), srcMed.end(), record.medicinIds_.begin());
-                std::copy(srcSide.begin(), srcSide.end(), record.symptomIds_.begin());
-
-                records.push_back(record);
+        records.reserve(records.size() + s2c_param.numRes);
+        for (size_t i=0; i<s2c_param.numRes; ++i) {
+            Record record;
+            record.id_ = s2c_param.recordIds[i];
+            record.medicinIds_.swap(s2c_param.medIds[i]);
+            record.symptomIds_.swap(s2c_param.sideIds[i]);
+            records.push_back(std::move(record));
+        }
+    }
+
+    /* receive the results of query in background. the server is polled on
+       the I/O thread for all queries at once, results are decrypted in the
+       decrypt pool */
+    std::future<QueryResult> start_results(const int32_t query_id,
+                                           cbfunc_t cbfunc, void* cbargs)
+    {
+        auto q = std::make_shared<AsyncQuery>();
+        q->query_id = query_id;
+        q->key_id = -1;
+        q->result.query_id = query_id;
+        q->result.status = false;
+        q->cbfunc = cbfunc;
+        q->cbargs = cbargs;
+        auto future = q->promise.get_future();
+
+        if (query_id < 0)
+        {
+            // rejected by server, nothing to receive
+            complete(q);
+            return future;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mtx_);
+            queries_[query_id] = q;
+        }
+        start_threads();
+        ioque_.push([this, q] { watch(q); });
+        return future;
+    }
+
+    void set_callback(const int32_t query_id, cbfunc_t cbfunc, void* cbargs)
+    {
+        auto future = start_results(query_id, cbfunc, cbargs).share();
+        std::lock_guard<std::mutex> lock(mtx_);
+        if (future.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+        {
+            cbmap_[query_id] = future;
+        }
+    }
+
+    void wait(const int32_t query_id)
+    {
+        std::shared_future<QueryResult> future;
+        {
+            std::lock_guard<std::mutex> lock(mtx_);
+            auto it = cbmap_.find(query_id);
+            if (it == cbmap_.end())
+            {
+                return;
             }
-            
-        } else {
-            STDSC_LOG_WARN("The status of result for queryID %d is NOT success.", query_id);
+            future = it->second;
         }
+        future.get();
     }
 
-    void wait(const int32_t query_id) const
+    void set_decrypt_threads(const uint32_t num_threads)
     {
-        if (cbmap_.count(query_id))
+        std::lock_guard<std::mutex> lock(mtx_);
+        num_decrypt_threads_ = (num_threads > 0) ? num_threads : 1;
+    }
+
+    void cancel_query(const int32_t query_id)
+    {
+        STDSC_LOG_INFO("Start sending cancel query. [queryID: %d]", query_id);
+
+        sses_share::PlainData<sses_share::C2SCancelParam> splaindata;
+        sses_share::C2SCancelParam c2s_param;
+        c2s_param.query_id = query_id;
+        splaindata.push(c2s_param);
+
+        auto sz = splaindata.stream_size();
+        stdsc::BufferStream sbuffstream(sz);
+        std::iostream stream(&sbuffstream);
+
+        splaindata.save(stream);
+
+        stdsc::Buffer* sbuffer = &sbuffstream;
+        client_.send_data_blocking(sses_share::kControlCodeDataCancelQuery, *sbuffer);
+
+        STDSC_LOG_INFO("Finish sending cancel query. [queryID: %d]", query_id);
+    }
+
+    AppendResult append_records(const std::string& csv_filepath)
+    {
+        STDSC_LOG_INFO("Start sending records to append. [%s]", csv_filepath.c_str());
+
+        STDSC_THROW_FILE_IF_CHECK(sses_share::utility::file_exist(csv_filepath),
+                                  "Err: CSV file not found. (" + csv_filepath + ")");
+        std::ifstream ifs(csv_filepath, std::ios::binary);
+        std::string csv((std::istreambuf_iterator<char>(ifs)),
+                        std::istreambuf_iterator<char>());
+
+        sses_share::PlainData<sses_share::C2SAppendParam> splaindata;
+        sses_share::C2SAppendParam c2s_param;
+        c2s_param.csv_stream_sz = csv.size();
+        splaindata.push(c2s_param);
+
+        auto sz = splaindata.stream_size() + csv.size();
+        stdsc::BufferStream sbuffstream(sz);
+        std::iostream stream(&sbuffstream);
+
+        splaindata.save(stream);
+        stream.write(csv.data(), csv.size());
+
+        stdsc::Buffer* sbuffer = &sbuffstream;
+        stdsc::Buffer rbuffer;
+        client_.send_recv_data_blocking(
+          sses_share::kControlCodeUpDownloadAppendRecords, *sbuffer, rbuffer);
+
+        stdsc::BufferStream rbuffstream(rbuffer);
+        std::iostream rstream(&rbuffstream);
+        sses_share::PlainData<sses_share::S2CAppendResultParam> rplaindata;
+        rplaindata.load(rstream);
+        const auto& param = rplaindata.data();
+
+        AppendResult result;
+        result.status = param.status == sses_share::kServerResultStatusSuccess;
+        result.num_applied = param.num_applied;
+        result.num_skipped = param.num_skipped;
+        result.num_keys = param.num_keys;
+        if (param.num_conflicts > 0) {
+            sses_share::PlainData<int32_t> conflictdata;
+            conflictdata.load(rstream);
+            result.conflict_ids = conflictdata.vdata();
+        }
+
+        STDSC_LOG_INFO("Finish appending records. [bytes: %lu, status: %d, appended: %lu, skipped: %lu, keys: %lu, conflicts: %lu]",
+                       csv.size(), result.status, result.num_applied,
+                       result.num_skipped, result.num_keys, result.conflict_ids.size());
+        return result;
+    }
+
+    std::string server_stats()
+    {
+        stdsc::Buffer rbuffer;
+        client_.recv_data_blocking(sses_share::kControlCodeDownloadStats, rbuffer);
+        return std::string(static_cast<const char*>(rbuffer.data()), rbuffer.size());
+    }
+
+    uint64_t estimated_cost(const int32_t query_id) const
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        auto it = costmap_.find(query_id);
+        return (it != costmap_.end()) ? it->second : 0;
+    }
+
+private:
+    // I/O thread
+    void watch(std::shared_ptr<AsyncQuery> q)
+    {
+        pending_[q->query_id] = q;
+        if (!polling_)
+        {
+            polling_ = true;
+            poll();
+        }
+    }
+
+    // I/O thread. one request per interval asks for all pending queries
+    void poll(void)
+    {
+        std::vector<int32_t> query_ids;
+        for (const auto& p : pending_) {
+            query_ids.push_back(p.first);
+        }
+
+        std::vector<std::shared_ptr<AsyncQuery>> done;
+        try
+        {
+            for (const auto& s2c_param : recv_query_status(query_ids))
+            {
+                auto it = pending_.find(s2c_param.query_id);
+                if (it != pending_.end() &&
+                    s2c_param.status != sses_share::kServerResultStatusPending)
+                {
+                    done.push_back(it->second);
+                    pending_.erase(it);
+                }
+            }
+        }
+        catch (const std::exception& e)
+        {
+            for (auto& p : pending_) {
+                done.push_back(p.second);
+            }
+            pending_.clear();
+            polling_ = false;
+            for (auto& q : done) {
+                fail(q, e);
+            }
+            return;
+        }
+
+        for (auto& q : done) {
+            recv(q);
+        }
+
+        if (pending_.empty())
+        {
+            polling_ = false;
+            return;
+        }
+        ioque_.push([this] { poll(); }, poll_interval_usec_);
+    }
+
+    // I/O thread
+    void recv(std::shared_ptr<AsyncQuery> q)
+    {
+        try
+        {
+            sses_share::S2CChunkResultParam s2c_param;
+            recv_chunk_results(q->query_id, true, q->rbuffer, s2c_param);
+
+            if (s2c_param.status != sses_share::kServerResultStatusSuccess)
+            {
+                STDSC_LOG_WARN("The status of result for queryID %d is NOT success.",
+                               q->query_id);
+                complete(q);
+                return;
+            }
+
+            q->key_id = s2c_param.key_id;
+            workque_.push([this, q] { decrypt(q); });
+        }
+        catch (const std::exception& e)
+        {
+            fail(q, e);
+        }
+    }
+
+    // decrypt pool
+    void decrypt(std::shared_ptr<AsyncQuery> q)
+    {
+        try
+        {
+            decrypt_chunk_results(q->query_id, q->rbuffer, q->matches);
+            q->rbuffer = stdsc::Buffer();
+            ioque_.push([this, q] { fetch(q); });
+        }
+        catch (const std::exception& e)
+        {
+            fail(q, e);
+        }
+    }
+
+    // I/O thread
+    void fetch(std::shared_ptr<AsyncQuery> q)
+    {
+        try
+        {
+            recv_records(q->query_id, q->key_id, q->matches, q->result.records);
+            q->result.status = true;
+            workque_.push([this, q] { complete(q); });
+        }
+        catch (const std::exception& e)
+        {
+            fail(q, e);
+        }
+    }
+
+    void fail(std::shared_ptr<AsyncQuery> q, const std::exception& e)
+    {
+        STDSC_LOG_ERR("Failed to receive the results of queryID %d. [%s]",
+                      q->query_id, e.what());
+        q->result.status = false;
+        q->result.records.clear();
+        workque_.push([this, q] { complete(q); });
+    }
+
+    // decrypt pool, or the caller if the query was rejected
+    void complete(std::shared_ptr<AsyncQuery> q)
+    {
+        if (q->cbfunc)
+        {
+            STDSC_LOG_INFO("Invoke callback function for query #%d", q->query_id);
+            try
+            {
+                q->cbfunc(q->query_id, q->result.status, q->result.records,
+                          q->cbargs);
+            }
+            catch (const std::exception& e)
+            {
+                STDSC_LOG_ERR("An error occurred in the callback function. [%s]",
+                              e.what());
+            }
+        }
+
+        // wait() returns once the future is ready, so the callback finished
+        auto query_id = q->query_id;
+        q->promise.set_value(std::move(q->result));
+
+        std::lock_guard<std::mutex> lock(mtx_);
+        cbmap_.erase(query_id);
+        queries_.erase(query_id);
+    }
+
+    void start_threads(void)
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        if (!threads_.empty())
+        {
+            return;
+        }
+
+        STDSC_LOG_INFO("Start result threads. (decrypt threads:%u)",
+                       num_decrypt_threads_);
+        threads_.emplace_back(std::make_shared<TaskThread>(ioque_));
+        for (uint32_t i = 0; i < num_decrypt_threads_; ++i)
+        {
+            threads_.emplace_back(std::make_shared<TaskThread>(workque_));
+        }
+        for (auto& thread : threads_)
+        {
+            thread->start();
+        }
+    }
+
+    void stop_threads(void)
+    {
+        // tasks of outstanding queries are dropped
+        ioque_.close();
+        workque_.close();
+
+        std::vector<std::shared_ptr<TaskThread>> threads;
+        {
+            std::lock_guard<std::mutex> lock(mtx_);
+            threads.swap(threads_);
+        }
+        for (auto& thread : threads)
+        {
+            thread->wait();
+        }
+
+        // for the next connection
+        ioque_ = TaskQueue();
+        workque_ = TaskQueue();
+        pending_.clear();
+        polling_ = false;
+
+        // the queries are completed as failed, so that their futures and
+        // wait() return instead of throwing broken_promise
+        std::unordered_map<int32_t, std::shared_ptr<AsyncQuery>> queries;
+        {
+            std::lock_guard<std::mutex> lock(mtx_);
+            queries.swap(queries_);
+        }
+        for (auto& p : queries)
         {
-            auto& rcb = cbmap_.at(query_id);
-            rcb.thread->wait();
+            auto& q = p.second;
+            STDSC_LOG_WARN("Query is dropped by disconnection. [queryID:%d]", q->query_id);
+            q->result.status = false;
+            q->result.records.clear();
+            complete(q);
         }
     }
 
@@ -324,7 +816,17 @@ struct Client::Impl
     const FHEPubKey& pubkey_;
     const FHESecKey& seckey_;
     stdsc::Client client_;
-    std::unordered_map<int32_t, ResultCallback> cbmap_;
+    std::unordered_map<int32_t, std::shared_future<QueryResult>> cbmap_;
+    std::unordered_map<int32_t, uint64_t> costmap_;
+    TaskQueue ioque_;
+    TaskQueue workque_;
+    std::vector<std::shared_ptr<TaskThread>> threads_;
+    uint32_t num_decrypt_threads_;
+    uint32_t poll_interval_usec_;
+    std::unordered_map<int32_t, std::shared_ptr<AsyncQuery>> queries_; ///< not completed yet
+    std::unordered_map<int32_t, std::shared_ptr<AsyncQuery>> pending_; ///< polled (I/O thread only)
+    bool polling_;                                                     ///< I/O thread only
+    mutable std::mutex mtx_;
 };
 
 Client::Client(const char* host, const char* port,
@@ -342,6 +844,11 @@ void Client::connect(const uint32_t retry_interval_usec,
     pimpl_->connect(retry_interval_usec, timeout_sec);
 }
 
+void Client::set_compression(const bool enable) const
+{
+    pimpl_->set_compression(enable);
+}
+
 void Client::disconnect(void)
 {
     STDSC_LOG_INFO("Disconnect from server.");
@@ -355,6 +862,13 @@ void Client::register_enckeys(const int32_t key_id,
     pimpl_->register_enckeys(key_id, context_filepath, pubkey_filepath);
 }
 
+bool Client::wait_db_ready(const int32_t key_id,
+                           const uint32_t timeout_sec,
+                           const uint32_t retry_interval_usec) const
+{
+    return pimpl_->wait_db_ready(key_id, timeout_sec, retry_interval_usec);
+}
+
 int32_t Client::send_query(const int32_t key_id,
                            const size_t age,
                            const std::string& gender,
@@ -385,15 +899,41 @@ void Client::recv_results(const int32_t query_id, bool& status, std::vector<Reco
     pimpl_->recv_results(query_id, status, records);
 }
 
+std::future<QueryResult> Client::send_query_async(const int32_t key_id,
+                                                  const size_t age,
+                                                  const std::string& gender,
+                                                  const std::string& meds,
+                                                  const std::string& sides,
+                                                  const sses_share::EncData& encdata) const
+{
+    int32_t query_id = pimpl_->send_query(key_id, age, gender, meds, sides, encdata);
+    return pimpl_->start_results(query_id, nullptr, nullptr);
+}
+
+uint64_t Client::estimated_cost(const int32_t query_id) const
+{
+    return pimpl_->estimated_cost(query_id);
+}
+
+void Client::cancel_query(const int32_t query_id) const
+{
+    pimpl_->cancel_query(query_id);
+}
+
+AppendResult Client::append_records(const std::string& csv_filepath) const
+{
+    return pimpl_->append_records(csv_filepath);
+}
+
+std::string Client::server_stats() const
+{
+    return pimpl_->server_stats();
+}
+
 void Client::set_callback(const int32_t query_id, cbfunc_t func,
                           void* args) const
 {
-    ResultCallback rcb;
-    rcb.thread =
-        std::make_shared<ResultThread>(*this, pimpl_->pubkey_, func, args);
-    rcb.param = {query_id};
-    pimpl_->cbmap_[query_id] = rcb;
-    pimpl_->cbmap_[query_id].thread->start(pimpl_->cbmap_[query_id].param);
+    pimpl_->set_callback(query_id, func, args);
 }
 
 void Client::wait(const int32_t query_id) const
@@ -401,4 +941,9 @@ void Client::wait(const int32_t query_id) const
     pimpl_->wait(query_id);
 }
 
+void Client::set_decrypt_threads(const uint32_t num_threads) const
+{
+    pimpl_->set_decrypt_threads(num_threads);
+}
+
 } /* namespace sses_client */
@@ -18,8 +18,12 @@
 #ifndef SSES_CLIENT_HPP
 #define SSES_CLIENT_HPP
 
+#include <future>
 #include <memory>
+#include <string>
+#include <vector>
 #include <sses_share/sses_define.hpp>
+#include <sses_client/sses_client_record.hpp>
 #include <sses_client/sses_client_result_cbfunc.hpp>
 
 namespace sses_share
@@ -31,10 +35,25 @@ class ComputationParam;
 namespace sses_client
 {
 
-class Record;
+/**
+ * @brief This class is used to hold the result of appending records.
+ */
+struct AppendResult
+{
+    bool status = false;    ///< whether the server appended the records
+    size_t num_applied = 0; ///< records appended to the DB of every key
+    size_t num_skipped = 0; ///< records not appended as the batch is rejected
+    size_t num_keys = 0;    ///< keys whose encrypted data got the records
+    std::vector<int32_t> conflict_ids; ///< IDs already in the DB (batch is rejected)
+};
 
 /**
  * @brief Provides client.
+ * Results of queries sent with a callback function or by send_query_async
+ * are received in background: one I/O thread polls the server for all
+ * outstanding queries with one request per interval, and a small pool of
+ * threads decrypts the results, so any number of queries can be
+ * outstanding. Requests to the server never interleave.
  */
 class Client
 {
@@ -59,9 +78,18 @@ public:
                  const uint32_t timeout_sec = SSES_TIMEOUT_SEC);
     /**
      * Disconnect
+     * @note Queries whose results are not received yet are completed with
+     * status false.
      */
     void disconnect();
 
+    /**
+     * Compress payloads (zlib) if the server supports it.
+     * Must be called before connect.
+     * @param[in] enable enable or disable
+     */
+    void set_compression(const bool enable) const;
+
     /**
      * Register encryption keys
      * @param[in] key_id key ID
@@ -72,6 +100,20 @@ public:
                           const std::string& context_filepath,
                           const std::string& pubkey_filepath) const;
 
+    /**
+     * Wait until DB of key is ready
+     * @param[in] key_id key ID
+     * @param[in] timeout_sec max time to wait (sec)
+     * @param[in] retry_interval_usec interval of polling DB status (usec)
+     * @return whether the DB is ready or not (false if the setup failed or
+     * timed out)
+     * @note The server sets up the DB in background after the keys are
+     * registered, and rejects queries until it is ready.
+     */
+    bool wait_db_ready(const int32_t key_id,
+                       const uint32_t timeout_sec = SSES_DB_READY_TIMEOUT_SEC,
+                       const uint32_t retry_interval_usec = SSES_RETRY_INTERVAL_USEC) const;
+
     /**
      * Send query
      * @param[in] key_id key ID
@@ -100,6 +142,7 @@ public:
      * @param[in] cbfunc callback function
      * @param[in] cbfunc_args arguments for callback function
      * @return queryID
+     * @note cbfunc is called on a thread of the decrypt pool.
      */
     int32_t send_query(const int32_t key_id,
                        const size_t age,
@@ -109,6 +152,23 @@ public:
                        const sses_share::EncData& enc_inputs, cbfunc_t cbfunc,
                        void* cbfunc_args) const;
 
+    /**
+     * Send query and receive its results in background
+     * @param[in] key_id key ID
+     * @param[in] age age
+     * @param[in] gender gender
+     * @param[in] meds medicines list
+     * @param[in] sides side effect list
+     * @param[in] enc_input encrypted input values
+     * @return future of result (status is false if the query was rejected)
+     */
+    std::future<QueryResult> send_query_async(const int32_t key_id,
+                                              const size_t age,
+                                              const std::string& gender,
+                                              const std::string& meds,
+                                              const std::string& sides,
+                                              const sses_share::EncData& encdata) const;
+
     /**
      * Receive results
      * @param[in] query_id     query ID
@@ -118,6 +178,38 @@ public:
     void recv_results(const int32_t query_id, bool& status,
                       std::vector<Record>& records) const;
 
+    /**
+     * Get estimated cost of query
+     * @param[in] query_id query ID (-1 for the last rejected query)
+     * @return estimated number of records the server calculates for the query
+     */
+    uint64_t estimated_cost(const int32_t query_id) const;
+
+    /**
+     * Cancel query
+     * @param[in] query_id query ID
+     * @note The server removes the queued query, stops the running query
+     * and frees its results.
+     */
+    void cancel_query(const int32_t query_id) const;
+
+    /**
+     * Append records to DB
+     * @param[in] csv_filepath CSV file of records (same columns as DB source)
+     * @return result of append
+     * @note The server encrypts only the new records and updates its
+     * indexes incrementally. It replies when all set-up keys got them.
+     * If any record ID already exists, no record is appended.
+     */
+    AppendResult append_records(const std::string& csv_filepath) const;
+
+    /**
+     * Get statistics of server
+     * @return per-stage latency histograms, queue depths, cache hits, etc.
+     * in the Prometheus text format
+     */
+    std::string server_stats() const;
+
     /**
      * Set callback functions
      * @param[in] query_id queryID
@@ -127,11 +219,20 @@ public:
     void set_callback(const int32_t query_id, cbfunc_t funvc, void* args) const;
 
     /**
-     * Wait for finish of query
+     * Wait for finish of query sent with a callback function
      * @param[in] query_id query ID
+     * @note Returns after the callback function returned.
      */
     void wait(const int32_t query_id) const;
 
+    /**
+     * Set number of threads decrypting results in background
+     * Must be called before the first query with a callback function or
+     * send_query_async.
+     * @param[in] num_threads number of threads
+     */
+    void set_decrypt_threads(const uint32_t num_threads) const;
+
 private:
     struct Impl;
     std::shared_ptr<Impl> pimpl_;
@@ -33,6 +33,16 @@ struct Record
     std::vector<int32_t> symptomIds_;
 };
 
+/**
+ * @brief This class is used to hold the result of query
+ */
+struct QueryResult
+{
+    int32_t query_id;
+    bool status;                 ///< false if the query was rejected or failed
+    std::vector<Record> records;
+};
+
 } /* namespace sses_client */
 
 #endif /* SSES_CLIENT_RECORD_HPP */
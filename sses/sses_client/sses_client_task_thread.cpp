@@ -0,0 +1,195 @@
+/*
+ * Copyright 2020 Yamana Laboratory, Waseda University
+ * Supported by JST CREST Grant Number JPMJCR1503, Japan.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE‐2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <chrono>
+#include <condition_variable>
+#include <map>
+#include <mutex>
+
+#include <stdsc/stdsc_exception.hpp>
+#include <stdsc/stdsc_log.hpp>
+
+#include <sses_client/sses_client_task_thread.hpp>
+
+namespace sses_client
+{
+
+// TaskQueue
+
+struct TaskQueue::Impl
+{
+    using clock_t = std::chrono::steady_clock;
+
+    Impl(void) : closed_(false)
+    {
+    }
+
+    void push(task_t task, const uint32_t delay_usec)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mtx_);
+            if (closed_)
+            {
+                return;
+            }
+            auto due = clock_t::now() + std::chrono::microseconds(delay_usec);
+            tasks_.emplace(due, std::move(task));
+        }
+        cond_.notify_one();
+    }
+
+    bool pop(task_t& task)
+    {
+        std::unique_lock<std::mutex> lock(mtx_);
+        while (!closed_)
+        {
+            if (tasks_.empty())
+            {
+                cond_.wait(lock);
+                continue;
+            }
+
+            auto it = tasks_.begin();
+            if (clock_t::now() < it->first)
+            {
+                cond_.wait_until(lock, it->first);
+                continue;
+            }
+
+            task = std::move(it->second);
+            tasks_.erase(it);
+            return true;
+        }
+        return false;
+    }
+
+    void close(void)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mtx_);
+            closed_ = true;
+            tasks_.clear();
+        }
+        cond_.notify_all();
+    }
+
+    size_t size(void) const
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        return tasks_.size();
+    }
+
+private:
+    // multimap keeps the insertion order of tasks due at the same time
+    std::multimap<clock_t::time_point, task_t> tasks_;
+    bool closed_;
+    mutable std::mutex mtx_;
+    std::condition_variable cond_;
+};
+
+TaskQueue::TaskQueue(void) : pimpl_(new Impl())
+{
+}
+
+void TaskQueue::push(task_t task, const uint32_t delay_usec)
+{
+    pimpl_->push(std::move(task), delay_usec);
+}
+
+bool TaskQueue::pop(task_t& task)
+{
+    return pimpl_->pop(task);
+}
+
+void TaskQueue::close(void)
+{
+    pimpl_->close();
+}
+
+size_t TaskQueue::size(void) const
+{
+    return pimpl_->size();
+}
+
+// TaskThread
+
+struct TaskThread::Impl
+{
+    explicit Impl(TaskQueue& queue) : queue_(queue)
+    {
+        te_ = stdsc::ThreadException::create();
+    }
+
+    void exec(TaskThreadParam& args, std::shared_ptr<stdsc::ThreadException> te)
+    {
+        TaskQueue::task_t task;
+        while (queue_.pop(task))
+        {
+            // tasks report their own errors, keep running the others
+            try
+            {
+                task();
+            }
+            catch (const std::exception& e)
+            {
+                STDSC_LOG_WARN("Failed to run task. (%s)", e.what());
+            }
+            task = nullptr;
+        }
+    }
+
+    std::shared_ptr<stdsc::ThreadException> te_;
+    TaskThreadParam param_;
+
+private:
+    TaskQueue& queue_;
+};
+
+TaskThread::TaskThread(TaskQueue& queue) : pimpl_(new Impl(queue))
+{
+}
+
+TaskThread::~TaskThread(void)
+{
+    super::join();
+}
+
+void TaskThread::start()
+{
+    super::start(pimpl_->param_, pimpl_->te_);
+}
+
+void TaskThread::wait()
+{
+    super::join();
+    pimpl_->te_->rethrow_if_has_exception();
+}
+
+void TaskThread::exec(TaskThreadParam& args,
+                      std::shared_ptr<stdsc::ThreadException> te) const
+{
+    try
+    {
+        pimpl_->exec(args, te);
+    }
+    catch (...)
+    {
+        te->set_current_exception();
+    }
+}
+
+} /* namespace sses_client */
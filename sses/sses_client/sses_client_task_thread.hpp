@@ -0,0 +1,119 @@
+/*
+ * Copyright 2020 Yamana Laboratory, Waseda University
+ * Supported by JST CREST Grant Number JPMJCR1503, Japan.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE‐2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SSES_CLIENT_TASK_THREAD_HPP
+#define SSES_CLIENT_TASK_THREAD_HPP
+
+#include <cstdbool>
+#include <functional>
+#include <memory>
+
+#include <stdsc/stdsc_thread.hpp>
+
+namespace sses_client
+{
+
+class TaskThreadParam;
+
+/**
+ * @brief Queue of tasks run by TaskThreads.
+ * Tasks are run in order of the time they are due; tasks pushed with the
+ * same delay are run in the order they were pushed.
+ */
+class TaskQueue
+{
+public:
+    using task_t = std::function<void(void)>;
+
+    TaskQueue(void);
+    virtual ~TaskQueue(void) = default;
+
+    /**
+     * Push task
+     * @param[in] task       task
+     * @param[in] delay_usec delay before the task is run (usec)
+     */
+    void push(task_t task, const uint32_t delay_usec = 0);
+
+    /**
+     * Pop the next task, blocking until one is due
+     * @param[out] task task
+     * @return false if the queue was closed
+     */
+    bool pop(task_t& task);
+
+    /**
+     * Close queue. Tasks not run yet are dropped.
+     */
+    void close(void);
+
+    /**
+     * Number of tasks not run yet
+     * @return number of tasks
+     */
+    size_t size(void) const;
+
+private:
+    struct Impl;
+    std::shared_ptr<Impl> pimpl_;
+};
+
+/**
+ * @brief Runs the tasks of TaskQueue until the queue is closed.
+ * Several threads may share a queue.
+ */
+class TaskThread : public stdsc::Thread<TaskThreadParam>
+{
+    using super = stdsc::Thread<TaskThreadParam>;
+
+public:
+    /**
+     * Constructor
+     * @param[in] queue task queue
+     */
+    explicit TaskThread(TaskQueue& queue);
+    virtual ~TaskThread(void);
+
+    /**
+     * Start thread
+     */
+    void start();
+
+    /**
+     * Wait for finish, i.e. until the queue is closed
+     */
+    void wait();
+
+private:
+    virtual void exec(
+      TaskThreadParam& args,
+      std::shared_ptr<stdsc::ThreadException> te) const override;
+
+    struct Impl;
+    std::shared_ptr<Impl> pimpl_;
+};
+
+/**
+ * @brief This class is used to hold the parameters for TaskThread.
+ */
+struct TaskThreadParam
+{
+};
+
+} /* namespace sses_client */
+
+#endif /* SSES_CLIENT_TASK_THREAD_HPP */
@@ -27,6 +27,7 @@
 #include <sses_server/sses_server_calcmanager.hpp>
 #include <sses_server/sses_server_callback_param.hpp>
 #include <sses_server/sses_server_db.hpp>
+#include <sses_server/sses_server_db_builder.hpp>
 
 namespace sses_server
 {
@@ -42,23 +43,37 @@ public:
          const uint32_t max_concurrent_queries,
          const uint32_t max_results,
          const uint32_t result_lifetime_sec,
-         const uint32_t num_threads)
+         const uint32_t num_threads,
+         const size_t max_result_bytes,
+         const char* result_spill_dir,
+         const uint64_t max_query_cost,
+         const size_t max_db_bytes)
         : calc_manager_(new CalcManager(max_concurrent_queries, max_results,
-                                        result_lifetime_sec, num_threads)),
+                                        result_lifetime_sec, num_threads,
+                                        max_result_bytes, result_spill_dir,
+                                        max_query_cost, max_db_bytes)),
           key_container_(new sses_share::FHEKeyContainer()),
-          db_(new sses_server::DB(db_basedir)),
-          param_(new CallbackParam()),
+          db_(new sses_server::DB(db_basedir, max_db_bytes)),
+          db_builder_(new DBBuilder(*db_, *key_container_, db_src_filepath)),
           cparam_(new CommonCallbackParam(*calc_manager_,
                                           *key_container_,
-                                          *db_, db_src_filepath))
+                                          *db_, *db_builder_,
+                                          db_src_filepath))
     {
         STDSC_LOG_INFO("Initialized computation server with port #%s", port);
-        callback.set_commondata(static_cast<void*>(param_.get()),
-                                sizeof(*param_));
+        server_ = std::make_shared<stdsc::Server<>>(port, state, callback);
+        server_->set_max_connections(SSES_DEFAULT_MAX_CONNECTIONS);
+        server_->set_idle_timeout(SSES_DEFAULT_IDLE_TIMEOUT_SEC);
+
+        // the server shares the callback container, so the data is set
+        // after it is constructed to let callbacks refer to it
+        cparam_->server_ = server_.get();
+        // CallbackParam holds containers, so it is constructed for each
+        // connection instead of being copied bytewise
+        callback.set_connection_data<CallbackParam>();
         callback.set_commondata(
             static_cast<void*>(cparam_.get()), sizeof(*cparam_),
             stdsc::CommonDataKind_t::kCommonDataOnAllConnection);
-        server_ = std::make_shared<stdsc::Server<>>(port, state, callback);
     }
 
     ~Impl(void) = default;
@@ -70,11 +85,15 @@ public:
 
         const uint32_t thread_num = 2;
         calc_manager_->start_threads(thread_num);
+
+        db_builder_->start();
     }
 
     void stop(void)
     {
         server_->stop();
+        calc_manager_->stop_threads();
+        db_builder_->stop();
     }
 
     void wait(void)
@@ -82,13 +101,18 @@ public:
         server_->wait();
     }
 
+    size_t num_connections(void) const
+    {
+        return server_->num_connections();
+    }
+
 private:
     std::string dec_host_;
     std::string dec_port_;
     std::shared_ptr<CalcManager> calc_manager_;
     std::shared_ptr<sses_share::FHEKeyContainer> key_container_;
     std::shared_ptr<sses_server::DB> db_;
-    std::shared_ptr<CallbackParam> param_;
+    std::shared_ptr<DBBuilder> db_builder_;
     std::shared_ptr<CommonCallbackParam> cparam_;
     std::shared_ptr<stdsc::Server<>> server_;
 };
@@ -100,13 +124,19 @@ Server::Server(const char* port, stdsc::CallbackFunctionContainer& callback,
                const uint32_t max_concurrent_queries,
                const uint32_t max_results,
                const uint32_t result_lifetime_sec,
-               const uint32_t num_threads)
+               const uint32_t num_threads,
+               const size_t max_result_bytes,
+               const char* result_spill_dir,
+               const uint64_t max_query_cost,
+               const size_t max_db_bytes)
     : pimpl_(new Impl(port, callback,
                       state,
                       db_src_filepath, db_basedir,
                       max_concurrent_queries, max_results,
                       result_lifetime_sec,
-                      num_threads))
+                      num_threads,
+                      max_result_bytes, result_spill_dir,
+                      max_query_cost, max_db_bytes))
 {
 }
 
@@ -128,4 +158,9 @@ void Server::wait(void)
     pimpl_->wait();
 }
 
+size_t Server::num_connections(void) const
+{
+    return pimpl_->num_connections();
+}
+
 } /* namespace sses_server */
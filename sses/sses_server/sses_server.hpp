@@ -47,6 +47,11 @@ public:
      * @param[in] max_concurrent_queries max concurrent query number
      * @param[in] max_results            max result number
      * @param[in] result_lifetime_sec    result linefile (sec)
+     * @param[in] num_threads            number of threads per query
+     * @param[in] max_result_bytes       max bytes of results held in memory
+     * @param[in] result_spill_dir       directory to spill results exceeding the budget
+     * @param[in] max_query_cost         max estimated cost (records) of query to accept
+     * @param[in] max_db_bytes           disk budget of the encrypted DB of keys (0: unlimited)
      */
     Server(const char* port,
            stdsc::CallbackFunctionContainer& callback,
@@ -58,7 +63,11 @@ public:
            const uint32_t max_results = SSES_DEFAULT_MAX_RESULTS,
            const uint32_t result_lifetime_sec =
              SSES_DEFAULT_MAX_RESULT_LIFETIME_SEC,
-           const uint32_t num_threads = SSES_DEFAULT_NUM_THREADS);
+           const uint32_t num_threads = SSES_DEFAULT_NUM_THREADS,
+           const size_t max_result_bytes = SSES_DEFAULT_MAX_RESULT_BYTES,
+           const char* result_spill_dir = SSES_DEFAULT_RESULT_SPILL_DIR,
+           const uint64_t max_query_cost = SSES_DEFAULT_MAX_QUERY_COST,
+           const size_t max_db_bytes = SSES_DEFAULT_MAX_DB_DISK_BYTES);
     
     ~Server(void) = default;
 
@@ -74,6 +83,10 @@ public:
      * wait for stopping
      */
     void wait(void);
+    /**
+     * number of open connections
+     */
+    size_t num_connections(void) const;
 
 private:
     struct Impl;
@@ -0,0 +1,382 @@
+/*
+ * Copyright 2020 Yamana Laboratory, Waseda University
+ * Supported by JST CREST Grant Number JPMJCR1503, Japan.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE‐2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+
+#include <stdsc/stdsc_exception.hpp>
+#include <stdsc/stdsc_log.hpp>
+
+#include <sses_server/sses_server_aux_store.hpp>
+
+namespace sses_server
+{
+
+static constexpr char AUXSTORE_MAGIC[8] = {'S', 'S', 'E', 'S', 'A', 'U', 'X', '1'};
+
+struct AuxStoreHeader
+{
+    char magic[8];
+    uint64_t num_records;
+    uint64_t num_meds;
+    uint64_t num_sides;
+};
+
+/**
+ * One mapped store file
+ */
+class AuxStoreFile
+{
+public:
+    explicit AuxStoreFile(const std::string& filepath)
+        : addr_(MAP_FAILED), length_(0)
+    {
+        int fd = ::open(filepath.c_str(), O_RDONLY);
+        STDSC_THROW_FILE_IF_CHECK(fd >= 0, "failed to open. (" + filepath + ")");
+
+        struct stat st;
+        if (::fstat(fd, &st) == 0 && st.st_size >= static_cast<off_t>(sizeof(AuxStoreHeader))) {
+            length_ = st.st_size;
+            addr_ = ::mmap(nullptr, length_, PROT_READ, MAP_PRIVATE, fd, 0);
+        }
+        ::close(fd);
+        STDSC_THROW_FILE_IF_CHECK(addr_ != MAP_FAILED, "failed to map. (" + filepath + ")");
+
+        auto base = static_cast<const char*>(addr_);
+        auto header = reinterpret_cast<const AuxStoreHeader*>(base);
+        num_ = header->num_records;
+        auto expected = sizeof(AuxStoreHeader)
+            + sizeof(uint64_t) * (num_ + 1) * 2
+            + sizeof(int32_t) * (num_ + header->num_meds + header->num_sides);
+        if (std::memcmp(header->magic, AUXSTORE_MAGIC, sizeof(AUXSTORE_MAGIC)) != 0 ||
+            expected != length_)
+        {
+            ::munmap(addr_, length_);
+            STDSC_THROW_FILE("broken aux store. (" + filepath + ")");
+        }
+
+        auto p = base + sizeof(AuxStoreHeader);
+        med_offsets_ = reinterpret_cast<const uint64_t*>(p);
+        p += sizeof(uint64_t) * (num_ + 1);
+        side_offsets_ = reinterpret_cast<const uint64_t*>(p);
+        p += sizeof(uint64_t) * (num_ + 1);
+        record_ids_ = reinterpret_cast<const int32_t*>(p);
+        p += sizeof(int32_t) * num_;
+        meds_ = reinterpret_cast<const int32_t*>(p);
+        p += sizeof(int32_t) * header->num_meds;
+        sides_ = reinterpret_cast<const int32_t*>(p);
+    }
+
+    ~AuxStoreFile()
+    {
+        if (addr_ != MAP_FAILED) {
+            ::munmap(addr_, length_);
+        }
+    }
+
+    AuxStoreFile(const AuxStoreFile&) = delete;
+    AuxStoreFile& operator=(const AuxStoreFile&) = delete;
+
+    size_t size() const
+    {
+        return num_;
+    }
+
+    int32_t record_id(const size_t i) const
+    {
+        return record_ids_[i];
+    }
+
+    /**
+     * Position of record ID (size() if not found)
+     */
+    size_t position(const int32_t record_id) const
+    {
+        auto end = record_ids_ + num_;
+        auto it = std::lower_bound(record_ids_, end, record_id);
+        return (it != end && *it == record_id) ? it - record_ids_ : num_;
+    }
+
+    AuxStore::Entry entry(const size_t i) const
+    {
+        return AuxStore::Entry{meds_ + med_offsets_[i],
+                               med_offsets_[i + 1] - med_offsets_[i],
+                               sides_ + side_offsets_[i],
+                               side_offsets_[i + 1] - side_offsets_[i]};
+    }
+
+private:
+    void* addr_;
+    size_t length_;
+    size_t num_;
+    const uint64_t* med_offsets_;
+    const uint64_t* side_offsets_;
+    const int32_t* record_ids_;
+    const int32_t* meds_;
+    const int32_t* sides_;
+};
+
+struct AuxStore::Impl
+{
+    explicit Impl(const std::vector<std::string>& filepaths)
+    {
+        for (const auto& filepath : filepaths) {
+            files_.emplace_back(new AuxStoreFile(filepath));
+        }
+    }
+
+    bool find(const int32_t record_id, Entry& entry) const
+    {
+        for (auto it = files_.rbegin(); it != files_.rend(); ++it)
+        {
+            auto pos = (*it)->position(record_id);
+            if (pos < (*it)->size()) {
+                entry = (*it)->entry(pos);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    size_t size() const
+    {
+        size_t n = 0;
+        for (const auto& file : files_) {
+            n += file->size();
+        }
+        return n;
+    }
+
+    void for_each(std::function<void(const int32_t, const Entry&)> func) const
+    {
+        std::vector<size_t> pos(files_.size(), 0);
+        while (true)
+        {
+            // smallest record ID; the latest file wins on duplicates
+            int64_t min_idx = -1;
+            for (size_t i = 0; i < files_.size(); ++i)
+            {
+                if (pos[i] >= files_[i]->size()) {
+                    continue;
+                }
+                if (min_idx < 0 ||
+                    files_[i]->record_id(pos[i]) <= files_[min_idx]->record_id(pos[min_idx])) {
+                    min_idx = i;
+                }
+            }
+            if (min_idx < 0) {
+                break;
+            }
+
+            auto record_id = files_[min_idx]->record_id(pos[min_idx]);
+            func(record_id, files_[min_idx]->entry(pos[min_idx]));
+            for (size_t i = 0; i < files_.size(); ++i)
+            {
+                if (pos[i] < files_[i]->size() && files_[i]->record_id(pos[i]) == record_id) {
+                    ++pos[i];
+                }
+            }
+        }
+    }
+
+private:
+    std::vector<std::unique_ptr<AuxStoreFile>> files_;
+};
+
+AuxStore::AuxStore(const std::vector<std::string>& filepaths)
+    : pimpl_(new Impl(filepaths))
+{
+}
+
+bool AuxStore::find(const int32_t record_id, Entry& entry) const
+{
+    return pimpl_->find(record_id, entry);
+}
+
+size_t AuxStore::size() const
+{
+    return pimpl_->size();
+}
+
+void AuxStore::for_each(std::function<void(const int32_t, const Entry&)> func) const
+{
+    pimpl_->for_each(func);
+}
+
+struct AuxStoreWriter::Impl
+{
+    enum Column_t : int
+    {
+        kColumnMedOffsets = 0,
+        kColumnSideOffsets,
+        kColumnRecordIds,
+        kColumnMeds,
+        kColumnSides,
+        kNumColumns,
+    };
+
+    explicit Impl(const std::string& filepath)
+        : filepath_(filepath),
+          num_records_(0),
+          num_meds_(0),
+          num_sides_(0),
+          closed_(false)
+    {
+        for (int i = 0; i < kNumColumns; ++i)
+        {
+            auto path = column_filepath(i);
+            columns_[i].open(path, std::ios::binary | std::ios::trunc);
+            STDSC_THROW_FILE_IF_CHECK(columns_[i].is_open(), "failed to open. (" + path + ")");
+        }
+        write_offsets();
+    }
+
+    ~Impl()
+    {
+        if (!closed_) {
+            remove_columns();
+        }
+    }
+
+    template <class It>
+    void add(const int32_t record_id, It meds_begin, It meds_end, It sides_begin, It sides_end)
+    {
+        STDSC_THROW_INVPARAM_IF_CHECK(num_records_ == 0 || last_record_id_ < record_id,
+                                      "record IDs must be added in ascending order.");
+        write(kColumnRecordIds, record_id);
+        for (auto it = meds_begin; it != meds_end; ++it, ++num_meds_) {
+            write(kColumnMeds, static_cast<int32_t>(*it));
+        }
+        for (auto it = sides_begin; it != sides_end; ++it, ++num_sides_) {
+            write(kColumnSides, static_cast<int32_t>(*it));
+        }
+        write_offsets();
+        last_record_id_ = record_id;
+        ++num_records_;
+    }
+
+    void close()
+    {
+        // A short column would commit a truncated store, so check every
+        // column before the final file is created.
+        for (int i = 0; i < kNumColumns; ++i)
+        {
+            columns_[i].close();
+            STDSC_THROW_FILE_IF_CHECK(!columns_[i].fail(),
+                                      "failed to write. (" + column_filepath(i) + ")");
+        }
+
+        std::ofstream ofs(filepath_, std::ios::binary | std::ios::trunc);
+        STDSC_THROW_FILE_IF_CHECK(ofs.is_open(), "failed to open. (" + filepath_ + ")");
+
+        AuxStoreHeader header;
+        std::memcpy(header.magic, AUXSTORE_MAGIC, sizeof(AUXSTORE_MAGIC));
+        header.num_records = num_records_;
+        header.num_meds = num_meds_;
+        header.num_sides = num_sides_;
+        ofs.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+        bool copied = true;
+        for (int i = 0; i < kNumColumns && copied; ++i)
+        {
+            std::ifstream ifs(column_filepath(i), std::ios::binary);
+            char buf[64 * 1024];
+            while (ifs.read(buf, sizeof(buf)) || ifs.gcount() > 0) {
+                ofs.write(buf, ifs.gcount());
+            }
+            copied = ifs.eof() && !ifs.bad();
+        }
+        ofs.close();
+        if (!copied || ofs.fail()) {
+            std::remove(filepath_.c_str());
+            STDSC_THROW_FILE("failed to write. (" + filepath_ + ")");
+        }
+
+        remove_columns();
+        closed_ = true;
+    }
+
+private:
+    std::string column_filepath(const int i) const
+    {
+        return filepath_ + "." + std::to_string(i) + ".tmp";
+    }
+
+    template <class T>
+    void write(const int column, const T& v)
+    {
+        columns_[column].write(reinterpret_cast<const char*>(&v), sizeof(T));
+    }
+
+    void write_offsets()
+    {
+        write(kColumnMedOffsets, num_meds_);
+        write(kColumnSideOffsets, num_sides_);
+    }
+
+    void remove_columns()
+    {
+        for (int i = 0; i < kNumColumns; ++i)
+        {
+            if (columns_[i].is_open()) {
+                columns_[i].close();
+            }
+            std::remove(column_filepath(i).c_str());
+        }
+    }
+
+    std::string filepath_;
+    std::ofstream columns_[kNumColumns];
+    uint64_t num_records_;
+    uint64_t num_meds_;
+    uint64_t num_sides_;
+    int32_t last_record_id_;
+    bool closed_;
+};
+
+AuxStoreWriter::AuxStoreWriter(const std::string& filepath)
+    : pimpl_(new Impl(filepath))
+{
+}
+
+void AuxStoreWriter::add(const int32_t record_id,
+                         const std::set<size_t>& meds,
+                         const std::set<size_t>& sides)
+{
+    pimpl_->add(record_id, meds.begin(), meds.end(), sides.begin(), sides.end());
+}
+
+void AuxStoreWriter::add(const int32_t record_id, const AuxStore::Entry& entry)
+{
+    pimpl_->add(record_id,
+                entry.meds, entry.meds + entry.num_meds,
+                entry.sides, entry.sides + entry.num_sides);
+}
+
+void AuxStoreWriter::close()
+{
+    pimpl_->close();
+}
+
+} /* namespace sses_server */
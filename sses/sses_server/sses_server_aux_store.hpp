@@ -0,0 +1,135 @@
+/*
+ * Copyright 2020 Yamana Laboratory, Waseda University
+ * Supported by JST CREST Grant Number JPMJCR1503, Japan.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE‐2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SSES_SERVER_AUX_STORE_HPP
+#define SSES_SERVER_AUX_STORE_HPP
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace sses_server
+{
+
+/**
+ * @brief Provides read access to the aux data (medicine and symptom IDs of
+ * each record) stored in binary columnar files.
+ *
+ * File layout (native byte order):
+ *   header       : magic[8], num_records, num_meds, num_sides (uint64_t)
+ *   med_offsets  : uint64_t[num_records + 1]
+ *   side_offsets : uint64_t[num_records + 1]
+ *   record_ids   : int32_t[num_records] (ascending)
+ *   med_ids      : int32_t[num_meds]
+ *   side_ids     : int32_t[num_sides]
+ *
+ * The files are mapped to memory, and the entries point into the mapping.
+ */
+class AuxStore
+{
+public:
+    /**
+     * @brief Aux data of record
+     */
+    struct Entry
+    {
+        const int32_t* meds;
+        size_t num_meds;
+        const int32_t* sides;
+        size_t num_sides;
+    };
+
+    /**
+     * Constructor
+     * @param[in] filepaths store files (later files take precedence)
+     */
+    explicit AuxStore(const std::vector<std::string>& filepaths);
+    virtual ~AuxStore() = default;
+
+    /**
+     * Find aux data of record
+     * @param[in] record_id record ID
+     * @param[out] entry aux data (valid while this store is alive)
+     * @return false if the record is not found
+     */
+    bool find(const int32_t record_id, Entry& entry) const;
+
+    /**
+     * Number of records
+     */
+    size_t size() const;
+
+    /**
+     * Visit all records in ascending order of record ID
+     * @param[in] func function called for each record
+     */
+    void for_each(std::function<void(const int32_t, const Entry&)> func) const;
+
+private:
+    struct Impl;
+    std::shared_ptr<Impl> pimpl_;
+};
+
+/**
+ * @brief Writes the aux data store file.
+ * Records must be added in ascending order of record ID. The columns are
+ * written to temporary files and joined on close, so that memory use does
+ * not depend on the number of records.
+ */
+class AuxStoreWriter
+{
+public:
+    /**
+     * Constructor
+     * @param[in] filepath store filepath
+     */
+    explicit AuxStoreWriter(const std::string& filepath);
+    virtual ~AuxStoreWriter() = default;
+
+    /**
+     * Add record
+     * @param[in] record_id record ID
+     * @param[in] meds medicine IDs
+     * @param[in] sides symptom IDs
+     */
+    void add(const int32_t record_id,
+             const std::set<size_t>& meds,
+             const std::set<size_t>& sides);
+
+    /**
+     * Add record
+     * @param[in] record_id record ID
+     * @param[in] entry aux data
+     */
+    void add(const int32_t record_id, const AuxStore::Entry& entry);
+
+    /**
+     * Write the store file
+     */
+    void close();
+
+private:
+    struct Impl;
+    std::shared_ptr<Impl> pimpl_;
+};
+
+} /* namespace sses_server */
+
+#endif /* SSES_SERVER_AUX_STORE_HPP */
@@ -16,6 +16,7 @@
  */
 
 #include <unistd.h>
+#include <algorithm>
 #include <fstream>
 #include <vector>
 
@@ -30,7 +31,10 @@
 #include <sses_server/sses_server_result.hpp>
 #include <sses_server/sses_server_calcmanager.hpp>
 #include <sses_server/sses_server_calcthread.hpp>
+#include <sses_server/sses_server_db.hpp>
+#include <sses_server/sses_server_index.hpp>
 #include <sses_server/sses_server_query.hpp>
+#include <sses_server/sses_server_result_reaper.hpp>
 
 namespace sses_server
 {
@@ -40,26 +44,42 @@ struct CalcManager::Impl
     Impl(const uint32_t max_concurrent_queries,
          const uint32_t max_results,
          const uint32_t result_lifetime_sec,
-         const uint32_t num_threads)
+         const uint32_t num_threads,
+         const size_t max_result_bytes,
+         const std::string& result_spill_dir,
+         const uint64_t max_query_cost,
+         const uint32_t query_aging_sec)
       : max_concurrent_queries_(max_concurrent_queries),
         max_results_(max_results),
-        result_lifetime_sec_(result_lifetime_sec)
+        result_lifetime_sec_(result_lifetime_sec),
+        max_query_cost_(max_query_cost),
+        qque_(static_cast<double>(max_query_cost)
+              / std::max<uint32_t>(1, query_aging_sec)),
+        reaper_(rque_, result_lifetime_sec, max_result_bytes, result_spill_dir)
     {
     }
 
     const uint32_t max_concurrent_queries_;
     const uint32_t max_results_;
     const uint32_t result_lifetime_sec_;
+    const uint64_t max_query_cost_;
     QueryQueue qque_;
     ResultQueue rque_;
+    ResultReaper reaper_;
     std::vector<std::shared_ptr<CalcThread>> threads_;
 };
 
 CalcManager::CalcManager(const uint32_t max_concurrent_queries,
                          const uint32_t max_results,
                          const uint32_t result_lifetime_sec,
-                         const uint32_t num_threads)
-    : pimpl_(new Impl(max_concurrent_queries, max_results, result_lifetime_sec, num_threads))
+                         const uint32_t num_threads,
+                         const size_t max_result_bytes,
+                         const std::string& result_spill_dir,
+                         const uint64_t max_query_cost,
+                         const uint32_t query_aging_sec)
+    : pimpl_(new Impl(max_concurrent_queries, max_results, result_lifetime_sec,
+                      num_threads, max_result_bytes, result_spill_dir,
+                      max_query_cost, query_aging_sec))
 {
 }
 
@@ -77,11 +97,14 @@ void CalcManager::start_threads(const uint32_t thread_pool_size)
     {
         thread->start();
     }
+
+    pimpl_->reaper_.start();
 }
 
 void CalcManager::stop_threads()
 {
     STDSC_LOG_INFO("Stop calculation threads.");
+    pimpl_->reaper_.stop();
 }
 
 void CalcManager::regist_enckeys(const int32_t key_id,
@@ -90,18 +113,44 @@ void CalcManager::regist_enckeys(const int32_t key_id,
 {
 }
 
-int32_t CalcManager::push_query(const Query& query)
+int32_t CalcManager::push_query(const Query& query, uint64_t& estimated_cost)
 {
     int32_t query_id = -1;
 
+    Query q(query);
+    try
+    {
+        std::vector<int> med_ids, side_ids;
+        q.param_.get_med_ids(med_ids);
+        q.param_.get_side_ids(side_ids);
+        q.cost_ = estimate_cost(*q.db_p_->medinv(q.key_id_),
+                                *q.db_p_->sideinv(q.key_id_),
+                                med_ids, side_ids);
+    }
+    catch (const std::exception& ex)
+    {
+        // e.g. the key is not known to the DB (std::out_of_range)
+        STDSC_LOG_WARN(ex.what());
+        estimated_cost = 0;
+        return query_id;
+    }
+    estimated_cost = q.cost_;
+
+    if (q.cost_ > pimpl_->max_query_cost_)
+    {
+        STDSC_LOG_WARN("Rejected query because its estimated cost exceeds the budget. "
+                       "[cost:%lu, budget:%lu]", q.cost_, pimpl_->max_query_cost_);
+        return query_id;
+    }
+
     if (pimpl_->qque_.size() < pimpl_->max_concurrent_queries_ &&
         pimpl_->rque_.size() < pimpl_->max_results_)
     {
         try
         {
-            query_id = pimpl_->qque_.push(query);
+            query_id = pimpl_->qque_.push(q);
         }
-        catch (stdsc::AbstractException& ex)
+        catch (const std::exception& ex)
         {
             STDSC_LOG_WARN(ex.what());
         }
@@ -110,38 +159,71 @@ int32_t CalcManager::push_query(const Query& query)
     return query_id;
 }
 
-void CalcManager::pop_result(const int32_t query_id, Result& result,
-                             const uint32_t retry_interval_msec) const
+bool CalcManager::cancel_query(const int32_t query_id)
 {
-    while (!pimpl_->rque_.pop(query_id, result))
+    // the calculation thread pushes its result before it leaves the running
+    // state, so the result queue must be swept after the query queue.
+    bool found = pimpl_->qque_.cancel(query_id);
+
+    Result tmp;
+    found |= pimpl_->rque_.pop(query_id, tmp);
+
+    if (found)
     {
-        usleep(retry_interval_msec * 1000);
+        STDSC_LOG_INFO("Canceled query%d.", query_id);
     }
+    return found;
 }
 
-void CalcManager::cleanup_results()
+bool CalcManager::is_computing(const int32_t query_id) const
+{
+    return pimpl_->qque_.count(query_id) || pimpl_->qque_.is_running(query_id);
+}
+
+bool CalcManager::pop_result(const int32_t query_id, Result& result,
+                             const uint32_t retry_interval_msec) const
 {
-    if (pimpl_->rque_.size() >= pimpl_->max_results_)
+    while (!pimpl_->rque_.pop(query_id, result))
     {
-        std::vector<int32_t> query_ids;
-        for (const auto& pair : pimpl_->rque_)
-        {
-            const auto& query_id = pair.first;
-            const auto& result = pair.second;
-            if (result.elapsed_time() >= pimpl_->result_lifetime_sec_)
-            {
-                STDSC_LOG_INFO(
-                  "Deleted the results of query%d because it has expired.",
-                  query_id);
-                query_ids.push_back(query_id);
-            }
-        }
-        Result tmp;
-        for (const auto& id : query_ids)
+        if (!pimpl_->qque_.count(query_id) &&
+            !pimpl_->qque_.is_running(query_id))
         {
-            pimpl_->rque_.pop(id, tmp);
+            // retry once because the result may be pushed just before
+            return pimpl_->rque_.pop(query_id, result);
         }
+        usleep(retry_interval_msec * 1000);
     }
+    return true;
+}
+
+void CalcManager::cleanup_results()
+{
+    pimpl_->reaper_.sweep();
+}
+
+size_t CalcManager::num_queued_queries() const
+{
+    return pimpl_->qque_.size();
+}
+
+size_t CalcManager::num_running_queries() const
+{
+    return pimpl_->qque_.num_running();
+}
+
+size_t CalcManager::num_results() const
+{
+    return pimpl_->rque_.size();
+}
+
+size_t CalcManager::held_result_bytes() const
+{
+    return pimpl_->rque_.held_bytes();
+}
+
+size_t CalcManager::spilled_result_bytes() const
+{
+    return pimpl_->rque_.spilled_bytes();
 }
 
 } /* namespace sses_server */
@@ -22,6 +22,8 @@
 #include <memory>
 #include <string>
 
+#include <sses_share/sses_define.hpp>
+
 class FHEcontext;
 class FHEPubKey;
 
@@ -40,11 +42,20 @@ public:
      * @param[in] max_results max        result number to hold
      * @param[in] result_lifetime_sec    lifetime to hold (sec)
      * @param[in] num_threads            number of threads used for calculations per query
+     * @param[in] max_result_bytes       max bytes of results held in memory
+     * @param[in] result_spill_dir       directory to spill results exceeding the budget
+     * @param[in] max_query_cost         max estimated cost of query to accept
+     * @param[in] query_aging_sec        waiting time (sec) after which a query of
+     *                                   max_query_cost is scheduled like a free one
      */
     CalcManager(const uint32_t max_concurrent_queries,
                 const uint32_t max_results,
                 const uint32_t result_lifetime_sec,
-                const uint32_t num_threads);
+                const uint32_t num_threads,
+                const size_t max_result_bytes = SSES_DEFAULT_MAX_RESULT_BYTES,
+                const std::string& result_spill_dir = SSES_DEFAULT_RESULT_SPILL_DIR,
+                const uint64_t max_query_cost = SSES_DEFAULT_MAX_QUERY_COST,
+                const uint32_t query_aging_sec = SSES_DEFAULT_QUERY_AGING_SEC);
     virtual ~CalcManager() = default;
 
     /**
@@ -71,25 +82,75 @@ public:
     /**
      * Set queries
      * @param[in] query query
-     * @return query ID
+     * @param[out] estimated_cost estimated number of records to calculate
+     * @return query ID (-1 if the query was rejected)
+     * @note Queries are scheduled in order of the estimated cost, aged by
+     * the waiting time. Queries exceeding the max cost are rejected.
+     */
+    int32_t push_query(const Query& query, uint64_t& estimated_cost);
+
+    /**
+     * Cancel query
+     * @param[in] query_id query ID
+     * @return true if the query was queued, running or had results
+     * @note Queued query is removed, running query stops at the next chunk
+     * boundary, and held results are freed.
      */
-    int32_t push_query(const Query& query);
+    bool cancel_query(const int32_t query_id);
+
+    /**
+     * Whether the query is queued or running
+     * @param[in] query_id query ID
+     * @return true if the results of the query are not ready yet
+     */
+    bool is_computing(const int32_t query_id) const;
 
     /**
      * Get results of query
      * @paran[in] query_id query ID
      * @param[out] result result
      * @param[in] retry_interval_usec retry interval (usec)
+     * @return false if the query is unknown or canceled
      */
-    void pop_result(const int32_t query_id, Result& result,
+    bool pop_result(const int32_t query_id, Result& result,
                     const uint32_t retry_interval_msec = 100) const;
 
     /**
-     * Delete results if number of results grater than max number and expired
-     * lifetime
+     * Delete expired results and spill results exceeding the memory budget
+     * @note This is also called periodically by the result reaper.
      */
     void cleanup_results();
 
+    /**
+     * Number of queries waiting in queue
+     * @return number of queries
+     */
+    size_t num_queued_queries() const;
+
+    /**
+     * Number of queries being calculated
+     * @return number of queries
+     */
+    size_t num_running_queries() const;
+
+    /**
+     * Number of results held
+     * @return number of results
+     */
+    size_t num_results() const;
+
+    /**
+     * Bytes of results held in memory
+     * @return size (bytes)
+     */
+    size_t held_result_bytes() const;
+
+    /**
+     * Bytes of results spilled to files
+     * @return size (bytes)
+     */
+    size_t spilled_result_bytes() const;
+
 private:
     class Impl;
     std::shared_ptr<Impl> pimpl_;
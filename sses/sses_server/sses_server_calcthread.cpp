@@ -19,12 +19,14 @@
 #include <sys/types.h>   // for thread id
 #include <unistd.h>
 #include <algorithm> // for sort
+#include <atomic>
 #include <chrono>
 #include <fstream>
+#include <iterator>
 #include <random>
 #include <map>
+#include <sstream>
 #include <iomanip> // put_time
-#include <boost/algorithm/string.hpp>
 
 #include <NTL/BasicThreadPool.h>
 #include <NTL/ZZ.h>
@@ -37,9 +39,14 @@
 #include <sses_share/sses_fhectxt_buffer.hpp>
 
 #include <sses_server/sses_server_calcthread.hpp>
+#include <sses_server/sses_server_chunk_assembler.hpp>
 #include <sses_server/sses_server_query.hpp>
 #include <sses_server/sses_server_result.hpp>
 #include <sses_server/sses_server_db.hpp>
+#include <sses_server/sses_server_index.hpp>
+#include <sses_server/sses_server_query_batcher.hpp>
+#include <sses_server/sses_server_record_prefetcher.hpp>
+#include <sses_server/sses_server_stats.hpp>
 
 //#define ENABLE_LOCAL_DEBUG
 #ifdef ENABLE_LOCAL_DEBUG
@@ -57,91 +64,6 @@ namespace sses_server
     STDSC_LOG_INFO("[CalThr:%d, Query:%d] " fmt, th_id, query_id, ##__VA_ARGS__)
 
     
-static std::vector<int> mergeOR(const std::map<int, std::vector<int>>& index,
-                                const std::vector<int>& id)
-{
-    int len = id.size();
-
-    if (len == 0)
-    {
-        std::vector<int> ret;
-        return ret;
-    }
-
-    if (len == 1)
-    {
-        if (index.find(id[0]) == index.end())
-        {
-            std::vector<int> ret;
-            return ret;
-        }
-        return index.at(id[0]);
-    }
-
-    const std::vector<int> id_l = std::vector<int>(id.begin(), id.begin() + len / 2);
-    const std::vector<int> id_r = std::vector<int>(id.begin() + len / 2, id.end());
-
-    const std::vector<int> res_l = mergeOR(index, id_l);
-    const std::vector<int> res_r = mergeOR(index, id_r);
-
-    int len_l = res_l.size(), p_l = 0;
-    int len_r = res_r.size(), p_r = 0;
-
-    std::vector<int> ret;
-    while (p_l != len_l && p_r != len_r)
-    {
-        if (res_l[p_l] < res_r[p_r]) {
-            ret.push_back(res_l[p_l++]);
-        } else {
-            if (res_l[p_l] == res_r[p_r]) {
-                ++p_l;
-            }
-            ret.push_back(res_r[p_r++]);
-        }
-    }
-    while (p_l != len_l) {
-        ret.push_back(res_l[p_l++]);
-    }
-    while (p_r != len_r) {
-        ret.push_back(res_r[p_r++]);
-    }
-
-    return ret;
-}
-
-static std::vector<int> merge(const std::vector<int>& medID,
-                              const std::vector<int>& sideID,
-                              std::map<int, std::vector<int>>& medIndex,
-                              std::map<int, std::vector<int>>& sideIndex)
-{
-    // First use OR to merge between medIndex[medID] -> res1
-    const std::vector<int> medres = mergeOR(medIndex, medID);
-
-    // Then use OR to merge between sideIndex[sideID] -> res2
-    const std::vector<int> sideres = mergeOR(sideIndex, sideID);
-
-    // Then use AND to merge res1 and res2 -> ret
-
-    std::vector<int> ret;
-
-    int lenmed = medres.size(), pmed = 0;
-    int lenside = sideres.size(), pside = 0;
-
-    while (pmed != lenmed && pside != lenside)
-    {
-        if (medres[pmed] < sideres[pside]) {
-            ++pmed;
-        } else if (medres[pmed] > sideres[pside]) {
-            ++pside;
-        } else {
-            ret.push_back(medres[pmed++]);
-            ++pside;
-        }
-    }
-
-    return ret;
-}
-    
 struct CalcThread::Impl
 {
     Impl(QueryQueue& in_queue, ResultQueue& out_queue, const uint32_t num_threads)
@@ -159,6 +81,8 @@ struct CalcThread::Impl
         std::mt19937 generator(seed);
 
         auto num_threads = args.num_threads;
+
+        QueryBatcher batcher(in_queue_);
         
         while (!args.force_finish)
         {
@@ -171,11 +95,7 @@ struct CalcThread::Impl
                 usleep(args.retry_interval_msec * 1000);
             }
 
-            LOGINFO("Pop a query from Queue. [age: %lu, gender: %s, meds: %s, sides: %s]",
-                    query.param_.age,
-                    query.param_.gender,
-                    query.param_.meds,
-                    query.param_.sides);
+            LOGINFO("Pop a query from Queue. [%s]", query.param_.to_string().c_str());
 
             LOGINFO("Start processing for query %d.", query_id);
 
@@ -200,53 +120,44 @@ struct CalcThread::Impl
             FHEPubKey pubkey(context);
             key_container.get(key_id, sses_share::KeyKind_t::kKindPubKey, pubkey);
 
-            std::map<int, std::vector<int>> medIndex;
-            std::map<int, std::vector<int>> sideIndex;
+            StageTimer index_timer(kStageIndexLoad);
+            const auto medIndex_p = db.medinv(key_id);
+            const auto sideIndex_p = db.sideinv(key_id);
+            index_timer.stop();
+            const auto& medIndex = *medIndex_p;
+            const auto& sideIndex = *sideIndex_p;
+
+            std::vector<int> MedID, SideID;
+            comp_param.get_med_ids(MedID);
+            comp_param.get_side_ids(SideID);
 
-            std::ifstream findexmed(db.medinv_filepath(key_id), std::ios::binary);
-            std::string line;
-            std::vector<std::string> medInfo;
-            int numMed;
-            findexmed >> numMed;
-            for (int i = 0; i < numMed; ++i)
+            // queries sharing most of the records are evaluated together
+            StageTimer filter_timer(kStageFilter);
+            std::vector<BatchedQuery> batch;
+            batch.push_back(BatchedQuery{query_id, query,
+                                         filter_records(medIndex, sideIndex, MedID, SideID)});
+            batcher.collect(medIndex, sideIndex, batch);
+            const size_t nqueries = batch.size();
+            if (nqueries > 1)
             {
-                findexmed >> line;
-                boost::algorithm::split(medInfo, line, boost::is_any_of(":"));
-                int medId = std::stoi(medInfo[0]);
-                int numindex = std::stoi(medInfo[1]);
-                std::vector<int> tempindex;
-                while (numindex > 0)
-                {
-                    int temprec;
-                    findexmed >> temprec;
-                    tempindex.push_back(temprec);
-                    numindex--;
+                std::ostringstream oss;
+                for (const auto& b : batch) {
+                    oss << b.query_id << " ";
                 }
-                medIndex.insert(make_pair(medId, tempindex));
+                LOGINFO("Batched %lu queries sharing encrypted records. [queryIDs: %s]",
+                        nqueries, oss.str().c_str());
             }
-            findexmed.close();
 
-            std::ifstream findexside(db.sideinv_filepath(key_id), std::ios::binary);
-            std::vector<std::string> sideInfo;
-            int numSide;
-            findexside >> numSide;
-            for (int i = 0; i < numSide; ++i)
+            std::vector<int> filteredres;
+            for (const auto& b : batch)
             {
-                findexside >> line;
-                boost::algorithm::split(sideInfo, line, boost::is_any_of(":"));
-                int sideId = std::stoi(sideInfo[0]);
-                int numindex = std::stoi(sideInfo[1]);
-                std::vector<int> tempindex;
-                while (numindex > 0)
-                {
-                    int temprec;
-                    findexside >> temprec;
-                    tempindex.push_back(temprec);
-                    numindex--;
-                }
-                sideIndex.insert(make_pair(sideId, tempindex));
+                std::vector<int> merged;
+                std::set_union(filteredres.begin(), filteredres.end(),
+                               b.filtered.begin(), b.filtered.end(),
+                               std::back_inserter(merged));
+                filteredres.swap(merged);
             }
-            findexside.close();
+            filter_timer.stop();
 
             const std::vector<long> allzero_long(nslots, 0);
             Ctxt allzero(pubkey);
@@ -254,95 +165,157 @@ struct CalcThread::Impl
 
             NTL::SetNumThreads(num_threads);
 
-            std::vector<Ctxt> ctxts;
-            query.encmask_.deserialize(pubkey, ctxts);
-            Ctxt& query_mask = ctxts[0];
-
-            std::vector<int> MedID, SideID;
-            comp_param.get_med_ids(MedID);
-            comp_param.get_side_ids(SideID);
-
-            std::vector<int> filteredres = merge(MedID, SideID, medIndex, sideIndex);
+            // set when the query is canceled, checked at chunk boundaries
+            std::vector<Ctxt> query_masks;
+            std::vector<std::shared_ptr<std::atomic<bool>>> cancel_flags;
+            for (const auto& b : batch)
+            {
+                std::vector<Ctxt> ctxts;
+                b.query.encmask_.deserialize(pubkey, ctxts);
+                query_masks.push_back(ctxts[0]);
+                cancel_flags.push_back(in_queue_.cancel_flag(b.query_id));
+            }
 
             int numRes = filteredres.size(), numchunks = 0;
 
             LOGINFO("Completed filtering.");
+
+            // members[q][k] : whether k-th filtered record is matched by q-th query
+            std::vector<std::vector<char>> members(nqueries);
+            for (size_t q = 0; q < nqueries; ++q)
+            {
+                const auto& filtered = batch[q].filtered;
+                auto& member = members[q];
+                member.resize(numRes, 0);
+                size_t p = 0;
+                for (int k = 0; k < numRes && p < filtered.size(); ++k)
+                {
+                    if (filteredres[k] == filtered[p]) {
+                        member[k] = 1;
+                        ++p;
+                    }
+                }
+            }
             
             std::vector<std::vector<int>> chunks;
-            std::vector<Ctxt> chunk_res;
-            for (int i = 0; i < numRes; i += 100, ++numchunks)
+            for (int i = 0; i < numRes; i += SSES_DEFAULT_CHUNK_SIZE, ++numchunks)
             {
-                int end = std::min(i + 100, numRes);
+                int end = std::min(i + SSES_DEFAULT_CHUNK_SIZE, numRes);
                 std::vector<int> chunk(filteredres.begin() + i,
                                   filteredres.begin() + end);
                 chunks.push_back(chunk);
-                chunk_res.push_back(allzero);
             }
+            std::vector<std::vector<Ctxt>> chunk_res(
+                nqueries, std::vector<Ctxt>(numchunks, allzero));
 
             LOGINFO("Completed chunk splitting.");
 
+            const auto encdata_dir = db.encdata_dirpath(key_id);
+
+            // slot selectors are transformed once and shared by all chunks
+            ChunkAssembler assembler(context, ea, SSES_DEFAULT_CHUNK_SIZE);
+
+            // chunks are calculated in parallel, so each chunk draws its
+            // random values from its own generator seeded by this
+            const auto batch_seed = generator();
+
 #ifndef __MULTITHREADING_IN_USE__
             long first = 0, last = numchunks;
 #else
             NTL_EXEC_RANGE(numchunks, first, last);
 #endif            
 
+            // records of the following chunks are loaded while this chunk is calculated
+            RecordPrefetcher prefetcher(encdata_dir, pubkey, chunks, first, last);
+            prefetcher.start();
+
             for (long i = first; i < last; ++i)
             {
-
-                for (size_t j = 0; j < chunks[i].size(); ++j)
+                if (std::all_of(cancel_flags.begin(), cancel_flags.end(),
+                                [](const std::shared_ptr<std::atomic<bool>>& f) { return f->load(); }))
                 {
-                    std::vector<long> posindicator_long = allzero_long;
-                    posindicator_long[j] = 1;
-                    NTL::ZZX posindicator;
-                    ea.encode(posindicator, posindicator_long);
-
-                    std::string filename =
-                        db.encdata_dirpath(key_id) + "/" + std::to_string(chunks[i][j]) + ".bin";
-                    std::ifstream fdb(filename.c_str(), std::ios::binary);
-                    Ctxt encmask(pubkey);
-                    //assert(fdb >> encmask);
-                    fdb >> encmask;
-                    fdb.close();
-                    
-                    encmask.multByConstant(posindicator);
-                    chunk_res[i].addCtxt(encmask, false);
+                    break;
                 }
 
-                chunk_res[i].addCtxt(query_mask, true);
+                std::vector<Ctxt> encmasks;
+                prefetcher.pop(encmasks);
 
-                std::vector<Ctxt> rangemul;
-                for (int diff = -5; diff <= 5; ++diff)
-                {
-                    Ctxt diffed(pubkey);
-                    diffed = chunk_res[i];
-                    diffed.addConstant(NTL::to_ZZX(diff));
-                    rangemul.push_back(diffed);
-                }
+                std::seed_seq chunk_seed{batch_seed,
+                                         static_cast<std::mt19937::result_type>(i)};
+                std::mt19937 chunk_generator(chunk_seed);
+
+                // pack the records once for all queries in the batch
+                StageTimer assemble_timer(kStageChunkAssemble);
+                Ctxt packed = allzero;
+                assembler.assemble(encmasks, packed);
+                assemble_timer.stop();
 
-                while (rangemul.size() > 1)
+                for (size_t q = 0; q < nqueries; ++q)
                 {
-                    std::vector<Ctxt> rangemul_derived;
-                    for (size_t j = 0; j < rangemul.size(); j += 2)
+                    if (*cancel_flags[q])
+                    {
+                        continue;
+                    }
+
+                    StageTimer product_timer(kStageRangeProduct);
+                    Ctxt& res = chunk_res[q][i];
+                    res = packed;
+                    res.addCtxt(query_masks[q], true);
+
+                    std::vector<Ctxt> rangemul;
+                    for (int diff = -5; diff <= 5; ++diff)
+                    {
+                        Ctxt diffed(pubkey);
+                        diffed = res;
+                        diffed.addConstant(NTL::to_ZZX(diff));
+                        rangemul.push_back(diffed);
+                    }
+
+                    while (rangemul.size() > 1)
                     {
-                        if (j + 1 < rangemul.size()) {
-                            rangemul[j].multiplyBy(rangemul[j + 1]);
+                        std::vector<Ctxt> rangemul_derived;
+                        for (size_t j = 0; j < rangemul.size(); j += 2)
+                        {
+                            if (j + 1 < rangemul.size()) {
+                                rangemul[j].multiplyBy(rangemul[j + 1]);
+                            }
+                            rangemul_derived.push_back(rangemul[j]);
+                        }
+                        rangemul = rangemul_derived;
+                    }
+
+                    res = rangemul[0];
+
+                    // records not matched by this query are replaced with
+                    // nonzero random values so that they never look like hits
+                    std::vector<long> randlist_long;
+                    for (int k = 0; k < nslots; ++k) {
+                        randlist_long.push_back(chunk_generator() % 256 + 1);
+                    }
+                    std::vector<long> unmatched_long(nslots, 0);
+                    bool has_unmatched = false;
+                    for (size_t j = 0; j < chunks[i].size(); ++j)
+                    {
+                        if (!members[q][i * SSES_DEFAULT_CHUNK_SIZE + j]) {
+                            randlist_long[j] = 0;
+                            unmatched_long[j] = chunk_generator() % 256 + 1;
+                            has_unmatched = true;
                         }
-                        rangemul_derived.push_back(rangemul[j]);
                     }
-                    rangemul = rangemul_derived;
-                }
 
-                chunk_res[i] = rangemul[0];
+                    NTL::ZZX randlist;
+                    ea.encode(randlist, randlist_long);
+                    res.multByConstant(randlist);
 
-                std::vector<long> randlist_long;
-                for (int i = 0; i < nslots; ++i) {
-                    randlist_long.push_back(generator() % 256 + 1);
+                    if (has_unmatched)
+                    {
+                        NTL::ZZX unmatched;
+                        ea.encode(unmatched, unmatched_long);
+                        res.addConstant(unmatched);
+                    }
+                    product_timer.stop();
                 }
-                NTL::ZZX randlist;
-                ea.encode(randlist, randlist_long);
-                chunk_res[i].multByConstant(randlist);
-                
+                stats_count(kCounterChunks);
             }
             
 #ifdef __MULTITHREADING_IN_USE__            
@@ -351,15 +324,39 @@ struct CalcThread::Impl
 
             LOGINFO("Complete calculation.");
 
-            sses_share::FHECtxtBuffer chunk_res_ctxtbuff;
-            chunk_res_ctxtbuff.serialize(pubkey, chunk_res);
+            for (size_t q = 0; q < nqueries; ++q)
+            {
+                const auto qid = batch[q].query_id;
+
+                if (*cancel_flags[q])
+                {
+                    in_queue_.finish(qid);
+                    LOGINFO("Query %d was canceled. Discard the calculation.", qid);
+                    continue;
+                }
+
+                StageTimer serialize_timer(kStageSerialize);
+                sses_share::FHECtxtBuffer chunk_res_ctxtbuff;
+                chunk_res_ctxtbuff.serialize(pubkey, chunk_res[q]);
+                serialize_timer.stop();
             
-            Result result(key_id, query_id, true, chunk_res_ctxtbuff, chunks);
-            out_queue_.push(query_id, result);
+                Result result(key_id, qid, true, chunk_res_ctxtbuff, chunks);
+                out_queue_.push(qid, result);
             
-            LOGINFO("Push results of each chunk to Queue.");
+                LOGINFO("Push results of each chunk to Queue. [query: %d]", qid);
+
+                if (in_queue_.finish(qid))
+                {
+                    // canceled after the last chunk boundary
+                    Result tmp;
+                    out_queue_.pop(qid, tmp);
+                    LOGINFO("Query %d was canceled. Discard the results.", qid);
+                    continue;
+                }
             
-            LOGINFO("Finish processing for query %d.", query_id);
+                stats_count(kCounterQueries);
+                LOGINFO("Finish processing for query %d.", qid);
+            }
         }
     }
 
@@ -18,7 +18,6 @@
 
 #include <cstring>
 #include <iostream>
-#include <boost/algorithm/string.hpp>
 
 #include "FHE.h"
 #include "EncryptedArray.h"
@@ -27,6 +26,7 @@
 #include <stdsc/stdsc_exception.hpp>
 #include <stdsc/stdsc_packet.hpp>
 #include <stdsc/stdsc_socket.hpp>
+#include <stdsc/stdsc_socket_stream.hpp>
 #include <stdsc/stdsc_state.hpp>
 #include <stdsc/stdsc_log.hpp>
 
@@ -34,7 +34,6 @@
 #include <sses_share/sses_encdata.hpp>
 #include <sses_share/sses_packet.hpp>
 #include <sses_share/sses_plaindata.hpp>
-#include <sses_share/sses_fhe_utility.hpp>
 #include <sses_share/sses_fhekey_container.hpp>
 #include <sses_share/sses_srv2cliparam.hpp>
 #include <sses_share/sses_fhectxt_buffer.hpp>
@@ -46,14 +45,38 @@
 #include <sses_server/sses_server_result.hpp>
 #include <sses_server/sses_server_state.hpp>
 #include <sses_server/sses_server_db.hpp>
+#include <sses_server/sses_server_db_builder.hpp>
+#include <sses_server/sses_server_aux_store.hpp>
+#include <sses_server/sses_server_stats.hpp>
 
 //#define ENABLE_LOCAL_DEBUG
 
 namespace sses_server
 {
 
+static void send_chunk_result_status(const stdsc::Socket& sock,
+                                     const sses_share::ServerResultStatus_t status)
+{
+    sses_share::PlainData<sses_share::S2CChunkResultParam> splaindata;
+    sses_share::S2CChunkResultParam s2c_param;
+    s2c_param.status = status;
+    s2c_param.key_id = -1;
+    splaindata.push(s2c_param);
+
+    auto sz = splaindata.stream_size();
+    stdsc::BufferStream sbuffstream(sz);
+    std::iostream sstream(&sbuffstream);
+
+    splaindata.save(sstream);
+
+    stdsc::Buffer* bsbuff = &sbuffstream;
+    sock.send_packet(
+      stdsc::make_data_packet(sses_share::kControlCodeDataChunkResult, sz),
+      *bsbuff);
+}
+
 // CallbackFunction for Encryption keys
-DEFUN_DATA(CallbackFunctionEncryptionKeys)
+DEFUN_STREAM(CallbackFunctionEncryptionKeys)
 {
     SSES_UTILITY_NEWLINE;
     STDSC_LOG_INFO("Receive encryption keys. (current state : %s)",
@@ -67,8 +90,7 @@ DEFUN_DATA(CallbackFunctionEncryptionKeys)
                    
     DEF_CDATA_ON_ALL(sses_server::CommonCallbackParam);
     auto& key_container = cdata_a->key_container_;
-    auto& db = cdata_a->db_;
-    auto& db_src_filepath = cdata_a->db_src_filepath_;
+    auto& db_builder = cdata_a->db_builder_;
 
     stdsc::BufferStream rbuffstream(buffer);
     std::iostream rstream(&rbuffstream);
@@ -77,27 +99,23 @@ DEFUN_DATA(CallbackFunctionEncryptionKeys)
     rplaindata.load(rstream);
     const auto param = rplaindata.data();
 
+    STDSC_THROW_CALLBACK_IF_CHECK(
+        static_cast<uint64_t>(param.context_stream_sz + param.pubkey_stream_sz)
+        == stream_size,
+        "Err: size of encryption keys mismatched.");
+
     key_container.setup(param.key_id);
     const auto context_filepath = key_container.filepath(param.key_id,
                                                          sses_share::KeyKind_t::kKindContext);
     const auto pubkey_filepath = key_container.filepath(param.key_id,
                                                         sses_share::KeyKind_t::kKindPubKey);
     
-    sses_share::fhe_utility::read_from_binary_stream(rstream, rbuffstream.data(),
-                                                     param.context_stream_sz,
-                                                     context_filepath);
-    sses_share::fhe_utility::read_from_binary_stream(rstream, rbuffstream.data(),
-                                                     param.pubkey_stream_sz,
-                                                     pubkey_filepath);
+    // key files follow the param on the socket, write them straight to disk
+    sock.recv_file(context_filepath, param.context_stream_sz);
+    sock.recv_file(pubkey_filepath, param.pubkey_stream_sz);
 
-    auto context = key_container.get_context(param.key_id);
-    FHEPubKey pubkey(context);
-    key_container.get(param.key_id, sses_share::KeyKind_t::kKindPubKey, pubkey);
-    
-    // setup DB
-    if (!db.is_enable(param.key_id)) {
-        db.setup(param.key_id, db_src_filepath, context, pubkey);
-    }
+    // setup DB in background. clients poll the status until it is ready.
+    db_builder.request(param.key_id);
                                      
     STDSC_LOG_INFO("Finish encryption key registration. "
                    "[keyID:%d, context_sz:%ld, pubkey_sz:%ld]",
@@ -109,7 +127,7 @@ DEFUN_DATA(CallbackFunctionEncryptionKeys)
 }
 
 // CallbackFunction for Query
-DEFUN_UPDOWNLOAD(CallbackFunctionQuery)
+DEFUN_STREAM(CallbackFunctionQuery)
 {
     SSES_UTILITY_NEWLINE;
     STDSC_LOG_INFO("Received query. (current state : %s)",
@@ -125,6 +143,7 @@ DEFUN_UPDOWNLOAD(CallbackFunctionQuery)
     auto& calc_manager = cdata_a->calc_manager_;
     auto& key_container = cdata_a->key_container_;
     auto& db = cdata_a->db_;
+    auto& db_builder = cdata_a->db_builder_;
 
     stdsc::BufferStream rbuffstream(buffer);
     std::iostream rstream(&rbuffstream);
@@ -132,12 +151,13 @@ DEFUN_UPDOWNLOAD(CallbackFunctionQuery)
     sses_share::PlainData<sses_share::C2SQueryParam> rplaindata;
     rplaindata.load(rstream);
     const auto& param = rplaindata.data();
+
+    std::vector<char> comp_param_buff(param.comp_param_stream_sz);
+    rstream.read(comp_param_buff.data(), comp_param_buff.size());
+    sses_share::ComputationParam comp_param;
+    sses_share::decode(comp_param_buff.data(), comp_param_buff.size(), comp_param);
     
-    STDSC_LOG_INFO(" Query: [age: %lu, gender: %s, meds: %s, sides: %s]",
-                   param.comp_param.age,
-                   param.comp_param.gender,
-                   param.comp_param.meds,
-                   param.comp_param.sides);
+    STDSC_LOG_INFO(" Query: [%s]", comp_param.to_string().c_str());
                    
     STDSC_LOG_INFO(" keyID: %d, Encryption mask sz: %lu",
                    param.key_id, param.encdata_stream_sz);
@@ -147,20 +167,48 @@ DEFUN_UPDOWNLOAD(CallbackFunctionQuery)
     FHEPubKey pubkey(context);
     key_container.get(param.key_id, sses_share::KeyKind_t::kKindPubKey, pubkey);
 
+    // ciphertexts are decoded while the rest is still on the wire
+    stdsc::SocketStreamBuf encmask_streambuf(sock, stream_size);
+    std::istream encmask_stream(&encmask_streambuf);
     sses_share::EncData encmask(pubkey);
-    encmask.load(rstream);
+    encmask.load(encmask_stream);
 
     sses_share::FHECtxtBuffer encmask_ctxtbuff;
     encmask_ctxtbuff.serialize(pubkey, encmask.vdata());
-    Query query(param.key_id, param.comp_param, encmask_ctxtbuff, &key_container, &db);
+    Query query(param.key_id, comp_param, encmask_ctxtbuff, &key_container, &db);
+
+    // the DB of the key is not evicted while the query holds the lease.
+    // if it is not ready, it is set up in background and the query is rejected.
+    int32_t query_id = -1;
+    uint64_t estimated_cost = 0;
+    uint32_t progress = 0;
+    auto db_status = db_builder.status(param.key_id, progress);
+    if (db_status == sses_share::kDBStatusReady) {
+        query_id = calc_manager.push_query(query, estimated_cost);
+        STDSC_LOG_INFO("Put query in Queue of computation thread. [queryID: %d, cost: %lu]",
+                       query_id, estimated_cost);
+    } else {
+        db_builder.request(param.key_id);
+        db_status = db_builder.status(param.key_id, progress);
+        STDSC_LOG_WARN("Rejected query because DB of the key is not ready. "
+                       "[keyID:%d, status:%d, progress:%u%%]",
+                       param.key_id, db_status, progress);
+    }
 
-    auto query_id = calc_manager.push_query(query);
-    STDSC_LOG_INFO("Put query in Queue of computation thread. [queryID: %d]", query_id);
+    // remember the query to cancel it when the connection is closed
+    DEF_CDATA_ON_EACH(sses_server::CallbackParam);
+    if (query_id >= 0) {
+        cdata_e->set_query_id(query_id);
+    }
 
     STDSC_LOG_INFO("Start sending query ID. [queryID: %d]", query_id);
     
-    sses_share::PlainData<int32_t> splaindata;
-    splaindata.push(query_id);
+    sses_share::PlainData<sses_share::S2CQueryAckParam> splaindata;
+    sses_share::S2CQueryAckParam s2c_param;
+    s2c_param.query_id = query_id;
+    s2c_param.estimated_cost = estimated_cost;
+    s2c_param.db_status = db_status;
+    splaindata.push(s2c_param);
 
     auto sz = splaindata.stream_size();
     stdsc::BufferStream sbuffstream(sz);
@@ -170,8 +218,8 @@ DEFUN_UPDOWNLOAD(CallbackFunctionQuery)
 
     stdsc::Buffer* bsbuff = &sbuffstream;
     sock.send_packet(
-      stdsc::make_data_packet(sses_share::kControlCodeDataQueryID, sz));
-    sock.send_buffer(*bsbuff);
+      stdsc::make_data_packet(sses_share::kControlCodeDataQueryID, sz),
+      *bsbuff);
 
     STDSC_LOG_INFO("Finish sending query ID. [queryID: %d]", query_id);
 
@@ -187,13 +235,14 @@ DEFUN_UPDOWNLOAD(CallbackFunctionChunkResultRequest)
     STDSC_LOG_INFO("Received request for the result of each chunk. (current state : %s)",
                    state.current_state_str().c_str());
 
+    // a connection may have several queries outstanding, so whether the
+    // query is known is checked by the calculation manager
     STDSC_THROW_CALLBACK_IF_CHECK(
-        kStateComputing <= state.current_state(),
-        "Warn: must be ComputingState to receive chunk result request.");
+        kStateReady <= state.current_state(),
+        "Warn: must be ReadyState to receive chunk result request.");
 
     DEF_CDATA_ON_ALL(sses_server::CommonCallbackParam);
     auto& calc_manager = cdata_a->calc_manager_;
-    auto& key_container = cdata_a->key_container_;
 
     stdsc::BufferStream rbuffstream(buffer);
     std::iostream rstream(&rbuffstream);
@@ -205,11 +254,28 @@ DEFUN_UPDOWNLOAD(CallbackFunctionChunkResultRequest)
     STDSC_LOG_INFO("Start proccesing requests for the result of each chunk for queryID %d.",
                    param.query_id);
 
+    DEF_CDATA_ON_EACH(sses_server::CallbackParam);
+
+    // polling clients are answered at once while the query is computed
+    if (!param.wait && calc_manager.is_computing(param.query_id))
+    {
+        STDSC_LOG_INFO("The queryID %d is not computed yet.", param.query_id);
+        send_chunk_result_status(sock, sses_share::kServerResultStatusPending);
+        return;
+    }
+
     STDSC_LOG_INFO("Waiting for each chunk for queryID %d to complete its comuptation.",
                    param.query_id);
-    
+
     Result result;
-    calc_manager.pop_result(param.query_id, result);
+    if (!calc_manager.pop_result(param.query_id, result))
+    {
+        STDSC_LOG_WARN("The queryID %d is unknown or canceled.", param.query_id);
+        send_chunk_result_status(sock, sses_share::kServerResultStatusFailed);
+        cdata_e->clear_query_id(param.query_id);
+        state.set(kEventCancelQuery);
+        return;
+    }
     
     STDSC_LOG_INFO("Get the result of each chunk for queryID %d. [keyID: %d, status: %d]",
                    param.query_id,
@@ -218,6 +284,7 @@ DEFUN_UPDOWNLOAD(CallbackFunctionChunkResultRequest)
 
     STDSC_LOG_INFO("Start sending the result of each chunk for queryID %d", param.query_id);
     
+    StageTimer send_timer(kStageSend);
     sses_share::PlainData<sses_share::S2CChunkResultParam> splaindata;
     sses_share::S2CChunkResultParam s2c_param;
     s2c_param.status = result.status_ ? sses_share::kServerResultStatusSuccess
@@ -225,25 +292,22 @@ DEFUN_UPDOWNLOAD(CallbackFunctionChunkResultRequest)
     s2c_param.key_id = result.key_id_;
     splaindata.push(s2c_param);
 
-    auto context = key_container.get_context(result.key_id_);
-    FHEPubKey pubkey(context);
-    key_container.get(result.key_id_, sses_share::KeyKind_t::kKindPubKey, pubkey);
-
-    std::vector<Ctxt> ctxts;
-    result.chunk_res_.deserialize(pubkey, ctxts);
-    sses_share::EncData enc_results(pubkey, ctxts);
-
-    auto sz = splaindata.stream_size() + enc_results.stream_size();
-    stdsc::BufferStream sbuffstream(sz);
+    // the results are held as saved by EncData, so they follow the param
+    // as they are, straight from the spill file if spilled
+    auto head_sz = splaindata.stream_size();
+    auto sz = head_sz + result.chunk_res_.size();
+    stdsc::BufferStream sbuffstream(head_sz);
     std::iostream sstream(&sbuffstream);
 
     splaindata.save(sstream);
-    enc_results.save(sstream);
 
     stdsc::Buffer* bsbuff = &sbuffstream;
     sock.send_packet(
-      stdsc::make_data_packet(sses_share::kControlCodeDataChunkResult, sz));
-    sock.send_buffer(*bsbuff);
+      stdsc::make_data_packet(sses_share::kControlCodeDataChunkResult, sz),
+      *bsbuff);
+    result.chunk_res_.send(sock);
+    send_timer.stop();
+    stats_count(kCounterBytesSent, sz);
 
     STDSC_LOG_INFO("Finish sending the result of each chunk for queryID %d", param.query_id);
 
@@ -263,8 +327,8 @@ DEFUN_UPDOWNLOAD(CallbackFunctionChunkResultRequest)
 #endif
     
     // save chunks size for 'Computed state'
-    DEF_CDATA_ON_EACH(sses_server::CallbackParam);
-    cdata_e->set_chunks(result.chunks_);
+    cdata_e->set_chunks(param.query_id, result.chunks_);
+    cdata_e->clear_query_id(param.query_id);
 
     state.set(kEventChunkResult);
 }
@@ -277,14 +341,13 @@ DEFUN_UPDOWNLOAD(CallbackFunctionResultRequest)
                    state.current_state_str().c_str());
 
     STDSC_THROW_CALLBACK_IF_CHECK(
-        kStateComputed <= state.current_state(),
-        "Warn: must be ComputedState to receive result request.");
+        kStateReady <= state.current_state(),
+        "Warn: must be ReadyState to receive result request.");
 
     DEF_CDATA_ON_ALL(sses_server::CommonCallbackParam);
     auto& db = cdata_a->db_;
 
     DEF_CDATA_ON_EACH(sses_server::CallbackParam);
-    const auto& chunks = cdata_e->chunks();
     
     stdsc::BufferStream rbuffstream(buffer);
     std::iostream rstream(&rbuffstream);
@@ -297,6 +360,8 @@ DEFUN_UPDOWNLOAD(CallbackFunctionResultRequest)
     rplaindata_selinfo.load(rstream);
     const auto& selinfo = rplaindata_selinfo.vdata();
 
+    const auto& chunks = cdata_e->chunks(param.query_id);
+
     STDSC_LOG_INFO("Start proccesing result request for queryID %d. [Num of selected info:%lu, keyID:%d]",
                    param.query_id, selinfo.size(), param.key_id);
 
@@ -313,7 +378,7 @@ DEFUN_UPDOWNLOAD(CallbackFunctionResultRequest)
         size_t i = v.chunk_id;
         size_t j = v.pos_id;
         
-        if (j < chunks[i].size()) {
+        if (i < chunks.size() && j < chunks[i].size()) {
             choice_list.push_back(std::make_pair(i, j));
         }
     }
@@ -338,59 +403,26 @@ DEFUN_UPDOWNLOAD(CallbackFunctionResultRequest)
     s2c_param.medIds.resize(numRes);
     s2c_param.sideIds.resize(numRes);
 
-    size_t tableIndex = 0;
-    std::vector<size_t>* numTable[2] = {&s2c_param.numMeds, &s2c_param.numSides};
-    std::vector<std::vector<int32_t>>* idTable[2] = {&s2c_param.medIds, &s2c_param.sideIds};
-    
-    int record_id;
-    std::vector<std::string> tmp;
-    std::string auxdata_path, line, cutted_line;
-    size_t begin_idx, end_idx;
-
-    auto auxdir = db.auxdata_dirpath(param.key_id) + "/";
+    // e.g. a layer of an older version is being built again
+    STDSC_THROW_CALLBACK_IF_CHECK(
+        db.is_enable(param.key_id),
+        "Warn: DB of the key is not ready. (keyID: " + std::to_string(param.key_id) + ")");
+    auto aux = db.aux(param.key_id);
 
     for (size_t i = 0; i < numRes; ++i)
     {
-        record_id = chunks[choice_list[i].first][choice_list[i].second];
+        int record_id = chunks[choice_list[i].first][choice_list[i].second];
         s2c_param.recordIds[i] = record_id;
 
-        auxdata_path = auxdir + std::to_string(record_id) + ".bin";
-        std::ifstream auxdata_ifs(auxdata_path, std::ios::binary);
-
-        size_t loop = 0;
-        while (std::getline(auxdata_ifs, line))
-        {
-            auto& nums = *numTable[tableIndex];
-            auto& ids = *idTable[tableIndex];
-
-            begin_idx = line.find("[");
-            end_idx = line.find("]");
-            cutted_line =
-                line.substr(begin_idx + 1, end_idx - begin_idx - 1);
-            boost::algorithm::split(tmp, cutted_line,
-                                    boost::is_any_of(","));
-
-            nums[i] = tmp.size();
+        sses_server::AuxStore::Entry entry;
+        STDSC_THROW_CALLBACK_IF_CHECK(
+            aux->find(record_id, entry),
+            "Err: aux data not found. (recordID: " + std::to_string(record_id) + ")");
 
-            ids[i].resize(tmp.size());
-
-            size_t ids_index = 0;
-            for (std::string s : tmp)
-            {
-                size_t idx = s.find(" ");
-                if (idx != std::string::npos)
-                {
-                    s.erase(idx, 1);
-                }
-
-                ids[i][ids_index] = stoi(s);
-                ++ids_index;
-            }
-
-            tableIndex = 1 - tableIndex;
-
-            ++loop;
-        }
+        s2c_param.numMeds[i] = entry.num_meds;
+        s2c_param.medIds[i].assign(entry.meds, entry.meds + entry.num_meds);
+        s2c_param.numSides[i] = entry.num_sides;
+        s2c_param.sideIds[i].assign(entry.sides, entry.sides + entry.num_sides);
     }
     
 #ifdef ENABLE_LOCAL_DEBUG
@@ -398,24 +430,20 @@ DEFUN_UPDOWNLOAD(CallbackFunctionResultRequest)
     std::cout << s2c_param;
 #endif
     
-    auto sz = 0;
-    {
-        std::ostringstream oss;
-        oss << s2c_param;
-        sz = oss.str().size();
-    }
-    stdsc::BufferStream sbuffstream(sz);
-    std::iostream sstream(&sbuffstream);
+    StageTimer send_timer(kStageSend);
+    auto sz = sses_share::encoded_size(s2c_param);
+    stdsc::Buffer sbuff(sz);
+    sses_share::encode(s2c_param, sbuff.data());
 
-    sstream << s2c_param;
-
-    stdsc::Buffer* bsbuff = &sbuffstream;
     sock.send_packet(
-      stdsc::make_data_packet(sses_share::kControlCodeDataResult, sz));
-    sock.send_buffer(*bsbuff);
+      stdsc::make_data_packet(sses_share::kControlCodeDataResult, sz),
+      sbuff);
+    send_timer.stop();
+    stats_count(kCounterBytesSent, sz);
     
     STDSC_LOG_INFO("Finish sending results.");
 
+    cdata_e->clear_chunks(param.query_id);
     state.set(kEventResult);
 }
 
@@ -428,10 +456,257 @@ DEFUN_DATA(CallbackFunctionCancelQuery)
     STDSC_THROW_CALLBACK_IF_CHECK(
         kStateReady <= state.current_state(),
         "Warn: must be ReadyState to receive result request.");
-    
-    STDSC_LOG_INFO("Canceled query.");
+
+    DEF_CDATA_ON_ALL(sses_server::CommonCallbackParam);
+    auto& calc_manager = cdata_a->calc_manager_;
+
+    DEF_CDATA_ON_EACH(sses_server::CallbackParam);
+
+    // the query ID may be omitted to cancel the last query of this connection
+    int32_t query_id = cdata_e->query_id();
+    if (buffer.size() > 0)
+    {
+        stdsc::BufferStream rbuffstream(buffer);
+        std::iostream rstream(&rbuffstream);
+
+        sses_share::PlainData<sses_share::C2SCancelParam> rplaindata;
+        rplaindata.load(rstream);
+        query_id = rplaindata.data().query_id;
+    }
+
+    if (query_id >= 0 && calc_manager.cancel_query(query_id))
+    {
+        STDSC_LOG_INFO("Canceled query. [queryID: %d]", query_id);
+    }
+    else
+    {
+        STDSC_LOG_INFO("No query to cancel. [queryID: %d]", query_id);
+    }
+
+    cdata_e->clear_query_id(query_id);
+    cdata_e->clear_chunks(query_id);
 
     state.set(kEventCancelQuery);
 }
 
+// CallbackFunction for Append records
+DEFUN_UPDOWNLOAD(CallbackFunctionAppendRecords)
+{
+    SSES_UTILITY_NEWLINE;
+    STDSC_LOG_INFO("Received records to append. (current state : %s)",
+                   state.current_state_str().c_str());
+
+    STDSC_THROW_CALLBACK_IF_CHECK(
+        kStateConnected <= state.current_state(),
+        "Warn: must be ConnectedState to receive records.");
+
+    DEF_CDATA_ON_ALL(sses_server::CommonCallbackParam);
+    auto& db_builder = cdata_a->db_builder_;
+
+    stdsc::BufferStream rbuffstream(buffer);
+    std::iostream rstream(&rbuffstream);
+
+    sses_share::PlainData<sses_share::C2SAppendParam> rplaindata;
+    rplaindata.load(rstream);
+    const auto param = rplaindata.data();
+
+    std::string delta_csv(param.csv_stream_sz, '\0');
+    rstream.read(&delta_csv[0], param.csv_stream_sz);
+
+    // the records are encrypted on the appender thread, beside the setups
+    // of keys
+    sses_share::S2CAppendResultParam s2c_param{sses_share::kServerResultStatusSuccess, 0, 0, 0, 0};
+    sses_share::PlainData<int32_t> conflictdata;
+    try
+    {
+        auto result = db_builder.append(delta_csv).get();
+        s2c_param.num_applied = result.num_applied;
+        s2c_param.num_skipped = result.num_skipped;
+        s2c_param.num_keys = static_cast<uint32_t>(result.num_keys);
+        s2c_param.num_conflicts = static_cast<uint32_t>(result.conflict_ids.size());
+        for (const auto id : result.conflict_ids) {
+            conflictdata.push(id);
+        }
+        if (!result.conflict_ids.empty()) {
+            s2c_param.status = sses_share::kServerResultStatusFailed;
+        }
+        STDSC_LOG_INFO("Finish appending records. [appended:%lu, skipped:%lu, keys:%lu, conflicts:%lu]",
+                       result.num_applied, result.num_skipped, result.num_keys,
+                       result.conflict_ids.size());
+    }
+    catch (const std::exception& e)
+    {
+        STDSC_LOG_WARN("Failed to append records. (%s)", e.what());
+        s2c_param.status = sses_share::kServerResultStatusFailed;
+    }
+
+    sses_share::PlainData<sses_share::S2CAppendResultParam> splaindata;
+    splaindata.push(s2c_param);
+
+    auto sz = splaindata.stream_size();
+    if (s2c_param.num_conflicts > 0) {
+        sz += conflictdata.stream_size();
+    }
+    stdsc::BufferStream sbuffstream(sz);
+    std::iostream sstream(&sbuffstream);
+
+    splaindata.save(sstream);
+    if (s2c_param.num_conflicts > 0) {
+        conflictdata.save(sstream);
+    }
+
+    stdsc::Buffer* bsbuff = &sbuffstream;
+    sock.send_packet(
+      stdsc::make_data_packet(sses_share::kControlCodeDataAppendRecords, sz),
+      *bsbuff);
+}
+
+// CallbackFunction for Query status request
+DEFUN_UPDOWNLOAD(CallbackFunctionQueryStatus)
+{
+    STDSC_THROW_CALLBACK_IF_CHECK(
+        kStateReady <= state.current_state(),
+        "Warn: must be ReadyState to receive query status request.");
+
+    DEF_CDATA_ON_ALL(sses_server::CommonCallbackParam);
+    auto& calc_manager = cdata_a->calc_manager_;
+
+    stdsc::BufferStream rbuffstream(buffer);
+    std::iostream rstream(&rbuffstream);
+
+    sses_share::PlainData<sses_share::C2SQueryStatusParam> rplaindata;
+    rplaindata.load(rstream);
+
+    // clients poll all their queries at once. the results of queries no
+    // longer computed are requested next, which reports unknown ones.
+    sses_share::PlainData<sses_share::S2CQueryStatusParam> splaindata;
+    for (const auto& param : rplaindata.vdata()) {
+        sses_share::S2CQueryStatusParam s2c_param;
+        s2c_param.query_id = param.query_id;
+        s2c_param.status = calc_manager.is_computing(param.query_id)
+            ? sses_share::kServerResultStatusPending
+            : sses_share::kServerResultStatusSuccess;
+        splaindata.push(s2c_param);
+    }
+
+    STDSC_LOG_TRACE("Send query status. [queries:%lu]", splaindata.vdata().size());
+
+    auto sz = splaindata.stream_size();
+    stdsc::BufferStream sbuffstream(sz);
+    std::iostream sstream(&sbuffstream);
+
+    splaindata.save(sstream);
+
+    stdsc::Buffer* bsbuff = &sbuffstream;
+    sock.send_packet(
+      stdsc::make_data_packet(sses_share::kControlCodeDataQueryStatus, sz),
+      *bsbuff);
+}
+
+// CallbackFunction for DB status request
+DEFUN_UPDOWNLOAD(CallbackFunctionDBStatus)
+{
+    DEF_CDATA_ON_ALL(sses_server::CommonCallbackParam);
+    auto& db_builder = cdata_a->db_builder_;
+
+    stdsc::BufferStream rbuffstream(buffer);
+    std::iostream rstream(&rbuffstream);
+
+    sses_share::PlainData<sses_share::C2SDBStatusParam> rplaindata;
+    rplaindata.load(rstream);
+    const auto param = rplaindata.data();
+
+    sses_share::PlainData<sses_share::S2CDBStatusParam> splaindata;
+    sses_share::S2CDBStatusParam s2c_param;
+    s2c_param.status = db_builder.status(param.key_id, s2c_param.progress);
+    splaindata.push(s2c_param);
+
+    STDSC_LOG_TRACE("Send DB status. [keyID:%d, status:%d, progress:%u%%]",
+                    param.key_id, s2c_param.status, s2c_param.progress);
+
+    auto sz = splaindata.stream_size();
+    stdsc::BufferStream sbuffstream(sz);
+    std::iostream sstream(&sbuffstream);
+
+    splaindata.save(sstream);
+
+    stdsc::Buffer* bsbuff = &sbuffstream;
+    sock.send_packet(
+      stdsc::make_data_packet(sses_share::kControlCodeDataDBStatus, sz),
+      *bsbuff);
+}
+
+// CallbackFunction for Stats request
+DEFUN_DOWNLOAD(CallbackFunctionStats)
+{
+    DEF_CDATA_ON_ALL(sses_server::CommonCallbackParam);
+    auto& calc_manager = cdata_a->calc_manager_;
+    auto& db = cdata_a->db_;
+    const auto* server = cdata_a->server_;
+
+    std::vector<Gauge> gauges = {
+        {"sses_connections", "Open connections.",
+         static_cast<double>(server ? server->num_connections() : 0)},
+        {"sses_queued_queries", "Queries waiting in queue.",
+         static_cast<double>(calc_manager.num_queued_queries())},
+        {"sses_running_queries", "Queries being calculated.",
+         static_cast<double>(calc_manager.num_running_queries())},
+        {"sses_held_results", "Results held until the clients receive them.",
+         static_cast<double>(calc_manager.num_results())},
+        {"sses_held_result_bytes", "Bytes of results held in memory.",
+         static_cast<double>(calc_manager.held_result_bytes())},
+        {"sses_spilled_result_bytes", "Bytes of results spilled to files.",
+         static_cast<double>(calc_manager.spilled_result_bytes())},
+    };
+
+    const auto usage = db.usage();
+    gauges.push_back({"sses_db_total_bytes", "Bytes of the encrypted data of all keys.",
+                      static_cast<double>(usage.total_bytes)});
+    gauges.push_back({"sses_db_max_bytes", "Disk budget of the encrypted data (0: unlimited).",
+                      static_cast<double>(usage.max_bytes)});
+    for (const auto& key : usage.keys) {
+        gauges.push_back({"sses_db_key_bytes", "Bytes of the encrypted data of key (0: evicted).",
+                          static_cast<double>(key.bytes),
+                          "key_id=\"" + std::to_string(key.key_id) + "\""});
+    }
+    for (const auto& key : usage.keys) {
+        gauges.push_back({"sses_db_key_last_used_seconds",
+                          "Unix time the key was last used by query.",
+                          static_cast<double>(key.last_used),
+                          "key_id=\"" + std::to_string(key.key_id) + "\""});
+    }
+    const auto text = stats_to_prometheus(gauges);
+
+    STDSC_LOG_TRACE("Send stats. [%lu bytes]", text.size());
+
+    stdsc::Buffer sbuff(text.size());
+    std::memcpy(sbuff.data(), text.data(), text.size());
+    sock.send_packet(
+      stdsc::make_data_packet(sses_share::kControlCodeDataStats, text.size()),
+      sbuff);
+}
+
+// CallbackFunction for Disconnect
+DEFUN_REQUEST(CallbackFunctionDisconnect)
+{
+    DEF_CDATA_ON_ALL(sses_server::CommonCallbackParam);
+    auto& calc_manager = cdata_a->calc_manager_;
+
+    DEF_CDATA_ON_EACH(sses_server::CallbackParam);
+    const auto query_ids = cdata_e->query_ids();
+
+    STDSC_LOG_INFO("Client disconnected. [outstanding queries: %lu]",
+                   query_ids.size());
+
+    // nobody can receive the results of this connection anymore
+    for (const auto query_id : query_ids)
+    {
+        if (calc_manager.cancel_query(query_id))
+        {
+            STDSC_LOG_INFO("Canceled query of closed connection. [queryID: %d]", query_id);
+        }
+        cdata_e->clear_query_id(query_id);
+    }
+}
+
 } /* namespace sses_server */
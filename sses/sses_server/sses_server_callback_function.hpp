@@ -26,12 +26,12 @@ namespace sses_server
 /**
  * @brief Provides callback function in receiving encryption keys.
  */
-DECLARE_DATA_CLASS(CallbackFunctionEncryptionKeys);
+DECLARE_STREAM_CLASS(CallbackFunctionEncryptionKeys);
 
 /**
  * @brief Provides callback function in receiving query.
  */
-DECLARE_UPDOWNLOAD_CLASS(CallbackFunctionQuery);
+DECLARE_STREAM_CLASS(CallbackFunctionQuery);
 
 /**
  * @brief Provides callback function in receiving chunk result request.
@@ -48,6 +48,32 @@ DECLARE_UPDOWNLOAD_CLASS(CallbackFunctionResultRequest);
  */
 DECLARE_DATA_CLASS(CallbackFunctionCancelQuery);
 
+/**
+ * @brief Provides callback function in receiving records to append.
+ */
+DECLARE_UPDOWNLOAD_CLASS(CallbackFunctionAppendRecords);
+
+/**
+ * @brief Provides callback function in receiving query status request.
+ */
+DECLARE_UPDOWNLOAD_CLASS(CallbackFunctionQueryStatus);
+
+/**
+ * @brief Provides callback function in receiving DB status request.
+ */
+DECLARE_UPDOWNLOAD_CLASS(CallbackFunctionDBStatus);
+
+/**
+ * @brief Provides callback function in receiving stats request.
+ * The statistics are sent in the Prometheus text format.
+ */
+DECLARE_DOWNLOAD_CLASS(CallbackFunctionStats);
+
+/**
+ * @brief Provides callback function in disconnecting client.
+ */
+DECLARE_REQUEST_CLASS(CallbackFunctionDisconnect);
+
 
 } /* namespace sses_server */
 
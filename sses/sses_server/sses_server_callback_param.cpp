@@ -15,6 +15,8 @@
  * limitations under the License.
  */
 
+#include <algorithm>
+
 #include <sses_server/sses_server_callback_param.hpp>
 
 namespace sses_server
@@ -24,28 +26,44 @@ namespace sses_server
 CallbackParam::CallbackParam(void)
 {}
 
-void CallbackParam::set_chunks(const std::vector<std::vector<int>>& chunks)
+void CallbackParam::set_chunks(const int32_t query_id,
+                               const std::vector<std::vector<int>>& chunks)
 {
-    clear_chunks();
-
-    chunks_.resize(chunks.size());
-    for (size_t i=0; i<chunks.size(); ++i) {
-        auto& dst = chunks_[i];
-        const auto& src = chunks[i];
-        
-        dst.resize(src.size());
-        std::copy(src.begin(), src.end(), dst.begin());
-    }
+    chunks_[query_id] = chunks;
 }
     
-void CallbackParam::clear_chunks()
+void CallbackParam::clear_chunks(const int32_t query_id)
 {
-    chunks_.clear();
+    chunks_.erase(query_id);
 }
     
-const std::vector<std::vector<int>>& CallbackParam::chunks() const
+const std::vector<std::vector<int>>& CallbackParam::chunks(const int32_t query_id) const
+{
+    static const std::vector<std::vector<int>> empty;
+    auto it = chunks_.find(query_id);
+    return (it != chunks_.end()) ? it->second : empty;
+}
+
+void CallbackParam::set_query_id(const int32_t query_id)
+{
+    clear_query_id(query_id);
+    query_ids_.push_back(query_id);
+}
+
+void CallbackParam::clear_query_id(const int32_t query_id)
+{
+    query_ids_.erase(std::remove(query_ids_.begin(), query_ids_.end(), query_id),
+                     query_ids_.end());
+}
+
+int32_t CallbackParam::query_id() const
+{
+    return query_ids_.empty() ? -1 : query_ids_.back();
+}
+
+std::vector<int32_t> CallbackParam::query_ids() const
 {
-    return chunks_;
+    return query_ids_;
 }
 
 } /* namespace sses_server */
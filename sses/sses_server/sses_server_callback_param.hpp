@@ -18,10 +18,13 @@
 #ifndef SSES_SERVER_CALLBACK_PARAM_HPP
 #define SSES_SERVER_CALLBACK_PARAM_HPP
 
+#include <map>
 #include <memory>
 #include <string>
 #include <vector>
 
+#include <stdsc/stdsc_server.hpp>
+
 namespace sses_share
 {
 class FHEKeyContainer;
@@ -32,6 +35,7 @@ namespace sses_server
 
 class CalcManager;
 class DB;
+class DBBuilder;
 
 /**
  * @brief This class is used to hold the callback parameters for Server.
@@ -40,14 +44,31 @@ class DB;
 struct CallbackParam
 {
     CallbackParam(void);
+    CallbackParam(const CallbackParam&) = delete;
     virtual ~CallbackParam(void) = default;
 
-    void set_chunks(const std::vector<std::vector<int>>& chunks);
-    void clear_chunks();
-    const std::vector<std::vector<int>>& chunks() const;
+    /**
+     * Chunks of record IDs of the query whose results were sent, kept
+     * until the client requests the records.
+     * A connection may have several queries outstanding.
+     */
+    void set_chunks(const int32_t query_id,
+                    const std::vector<std::vector<int>>& chunks);
+    void clear_chunks(const int32_t query_id);
+    const std::vector<std::vector<int>>& chunks(const int32_t query_id) const;
+
+    /**
+     * Queries of this connection whose results are not sent yet.
+     * query_id() is the last one (-1 if none).
+     */
+    void set_query_id(const int32_t query_id);
+    void clear_query_id(const int32_t query_id);
+    int32_t query_id() const;
+    std::vector<int32_t> query_ids() const;
     
 private:
-    std::vector<std::vector<int>> chunks_;
+    std::map<int32_t, std::vector<std::vector<int>>> chunks_;
+    std::vector<int32_t> query_ids_;
 };
 
 /**
@@ -59,18 +80,23 @@ struct CommonCallbackParam
     CommonCallbackParam(CalcManager& calc_manager,
                         sses_share::FHEKeyContainer& key_container,
                         sses_server::DB& db,
+                        sses_server::DBBuilder& db_builder,
                         const char* db_src_filepath)
         : calc_manager_(calc_manager),
           key_container_(key_container),
           db_(db),
-          db_src_filepath_(db_src_filepath)
+          db_builder_(db_builder),
+          db_src_filepath_(db_src_filepath),
+          server_(nullptr)
     {}
     virtual ~CommonCallbackParam(void) = default;
     
     CalcManager& calc_manager_;
     sses_share::FHEKeyContainer& key_container_;
     sses_server::DB& db_;
+    sses_server::DBBuilder& db_builder_;
     std::string db_src_filepath_;
+    const stdsc::Server<>* server_; ///< server accepting the connections
 };
 
 } /* namespace sses_server */
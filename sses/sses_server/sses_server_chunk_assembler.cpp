@@ -0,0 +1,77 @@
+/*
+ * Copyright 2020 Yamana Laboratory, Waseda University
+ * Supported by JST CREST Grant Number JPMJCR1503, Japan.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE‐2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "FHE.h"
+#include "EncryptedArray.h"
+
+#include <stdsc/stdsc_exception.hpp>
+
+#include <sses_server/sses_server_chunk_assembler.hpp>
+
+namespace sses_server
+{
+
+struct ChunkAssembler::Impl
+{
+    Impl(const FHEcontext& context, const EncryptedArray& ea, const size_t chunk_size)
+    {
+        STDSC_THROW_INVPARAM_IF_CHECK(chunk_size <= static_cast<size_t>(ea.size()),
+                                      "chunk size exceeds the number of slots.");
+
+        selectors_.reserve(chunk_size);
+        std::vector<long> posindicator_long(ea.size(), 0);
+        for (size_t j = 0; j < chunk_size; ++j)
+        {
+            posindicator_long[j] = 1;
+            NTL::ZZX posindicator;
+            ea.encode(posindicator, posindicator_long);
+            selectors_.emplace_back(posindicator, context);
+            posindicator_long[j] = 0;
+        }
+    }
+
+    void assemble(std::vector<Ctxt>& records, Ctxt& acc) const
+    {
+        STDSC_THROW_INVPARAM_IF_CHECK(records.size() <= selectors_.size(),
+                                      "too many records for a chunk.");
+        for (size_t j = 0; j < records.size(); ++j)
+        {
+            records[j].multByConstant(selectors_[j]);
+            if (j == 0) {
+                acc = records[j];
+            } else {
+                acc.addCtxt(records[j], false);
+            }
+        }
+    }
+
+    std::vector<DoubleCRT> selectors_;
+};
+
+ChunkAssembler::ChunkAssembler(const FHEcontext& context,
+                               const EncryptedArray& ea,
+                               const size_t chunk_size)
+    : pimpl_(new Impl(context, ea, chunk_size))
+{
+}
+
+void ChunkAssembler::assemble(std::vector<Ctxt>& records, Ctxt& acc) const
+{
+    pimpl_->assemble(records, acc);
+}
+
+} /* namespace sses_server */
@@ -0,0 +1,66 @@
+/*
+ * Copyright 2020 Yamana Laboratory, Waseda University
+ * Supported by JST CREST Grant Number JPMJCR1503, Japan.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE‐2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SSES_SERVER_CHUNK_ASSEMBLER_HPP
+#define SSES_SERVER_CHUNK_ASSEMBLER_HPP
+
+#include <memory>
+#include <vector>
+
+class Ctxt;
+class FHEcontext;
+class EncryptedArray;
+
+namespace sses_server
+{
+
+/**
+ * @brief Packs the encrypted records of a chunk into the slots of one ctxt.
+ * The slot selectors are encoded and transformed to DoubleCRT once, so that
+ * each record costs only a multiplication in the evaluation domain and an
+ * addition to a single accumulator.
+ */
+class ChunkAssembler
+{
+public:
+    /**
+     * Constructor
+     * @param[in] context FHE context
+     * @param[in] ea encrypted array
+     * @param[in] chunk_size max number of records in a chunk
+     */
+    ChunkAssembler(const FHEcontext& context,
+                   const EncryptedArray& ea,
+                   const size_t chunk_size);
+    virtual ~ChunkAssembler() = default;
+
+    /**
+     * Assemble records
+     * @param[in,out] records encrypted records (multiplied by the selectors in place)
+     * @param[in,out] acc accumulator, j-th slot holds j-th record on return
+     * @note acc is left unchanged if records is empty.
+     */
+    void assemble(std::vector<Ctxt>& records, Ctxt& acc) const;
+
+private:
+    struct Impl;
+    std::shared_ptr<Impl> pimpl_;
+};
+
+} /* namespace sses_server */
+
+#endif /* SSES_SERVER_CHUNK_ASSEMBLER_HPP */
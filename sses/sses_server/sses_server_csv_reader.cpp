@@ -0,0 +1,279 @@
+/*
+ * Copyright 2020 Yamana Laboratory, Waseda University
+ * Supported by JST CREST Grant Number JPMJCR1503, Japan.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE‐2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <fcntl.h>
+#include <unistd.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <unordered_map>
+
+#include <stdsc/stdsc_exception.hpp>
+
+#include <sses_server/sses_server_csv_reader.hpp>
+
+namespace sses_server
+{
+
+static inline const char* find_char(const char* p, const char* end, const char c)
+{
+#ifdef __SSE2__
+    const __m128i v = _mm_set1_epi8(c);
+    while (p + 16 <= end)
+    {
+        __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        int m = _mm_movemask_epi8(_mm_cmpeq_epi8(x, v));
+        if (m) {
+            return p + __builtin_ctz(m);
+        }
+        p += 16;
+    }
+#endif
+    auto r = std::memchr(p, c, end - p);
+    return r ? static_cast<const char*>(r) : end;
+}
+
+struct CsvReader::Impl
+{
+    Impl(const std::string& filepath, const size_t block_size)
+        : fd_(::open(filepath.c_str(), O_RDONLY)),
+          buf_(std::max<size_t>(block_size, 1)),
+          cur_(buf_.data()),
+          end_(buf_.data()),
+          eof_(false),
+          bytes_(0)
+    {
+        STDSC_THROW_FILE_IF_CHECK(fd_ >= 0, "failed to open. (" + filepath + ")");
+        read_header();
+    }
+
+    Impl(const char* data, const size_t size)
+        : fd_(-1),
+          cur_(data),
+          end_(data + size),
+          eof_(true),
+          bytes_(0)
+    {
+        read_header();
+    }
+
+    ~Impl()
+    {
+        if (fd_ >= 0) {
+            ::close(fd_);
+        }
+    }
+
+    size_t column(const std::string& name) const
+    {
+        auto it = columns_.find(name);
+        STDSC_THROW_INVPARAM_IF_CHECK(it != columns_.end(),
+                                      "column not found in CSV header. (" + name + ")");
+        return it->second;
+    }
+
+    bool next(std::vector<Field>& fields)
+    {
+        const char* line_end;
+        while (true)
+        {
+            if (!next_line(line_end)) {
+                return false;
+            }
+            if (line_end == cur_ || (line_end - cur_ == 1 && *cur_ == '\r')) {
+                consume(line_end); // empty line
+                continue;
+            }
+            break;
+        }
+
+        const char* p = cur_;
+        const char* e = line_end;
+        if (e > p && *(e - 1) == '\r') {
+            --e;
+        }
+
+        fields.clear();
+        const char* base = p;
+#ifdef __SSE2__
+        // fields are short, so each 16 bytes are compared once and the
+        // commas are taken from the bit mask
+        const __m128i comma = _mm_set1_epi8(',');
+        for (; base + 16 <= e; base += 16)
+        {
+            __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(base));
+            int m = _mm_movemask_epi8(_mm_cmpeq_epi8(x, comma));
+            while (m)
+            {
+                const char* q = base + __builtin_ctz(m);
+                fields.push_back(Field{p, static_cast<size_t>(q - p)});
+                p = q + 1;
+                m &= m - 1;
+            }
+        }
+#endif
+        for (; base < e; ++base)
+        {
+            if (*base == ',') {
+                fields.push_back(Field{p, static_cast<size_t>(base - p)});
+                p = base + 1;
+            }
+        }
+        fields.push_back(Field{p, static_cast<size_t>(e - p)});
+
+        consume(line_end);
+        return true;
+    }
+
+    size_t bytes_read() const
+    {
+        return bytes_;
+    }
+
+private:
+    void read_header()
+    {
+        std::vector<Field> fields;
+        if (!next(fields)) {
+            return;
+        }
+        for (size_t i = 0; i < fields.size(); ++i) {
+            columns_.emplace(std::string(fields[i].data, fields[i].size), i);
+        }
+    }
+
+    void consume(const char* line_end)
+    {
+        auto next = (line_end < end_) ? line_end + 1 : line_end;
+        bytes_ += next - cur_;
+        cur_ = next;
+    }
+
+    /**
+     * Find the end of the current line, reading more input if needed
+     */
+    bool next_line(const char*& line_end)
+    {
+        size_t scanned = 0;
+        while (true)
+        {
+            line_end = find_char(cur_ + scanned, end_, '\n');
+            if (line_end != end_) {
+                return true;
+            }
+            if (eof_) {
+                // last line without newline
+                return cur_ != end_;
+            }
+            scanned = end_ - cur_;
+            if (!fill()) {
+                eof_ = true;
+            }
+        }
+    }
+
+    /**
+     * Move the remaining bytes to the head and read the next block
+     */
+    bool fill()
+    {
+        auto remain = static_cast<size_t>(end_ - cur_);
+        if (remain == buf_.size()) {
+            // line longer than the block
+            buf_.resize(buf_.size() * 2);
+        } else if (cur_ != buf_.data()) {
+            std::memmove(buf_.data(), cur_, remain);
+        }
+        cur_ = buf_.data();
+        end_ = buf_.data() + remain;
+
+        ssize_t n;
+        do
+        {
+            n = ::read(fd_, buf_.data() + remain, buf_.size() - remain);
+        } while (n < 0 && errno == EINTR);
+        STDSC_THROW_FILE_IF_CHECK(n >= 0, "failed to read CSV.");
+
+        end_ += n;
+        return n > 0;
+    }
+
+    int fd_;
+    std::vector<char> buf_;
+    const char* cur_;
+    const char* end_;
+    bool eof_;
+    size_t bytes_;
+    std::unordered_map<std::string, size_t> columns_;
+};
+
+CsvReader::CsvReader(const std::string& filepath, const size_t block_size)
+    : pimpl_(new Impl(filepath, block_size))
+{
+}
+
+CsvReader::CsvReader(std::shared_ptr<Impl> pimpl)
+    : pimpl_(pimpl)
+{
+}
+
+CsvReader CsvReader::from_text(const std::string& text)
+{
+    return CsvReader(std::make_shared<Impl>(text.data(), text.size()));
+}
+
+size_t CsvReader::column(const std::string& name) const
+{
+    return pimpl_->column(name);
+}
+
+bool CsvReader::next(std::vector<Field>& fields)
+{
+    return pimpl_->next(fields);
+}
+
+size_t CsvReader::bytes_read() const
+{
+    return pimpl_->bytes_read();
+}
+
+int64_t CsvReader::to_int(const Field& field)
+{
+    const char* p = field.data;
+    const char* e = field.data + field.size;
+    bool neg = false;
+    if (p != e && (*p == '-' || *p == '+')) {
+        neg = (*p == '-');
+        ++p;
+    }
+    STDSC_THROW_INVPARAM_IF_CHECK(p != e, "empty integer field in CSV.");
+
+    int64_t v = 0;
+    for (; p != e; ++p)
+    {
+        auto d = static_cast<unsigned>(*p - '0');
+        STDSC_THROW_INVPARAM_IF_CHECK(d < 10, "invalid integer field in CSV.");
+        v = v * 10 + d;
+    }
+    return neg ? -v : v;
+}
+
+} /* namespace sses_server */
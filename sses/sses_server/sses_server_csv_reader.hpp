@@ -0,0 +1,99 @@
+/*
+ * Copyright 2020 Yamana Laboratory, Waseda University
+ * Supported by JST CREST Grant Number JPMJCR1503, Japan.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE‐2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SSES_SERVER_CSV_READER_HPP
+#define SSES_SERVER_CSV_READER_HPP
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <sses_share/sses_define.hpp>
+
+namespace sses_server
+{
+
+/**
+ * @brief Reads CSV without copying fields.
+ * The input is read in blocks and delimiters are searched with SIMD.
+ * Fields point into the block and are valid until the next call of next().
+ * Quoted fields are not supported.
+ */
+class CsvReader
+{
+public:
+    /**
+     * @brief Field of row
+     */
+    struct Field
+    {
+        const char* data;
+        size_t size;
+    };
+
+    /**
+     * Constructor for file
+     * @param[in] filepath CSV filepath
+     * @param[in] block_size read size
+     */
+    explicit CsvReader(const std::string& filepath,
+                       const size_t block_size = SSES_DEFAULT_CSV_BLOCK_SIZE);
+    virtual ~CsvReader() = default;
+
+    /**
+     * Create reader for CSV text in memory
+     * @param[in] text CSV text (must outlive the reader)
+     * @return reader
+     */
+    static CsvReader from_text(const std::string& text);
+
+    /**
+     * Get column index from header
+     * @param[in] name column name
+     * @return column index
+     */
+    size_t column(const std::string& name) const;
+
+    /**
+     * Read next row
+     * @param[out] fields fields of row (capacity is reused)
+     * @return false at end of input
+     */
+    bool next(std::vector<Field>& fields);
+
+    /**
+     * Number of bytes consumed
+     */
+    size_t bytes_read() const;
+
+    /**
+     * Parse field as integer
+     * @param[in] field field
+     * @return value
+     */
+    static int64_t to_int(const Field& field);
+
+private:
+    struct Impl;
+    explicit CsvReader(std::shared_ptr<Impl> pimpl);
+    std::shared_ptr<Impl> pimpl_;
+};
+
+} /* namespace sses_server */
+
+#endif /* SSES_SERVER_CSV_READER_HPP */
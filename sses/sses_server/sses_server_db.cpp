@@ -17,12 +17,24 @@
 
 #define _POSIX_SOURCE // for mkdir
 #include <sys/stat.h> // for mkdir
-
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cerrno>
+#include <ctime>
+#include <functional>
 #include <unordered_map>
 #include <string>
 #include <fstream>
 #include <boost/algorithm/string.hpp>
 #include <map>
+#include <mutex>
+#include <random>
+#include <set>
+#include <sstream>
 
 #include "FHE.h"
 #include "EncryptedArray.h"
@@ -34,8 +46,16 @@
 #include <sses_share/sses_computation_param.hpp>
 #include <sses_share/sses_mask.hpp>
 #include <sses_share/sses_types.hpp>
+#include <sses_share/sses_define.hpp>
+#include <sses_share/sses_fhekey_container.hpp>
 
 #include <sses_server/sses_server_db.hpp>
+#include <sses_server/sses_server_index.hpp>
+#include <sses_server/sses_server_index_compactor.hpp>
+#include <sses_server/sses_server_external_sorter.hpp>
+#include <sses_server/sses_server_csv_reader.hpp>
+#include <sses_server/sses_server_aux_store.hpp>
+#include <sses_server/sses_server_stats.hpp>
 
 #define ENABLE_LOCAL_DEBUG
 #ifdef ENABLE_LOCAL_DEBUG
@@ -50,17 +70,56 @@ static constexpr char* DEFAULT_MEDINV_FILENAME = (char*)"med.inv";
 static constexpr char* DEFAULT_SIDEINV_FILENAME = (char*)"side.inv";
 static constexpr char* DEFAULT_ENCDATA_DIRNAME = (char*)"encdata";
 static constexpr char* DEFAULT_AUXDATA_DIRNAME = (char*)"auxdata";
+static constexpr char* DEFAULT_SEGMENT_DIRNAME = (char*)"segments";
+static constexpr char* DEFAULT_MEDSEG_PREFIX = (char*)"med";
+static constexpr char* DEFAULT_SIDESEG_PREFIX = (char*)"side";
+static constexpr char* DEFAULT_SEGMENT_EXTNAME = (char*)"inv";
+static constexpr char* DEFAULT_INGEST_DIRNAME = (char*)"ingest";
+static constexpr char* DEFAULT_AUXSTORE_FILENAME = (char*)"aux.col";
+static constexpr char* DEFAULT_AUXSEG_PREFIX = (char*)"aux";
+static constexpr char* DEFAULT_AUXSEG_EXTNAME = (char*)"col";
+static constexpr char* DEFAULT_PLAIN_DIRNAME = (char*)"plain";
+static constexpr char* DEFAULT_SOURCE_FILENAME = (char*)"source.txt";
+static constexpr char* DEFAULT_MASK_FILENAME = (char*)"mask.bin";
+static constexpr char* DEFAULT_READY_FILENAME = (char*)"ready";
+static constexpr char* DEFAULT_MANIFEST_FILENAME = (char*)"manifest";
+static constexpr char* DEFAULT_BUILDID_FILENAME = (char*)"build_id";
+static constexpr char* DEFAULT_APPEND_INTENT_FILENAME = (char*)"append.intent";
+static constexpr char* DEFAULT_BUILDING_SUFFIX = (char*)".building";
     
 
 namespace csvcolumns
 {
-    constexpr int ID_IDX = 0;
-    constexpr int MEDICINE_ID_IDX = 1;
-    constexpr int SYMPTOM_ID_IDX = 2;
-    constexpr int AGE_IDX = 8;
-    constexpr int GENDER_IDX = 9;
+    constexpr char* ID = (char*)"id";
+    constexpr char* MEDICINE_ID = (char*)"medicine_id";
+    constexpr char* SYMPTOM_ID = (char*)"symptom_id";
+    constexpr char* AGE = (char*)"age";
+    constexpr char* GENDER = (char*)"gender";
 }
 
+/**
+ * Column indices of the DB source, resolved from the CSV header
+ */
+struct CsvColumns
+{
+    explicit CsvColumns(const CsvReader& reader)
+        : id(reader.column(csvcolumns::ID)),
+          medicineId(reader.column(csvcolumns::MEDICINE_ID)),
+          symptomId(reader.column(csvcolumns::SYMPTOM_ID)),
+          age(reader.column(csvcolumns::AGE)),
+          gender(reader.column(csvcolumns::GENDER)),
+          num(std::max({id, medicineId, symptomId, age, gender}) + 1)
+    {
+    }
+
+    size_t id;
+    size_t medicineId;
+    size_t symptomId;
+    size_t age;
+    size_t gender;
+    size_t num;
+};
+
 struct Record
 {
     int maskValue;
@@ -68,6 +127,411 @@ struct Record
     std::set<size_t> symptomIds;
 };
 
+/**
+ * One line of the CSV. The rows of a record are grouped by external sort.
+ */
+struct CsvRow
+{
+    uint64_t recordId;
+    uint32_t medicineId;
+    uint32_t symptomId;
+    int32_t maskValue;
+};
+
+struct CsvRowLess
+{
+    bool operator()(const CsvRow& a, const CsvRow& b) const
+    {
+        return a.recordId < b.recordId;
+    }
+};
+
+struct Posting
+{
+    uint32_t id;
+    uint64_t recordId;
+};
+
+struct PostingLess
+{
+    bool operator()(const Posting& a, const Posting& b) const
+    {
+        return a.id < b.id || (a.id == b.id && a.recordId < b.recordId);
+    }
+};
+
+/**
+ * Plaintext mask of record. Masks are encrypted for each key from this.
+ */
+struct MaskEntry
+{
+    int32_t recordId;
+    int32_t maskValue;
+};
+
+static void parse_csv_row(const std::vector<CsvReader::Field>& fields,
+                          const CsvColumns& cols,
+                          CsvRow& row)
+{
+    STDSC_THROW_INVPARAM_IF_CHECK(fields.size() >= cols.num,
+                                  "Err: too few columns in DB source.");
+    row.recordId = CsvReader::to_int(fields[cols.id]);
+    row.medicineId = CsvReader::to_int(fields[cols.medicineId]);
+    row.symptomId = CsvReader::to_int(fields[cols.symptomId]);
+    int age = CsvReader::to_int(fields[cols.age]);
+    assert(age >= 0 && age <= 122);
+    int genderData = CsvReader::to_int(fields[cols.gender]);
+    assert(genderData == 1 || genderData == 2 || genderData == 3);
+    auto gender = sses_share::GENDER_INT_MAP.at(genderData);
+    row.maskValue = age + static_cast<int>(gender) * 128 + 5;
+}
+
+static void parse_csv(CsvReader& reader,
+                      std::map<size_t, Record>& records,
+                      std::set<size_t>& totalMedicines,
+                      std::set<size_t>& totalSymptoms)
+{
+    CsvColumns cols(reader);
+    std::vector<CsvReader::Field> fields;
+    while (reader.next(fields))
+    {
+        CsvRow row;
+        parse_csv_row(fields, cols, row);
+        totalMedicines.insert(row.medicineId);
+        totalSymptoms.insert(row.symptomId);
+        if (records.count(row.recordId) == 0)
+        {
+            records.insert(
+                std::make_pair(row.recordId, Record{row.maskValue, {}, {}}));
+        }
+        records.at(row.recordId).medicineIds.insert(row.medicineId);
+        records.at(row.recordId).symptomIds.insert(row.symptomId);
+    }
+}
+
+static bool write_all(int fd, const std::string& data)
+{
+    const char* p = data.data();
+    size_t remain = data.size();
+    while (remain > 0) {
+        ssize_t n = ::write(fd, p, remain);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        p += n;
+        remain -= n;
+    }
+    return true;
+}
+
+/**
+ * Write file, and flush it to the disk unless sync is false
+ */
+static void write_file(const std::string& filepath, const std::string& data,
+                       const bool sync = true)
+{
+    int fd = ::open(filepath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR);
+    STDSC_THROW_FILE_IF_CHECK(fd >= 0, "Err: failed to open file. (" + filepath + ")");
+    bool ok = write_all(fd, data) && (!sync || ::fsync(fd) == 0);
+    ::close(fd);
+    STDSC_THROW_FILE_IF_CHECK(ok, "Err: failed to write file. (" + filepath + ")");
+}
+
+/**
+ * Append data to file, and flush it to the disk
+ */
+static void append_file(const std::string& filepath, const std::string& data)
+{
+    int fd = ::open(filepath.c_str(), O_WRONLY | O_CREAT | O_APPEND, S_IRUSR | S_IWUSR);
+    STDSC_THROW_FILE_IF_CHECK(fd >= 0, "Err: failed to open file. (" + filepath + ")");
+    bool ok = write_all(fd, data) && ::fsync(fd) == 0;
+    ::close(fd);
+    STDSC_THROW_FILE_IF_CHECK(ok, "Err: failed to write file. (" + filepath + ")");
+}
+
+/**
+ * Flush file or directory entries to the disk
+ */
+static void sync_path(const std::string& path)
+{
+    int fd = ::open(path.c_str(), O_RDONLY);
+    STDSC_THROW_FILE_IF_CHECK(fd >= 0, "Err: failed to open. (" + path + ")");
+    bool ok = ::fsync(fd) == 0;
+    ::close(fd);
+    STDSC_THROW_FILE_IF_CHECK(ok, "Err: failed to sync. (" + path + ")");
+}
+
+/**
+ * Cut file back to size. Nothing is done if it is not longer than that.
+ * @return whether the file is cut
+ */
+static bool truncate_file(const std::string& filepath, const size_t size)
+{
+    if (!sses_share::utility::file_exist(filepath) ||
+        sses_share::utility::file_size(filepath) <= size) {
+        return false;
+    }
+    STDSC_THROW_FILE_IF_CHECK(::truncate(filepath.c_str(), size) == 0,
+                              "Err: failed to truncate file. (" + filepath + ")");
+    sync_path(filepath);
+    return true;
+}
+
+/**
+ * Flush files written without sync, then their directory entries
+ */
+static void sync_files(std::vector<std::string>& filepaths, const std::string& dirpath)
+{
+    for (const auto& filepath : filepaths) {
+        sync_path(filepath);
+    }
+    sync_path(dirpath);
+    filepaths.clear();
+}
+
+/**
+ * Replace file atomically. Readers see either the old or the new content
+ * even if the server crashes.
+ */
+static void publish_file(const std::string& filepath, const std::string& data)
+{
+    write_file(filepath + ".tmp", data);
+    STDSC_THROW_FILE_IF_CHECK(
+        ::rename((filepath + ".tmp").c_str(), filepath.c_str()) == 0,
+        "Err: failed to replace file. (" + filepath + ")");
+    sync_path(sses_share::utility::get_dirname(filepath));
+}
+
+/**
+ * Encrypt mask of record and write it. It is not synced, callers sync the
+ * files of a batch at once (see sync_files).
+ */
+static size_t write_record(const std::string& encfilepath,
+                           const int32_t maskValue,
+                           const FHEPubKey& pubkey)
+{
+    Ctxt encmask(pubkey);
+    pubkey.Encrypt(encmask, NTL::to_ZZX(maskValue));
+    std::ostringstream oss;
+    oss << encmask;
+    const auto data = oss.str();
+    write_file(encfilepath, data, false);
+    return data.size();
+}
+
+/**
+ * Total size of files in directory
+ */
+static size_t dir_size(const std::string& dirpath)
+{
+    size_t ret = 0;
+    if (!sses_share::utility::dir_exist(dirpath)) {
+        return ret;
+    }
+    for (const auto& path : sses_share::utility::get_filelist(dirpath)) {
+        struct stat st;
+        if (::stat(path.c_str(), &st) == 0) {
+            ret += st.st_size;
+        }
+    }
+    return ret;
+}
+
+/**
+ * Read masks from the skip-th one
+ * @param[in] count max number of masks to read
+ */
+static void read_masks(const std::string& filepath,
+                       const size_t skip,
+                       std::function<void(const MaskEntry&)> func,
+                       size_t count = SIZE_MAX)
+{
+    std::ifstream ifs(filepath, std::ios::binary);
+    STDSC_THROW_FILE_IF_CHECK(ifs.is_open(),
+                              "Err: failed to open mask file. (" + filepath + ")");
+    ifs.seekg(skip * sizeof(MaskEntry));
+
+    std::vector<MaskEntry> block(4096);
+    while (ifs && count > 0)
+    {
+        ifs.read(reinterpret_cast<char*>(block.data()),
+                 std::min(block.size(), count) * sizeof(MaskEntry));
+        size_t num = ifs.gcount() / sizeof(MaskEntry);
+        for (size_t i = 0; i < num; ++i) {
+            func(block[i]);
+        }
+        count -= num;
+    }
+}
+
+static void append_masks(const std::string& filepath,
+                         const std::vector<MaskEntry>& masks)
+{
+    append_file(filepath, std::string(reinterpret_cast<const char*>(masks.data()),
+                                      masks.size() * sizeof(MaskEntry)));
+}
+
+/**
+ * Lines of CSV except the header, as appended to the DB source
+ */
+static std::string source_lines(const std::string& delta_csv)
+{
+    std::istringstream iss(delta_csv);
+    std::ostringstream oss;
+    std::string line;
+    std::getline(iss, line); // header
+    while (std::getline(iss, line)) {
+        if (!line.empty()) {
+            oss << line << "\n";
+        }
+    }
+    return oss.str();
+}
+
+/**
+ * IDs of records that are already in the DB source
+ */
+static std::vector<int32_t> source_conflicts(const std::string& db_src_filepath,
+                                             const std::map<size_t, Record>& records)
+{
+    std::set<int32_t> found;
+    if (!sses_share::utility::file_exist(db_src_filepath)) {
+        return std::vector<int32_t>();
+    }
+
+    CsvReader reader(db_src_filepath);
+    CsvColumns cols(reader);
+    std::vector<CsvReader::Field> fields;
+    while (reader.next(fields))
+    {
+        STDSC_THROW_INVPARAM_IF_CHECK(fields.size() >= cols.num,
+                                      "Err: too few columns in DB source.");
+        size_t recordId = CsvReader::to_int(fields[cols.id]);
+        if (records.count(recordId) > 0) {
+            found.insert(static_cast<int32_t>(recordId));
+        }
+    }
+    return std::vector<int32_t>(found.begin(), found.end());
+}
+
+/**
+ * Progress of encrypting the masks of key
+ */
+struct Manifest
+{
+    std::string build_id; ///< build ID of the plaintext layer
+    size_t numRecords;    ///< number of masks encrypted, in order of the mask file
+    size_t numBytes;
+};
+
+static bool load_manifest(const std::string& filepath, Manifest& manifest)
+{
+    std::ifstream ifs(filepath);
+    if (!ifs.is_open()) {
+        return false;
+    }
+    std::getline(ifs, manifest.build_id);
+    ifs >> manifest.numRecords >> manifest.numBytes;
+    return !ifs.fail();
+}
+
+static void save_manifest(const std::string& filepath, const Manifest& manifest)
+{
+    std::ostringstream oss;
+    oss << manifest.build_id << std::endl;
+    oss << manifest.numRecords << std::endl;
+    oss << manifest.numBytes << std::endl;
+    publish_file(filepath, oss.str());
+}
+
+/**
+ * Sizes of the files changed by an append, recorded before any of them is
+ * changed. An append interrupted by a crash or an error is rolled back to
+ * them (see DB::Impl::recover_append).
+ */
+struct AppendIntent
+{
+    size_t seq;                 ///< sequence number of the segments
+    size_t maskBytes;           ///< size of the mask file before
+    size_t srcBytes;            ///< size of the DB source before
+    size_t srcBytesAfter;       ///< size of the DB source after
+    size_t totalRecordsNum;     ///< DB basic before
+    size_t totalMedicinesNum;
+    size_t totalSymptomsNum;
+    std::string srcFilepath;
+};
+
+static bool load_append_intent(const std::string& filepath, AppendIntent& intent)
+{
+    std::ifstream ifs(filepath);
+    if (!ifs.is_open()) {
+        return false;
+    }
+    ifs >> intent.seq >> intent.maskBytes >> intent.srcBytes >> intent.srcBytesAfter;
+    ifs >> intent.totalRecordsNum >> intent.totalMedicinesNum >> intent.totalSymptomsNum;
+    if (ifs.fail()) {
+        return false;
+    }
+    ifs >> std::ws;
+    std::getline(ifs, intent.srcFilepath);
+    return true;
+}
+
+static void save_append_intent(const std::string& filepath, const AppendIntent& intent)
+{
+    std::ostringstream oss;
+    oss << intent.seq << std::endl;
+    oss << intent.maskBytes << std::endl;
+    oss << intent.srcBytes << std::endl;
+    oss << intent.srcBytesAfter << std::endl;
+    oss << intent.totalRecordsNum << std::endl;
+    oss << intent.totalMedicinesNum << std::endl;
+    oss << intent.totalSymptomsNum << std::endl;
+    oss << intent.srcFilepath << std::endl;
+    publish_file(filepath, oss.str());
+}
+
+/**
+ * Signature of files to detect changes
+ */
+static std::string file_signature(const std::string& filepath)
+{
+    struct stat st;
+    STDSC_THROW_FILE_IF_CHECK(::stat(filepath.c_str(), &st) == 0,
+                              "Err: failed to stat file. (" + filepath + ")");
+    std::ostringstream oss;
+    oss << filepath << ":" << st.st_mtime << ":" << st.st_size << ";";
+    return oss.str();
+}
+
+/**
+ * Write index file from postings sorted by (id, record ID)
+ */
+static void write_index(const std::string& filepath,
+                        const std::map<uint32_t, size_t>& counts,
+                        ExternalSorter<Posting, PostingLess>& postings)
+{
+    std::ofstream ofs(filepath, std::ios::binary);
+    ofs << counts.size() << std::endl;
+
+    bool first = true;
+    uint32_t current = 0;
+    postings.for_each([&](const Posting& p) {
+        if (first || p.id != current) {
+            ofs << p.id << ":" << counts.at(p.id) << std::endl;
+            current = p.id;
+            first = false;
+        }
+        ofs << p.recordId << std::endl;
+    });
+
+    ofs.close();
+    STDSC_THROW_FILE_IF_CHECK(!ofs.fail(), "Err: failed to write index. (" + filepath + ")");
+}
+
 DBBasicFile::DBBasicFile()
     : dbstatus(false),
       totalRecordsNum(0),
@@ -121,6 +585,21 @@ void DBBasicFile::load_from_file(const std::string& filepath)
     ifs >> totalSymptomsNum;
 }
 
+std::string DBUsage::to_string() const
+{
+    std::ostringstream oss;
+    oss << "bytes:" << total_bytes;
+    oss << ", budget:" << max_bytes;
+    oss << ", evictions:" << num_evictions;
+    for (const auto& k : keys) {
+        oss << ", {keyID:" << k.key_id;
+        oss << ", bytes:" << k.bytes;
+        oss << ", lastUsed:" << k.last_used;
+        oss << ", enabled:" << k.enabled << "}";
+    }
+    return oss.str();
+}
+
 bool DBBasicFile::status() const
 {
     return dbstatus;
@@ -135,12 +614,15 @@ std::string DBBasicFile::to_string() const
     return oss.str();
 }
     
-struct DatasetInfo
+/**
+ * Plaintext layer shared by all keys. It is built once for each version of
+ * the DB source.
+ */
+struct PlainLayer
 {
-    explicit DatasetInfo(std::string& dir)
+    explicit PlainLayer(const std::string& dir)
         : dir_(dir)
     {}
-    virtual ~DatasetInfo() = default;
 
     bool is_enable() const
     {
@@ -149,7 +631,12 @@ struct DatasetInfo
             
             auto filepath = dbbasic_filepath();
             DBBasicFile dbbasic(filepath);
-            if (dbbasic.status()) {
+            // layers of older versions keep aux data in a text file per
+            // record and have no aux store or mask file. they are not
+            // enabled, so that they are built again.
+            if (dbbasic.status() &&
+                sses_share::utility::file_exist(auxstore_filepath()) &&
+                sses_share::utility::file_exist(mask_filepath())) {
                 ret = true;
             }
             
@@ -157,6 +644,49 @@ struct DatasetInfo
         return ret;
     }
 
+    /**
+     * Signature of the DB source the layer was built from
+     */
+    std::string source_signature() const
+    {
+        std::string ret;
+        std::ifstream ifs(source_filepath());
+        std::getline(ifs, ret);
+        return ret;
+    }
+
+    void save_source_signature(const std::string& signature) const
+    {
+        publish_file(source_filepath(), signature + "\n");
+    }
+
+    /**
+     * ID unique to each build of the layer. Appends keep the ID.
+     */
+    std::string build_id() const
+    {
+        std::string ret;
+        std::ifstream ifs(build_id_filepath());
+        std::getline(ifs, ret);
+        return ret;
+    }
+
+    const std::string append_intent_filepath() const
+    {
+        std::ostringstream oss;
+        oss << dir_ << "/";
+        oss << DEFAULT_APPEND_INTENT_FILENAME;
+        return oss.str();
+    }
+
+    const std::string build_id_filepath() const
+    {
+        std::ostringstream oss;
+        oss << dir_ << "/";
+        oss << DEFAULT_BUILDID_FILENAME;
+        return oss.str();
+    }
+
     const std::string dbbasic_filepath() const
     {
         std::ostringstream oss;
@@ -165,6 +695,14 @@ struct DatasetInfo
         return oss.str();
     }
 
+    const std::string source_filepath() const
+    {
+        std::ostringstream oss;
+        oss << dir_ << "/";
+        oss << DEFAULT_SOURCE_FILENAME;
+        return oss.str();
+    }
+
     const std::string medinv_filepath() const
     {
         auto dir = auxdata_dirpath() + "/";
@@ -177,31 +715,139 @@ struct DatasetInfo
         return dir + DEFAULT_SIDEINV_FILENAME;
     }
     
-    const std::string encdata_dirpath() const
+    const std::string auxstore_filepath() const
+    {
+        auto dir = auxdata_dirpath() + "/";
+        return dir + DEFAULT_AUXSTORE_FILENAME;
+    }
+
+    const std::string mask_filepath() const
+    {
+        auto dir = auxdata_dirpath() + "/";
+        return dir + DEFAULT_MASK_FILENAME;
+    }
+
+    const std::string auxdata_dirpath() const
     {
         std::ostringstream oss;
         oss << dir_ << "/";
-        oss << DEFAULT_ENCDATA_DIRNAME;
+        oss << DEFAULT_AUXDATA_DIRNAME;
         return oss.str();
     }
 
-    const std::string auxdata_dirpath() const
+    const std::string segment_dirpath() const
     {
         std::ostringstream oss;
         oss << dir_ << "/";
-        oss << DEFAULT_AUXDATA_DIRNAME;
+        oss << DEFAULT_SEGMENT_DIRNAME;
+        return oss.str();
+    }
+
+    const std::string segment_filepath(const std::string& prefix, const size_t seq,
+                                       const std::string& ext = DEFAULT_SEGMENT_EXTNAME) const
+    {
+        std::ostringstream oss;
+        oss << segment_dirpath() << "/" << prefix << "." << seq << "." << ext;
         return oss.str();
     }
+
+    /**
+     * Segments appended after setup, in order of sequence number
+     */
+    std::map<size_t, std::string> segment_filepaths(const std::string& prefix,
+                                                    const std::string& ext = DEFAULT_SEGMENT_EXTNAME) const
+    {
+        std::map<size_t, std::string> ret;
+        if (!sses_share::utility::dir_exist(segment_dirpath())) {
+            return ret;
+        }
+        for (const auto& path : sses_share::utility::get_filelist(
+                 segment_dirpath(), ext)) {
+            std::vector<std::string> elems;
+            auto filename = sses_share::utility::get_filename(path);
+            boost::algorithm::split(elems, filename, boost::is_any_of("."));
+            if (elems.size() == 3 && elems[0] == prefix &&
+                sses_share::utility::isdigit(elems[1])) {
+                ret.emplace(std::stoul(elems[1]), path);
+            }
+        }
+        return ret;
+    }
     
     std::string dir_;
 };
+
+/**
+ * Encrypted masks of key
+ */
+struct DatasetInfo
+{
+    explicit DatasetInfo(std::string& dir)
+        : dir_(dir)
+    {}
+    virtual ~DatasetInfo() = default;
+
+    bool is_enable() const
+    {
+        // the ready file is written after all masks are encrypted
+        return sses_share::utility::file_exist(ready_filepath());
+    }
+
+    const std::string ready_filepath() const
+    {
+        std::ostringstream oss;
+        oss << dir_ << "/";
+        oss << DEFAULT_READY_FILENAME;
+        return oss.str();
+    }
+
+    const std::string manifest_filepath() const
+    {
+        std::ostringstream oss;
+        oss << dir_ << "/";
+        oss << DEFAULT_MANIFEST_FILENAME;
+        return oss.str();
+    }
+
+    const std::string encdata_dirpath() const
+    {
+        std::ostringstream oss;
+        oss << dir_ << "/";
+        oss << DEFAULT_ENCDATA_DIRNAME;
+        return oss.str();
+    }
+
+    std::string dir_;
+};
     
+/**
+ * Disk usage and last query time of keys. It is shared with the leases
+ * handed to queries, which may outlive the DB.
+ */
+struct UsageTable
+{
+    struct Key
+    {
+        size_t bytes = 0;
+        std::time_t last_used = 0;
+        size_t leases = 0;
+    };
+
+    std::mutex mtx;
+    std::unordered_map<int32_t, Key> keys;
+    size_t num_evictions = 0;
+};
+
 struct DB::Impl
 {
     static constexpr char* LIST_FILENAME = (char*)"list.txt";
     
-    Impl(const std::string& db_basedir)
-        : db_basedir_(db_basedir)
+    Impl(const std::string& db_basedir, const size_t max_disk_bytes)
+        : db_basedir_(db_basedir),
+          max_disk_bytes_(max_disk_bytes),
+          plain_(db_basedir + "/" + DEFAULT_PLAIN_DIRNAME),
+          usage_(std::make_shared<UsageTable>()),
+          compactor_([this]() { compact(); })
     {
         {
             std::ostringstream oss;
@@ -212,23 +858,40 @@ struct DB::Impl
         load_listfile(list_filepath_);
 
         std::ostringstream oss;
+        oss << "{plain:" << plain_.is_enable() << "} ";
         for (auto m : map_) {
             auto key_id = m.first;
             auto dsinfo = m.second;
             oss << "{key_id:" << key_id;
             oss << ", dir:" << dsinfo.dir_.c_str();
             oss << ", dbstatus:" << dsinfo.is_enable();
+            oss << ", bytes:" << usage_->keys[key_id].bytes;
             oss << "} ";
         }
         STDSC_LOG_INFO("Initialized DB : %s", oss.str().c_str());
+
+        recover_append();
+        compactor_.start();
+    }
+
+    ~Impl()
+    {
+        try {
+            save_listfile(list_filepath_);
+        } catch (const std::exception& e) {
+            STDSC_LOG_WARN("Failed to save List file. (%s)", e.what());
+        }
     }
 
     bool is_enable(const int32_t key_id) const
     {
         bool ret = false;
-        if (map_.count(key_id) > 0) {
-            auto& dsinfo = map_.at(key_id);
-            ret = dsinfo.is_enable();
+        std::unique_lock<std::mutex> lock(map_mtx_);
+        auto it = map_.find(key_id);
+        if (it != map_.end()) {
+            auto dsinfo = it->second;
+            lock.unlock();
+            ret = dsinfo.is_enable() && plain_.is_enable();
         }
         return ret;
     }
@@ -236,194 +899,842 @@ struct DB::Impl
     void setup(const int32_t key_id,
                const std::string& db_src_filepath,
                const FHEcontext& context,
-               const FHEPubKey& pubkey)
+               const FHEPubKey& pubkey,
+               std::function<void(const size_t, const size_t)> progress)
     {
+        // the masks are encrypted without the lock, so that appends and
+        // compactions are not blocked by a long setup
+        std::unique_lock<std::mutex> lock(append_mtx_);
+        recover_append();
+
         if (is_enable(key_id)) {
             return;
         }
 
+        setup_plain(db_src_filepath);
+
         std::string top_dir = db_basedir_ + "/db_" + std::to_string(key_id);
+        DatasetInfo dsinfo(top_dir);
+        auto encdata_dir = dsinfo.encdata_dirpath();
+        const auto build_id = plain_.build_id();
+
+        // a build interrupted by a crash is resumed from the last checkpoint
+        // if it was made from the same plaintext layer
+        Manifest manifest;
+        if (!load_manifest(dsinfo.manifest_filepath(), manifest) ||
+            manifest.build_id != build_id)
+        {
+            if (sses_share::utility::dir_exist(top_dir)) {
+                sses_share::utility::remove_dir(top_dir);
+                STDSC_LOG_INFO("Remove directory : %s", top_dir.c_str());
+            }
 
-        if (sses_share::utility::dir_exist(top_dir)) {
-            sses_share::utility::remove_dir(top_dir);
-            STDSC_LOG_INFO("Remove directory : %s", top_dir.c_str());
+            STDSC_LOG_INFO("Creating new DB. [In:%s, Out: %s]",
+                           plain_.dir_.c_str(),
+                           top_dir.c_str());
+        
+            STDSC_THROW_FILE_IF_CHECK(mkdir(top_dir.c_str(), S_IRWXU) == 0,
+                                      "Err: failed to create DB directory");
+            STDSC_THROW_FILE_IF_CHECK(mkdir(encdata_dir.c_str(), S_IRWXU) == 0,
+                                      "Err: failed to create DB directory");
+            manifest = Manifest{build_id, 0, 0};
+            save_manifest(dsinfo.manifest_filepath(), manifest);
+            sync_path(db_basedir_);
+        }
+        else
+        {
+            STDSC_LOG_INFO("Resuming DB. [Out: %s, records:%lu]",
+                           top_dir.c_str(), manifest.numRecords);
         }
 
-        STDSC_LOG_INFO("Creating new DB. [In:%s, Out: %s]",
-                       db_src_filepath.c_str(),
-                       top_dir.c_str());
-        
-        STDSC_THROW_FILE_IF_CHECK(mkdir(top_dir.c_str(), S_IRWXU) == 0,
-                                  "Err: failed to create DB directory");
-        auto encdata_dir = top_dir + "/encdata";
-        STDSC_THROW_FILE_IF_CHECK(mkdir(encdata_dir.c_str(), S_IRWXU) == 0,
-                                  "Err: failed to create DB directory");
-        auto auxdata_dir = top_dir + "/auxdata";
-        STDSC_THROW_FILE_IF_CHECK(mkdir(auxdata_dir.c_str(), S_IRWXU) == 0,
-                                  "Err: failed to create DB directory");
+        const auto maskfilepath = plain_.mask_filepath();
+        size_t totalRecords =
+            sses_share::utility::file_size(maskfilepath) / sizeof(MaskEntry);
+        lock.unlock();
 
-        std::ifstream csvIfs(db_src_filepath);
-        std::string line;
-        std::map<size_t, Record> records;
-        std::set<size_t> totalMedicines;
-        std::set<size_t> totalSymptoms;
+        STDSC_LOG_INFO("Start encrypting DB data. [keyID:%d]", key_id);
 
-        std::vector<std::string> record;
-        getline(csvIfs, line); // header
-        while (getline(csvIfs, line))
-        {
-            boost::algorithm::split(record, line, boost::is_any_of(","));
-            size_t id = stoi(record[csvcolumns::ID_IDX]);
-            size_t medicineId = stoi(record[csvcolumns::MEDICINE_ID_IDX]);
-            size_t symptomId = stoi(record[csvcolumns::SYMPTOM_ID_IDX]);
-            totalMedicines.insert(medicineId);
-            totalSymptoms.insert(symptomId);
-            if (records.count(id) == 0)
-            {
-                int age = stoi(record[csvcolumns::AGE_IDX]);
-                assert(age >= 0 && age <= 122);
-                int genderData = stoi(record[csvcolumns::GENDER_IDX]);
-                assert(genderData == 1 || genderData == 2 || genderData == 3);
-                auto gender = sses_share::GENDER_INT_MAP.at(genderData);
-                int mask = age + static_cast<int>(gender) * 128 + 5;
-                std::set<size_t> medicineIds;
-                medicineIds.insert(medicineId);
-                std::set<size_t> symptomIds;
-                symptomIds.insert(symptomId);
-                records.insert(
-                    std::make_pair(id, Record{mask, medicineIds, symptomIds}));
+        size_t numRecords = manifest.numRecords, numBytes = manifest.numBytes;
+        std::vector<std::string> unsynced;
+        auto encrypt = [&](const MaskEntry& mask) {
+            if (progress) {
+                progress(numRecords, totalRecords);
             }
-            else
-            {
-                records.at(id).medicineIds.insert(medicineId);
-                records.at(id).symptomIds.insert(symptomId);
+            std::string encfilepath = encdata_dir + "/" + std::to_string(mask.recordId) + ".bin";
+            numBytes += write_record(encfilepath, mask.maskValue, pubkey);
+            unsynced.push_back(encfilepath);
+            ++numRecords;
+
+            // the records of the batch and their directory entries are
+            // synced before the checkpoint is recorded
+            if (numRecords % SSES_DEFAULT_SETUP_CHECKPOINT_RECORDS == 0) {
+                sync_files(unsynced, encdata_dir);
+                save_manifest(dsinfo.manifest_filepath(),
+                              Manifest{build_id, numRecords, numBytes});
             }
+        };
+        if (numRecords < totalRecords) {
+            read_masks(maskfilepath, numRecords, encrypt, totalRecords - numRecords);
         }
-        csvIfs.close();
 
-        auto totalRecordsNum = records.size();
-        auto totalMedicinesNum = totalMedicines.size();
-        auto totalSymptomsNum = totalSymptoms.size();        
+        // appends made meanwhile skipped the key, which is not ready yet.
+        // their masks are encrypted before the key is published.
+        lock.lock();
+        STDSC_THROW_FAILURE_IF_CHECK(
+            plain_.build_id() == build_id,
+            "Err: plaintext layer is built again during setup.");
+        totalRecords = sses_share::utility::file_size(maskfilepath) / sizeof(MaskEntry);
+        if (numRecords < totalRecords) {
+            STDSC_LOG_INFO("Encrypting records appended during setup. [keyID:%d, records:%lu]",
+                           key_id, totalRecords - numRecords);
+            read_masks(maskfilepath, numRecords, encrypt, totalRecords - numRecords);
+        }
+        sync_files(unsynced, encdata_dir);
 
-        auto dbbasicfilepath = top_dir + "/" + std::string(DEFAULT_DBBASIC_FILENAME);
-        auto medinvfilepath = auxdata_dir + "/" + std::string(DEFAULT_MEDINV_FILENAME);
-        auto sideinvfilepath = auxdata_dir + "/" + std::string(DEFAULT_SIDEINV_FILENAME);
-        
-        DBBasicFile dbbasicfile;
-        dbbasicfile.write_to_file(dbbasicfilepath,
-                                  totalRecordsNum,
-                                  totalMedicinesNum,
-                                  totalSymptomsNum);
-        STDSC_LOG_INFO("Created DBBasic file. [%s]", dbbasicfilepath.c_str());
+        {
+            std::ostringstream oss;
+            oss << numRecords << std::endl;
+            publish_file(dsinfo.ready_filepath(), oss.str());
+        }
+        sses_share::utility::remove_file(dsinfo.manifest_filepath());
+
+        STDSC_LOG_INFO("Finish encrypting DB data. [keyID:%d, records:%lu, bytes:%lu]",
+                       key_id, numRecords, numBytes);
 
-        std::ofstream fmedinv(medinvfilepath, std::ios::binary);
-        fmedinv << totalMedicinesNum << std::endl;
-        for (const auto& medicineId : totalMedicines) {
-            fmedinv << medicineId << ":" << 0 << std::endl;
+        {
+            std::lock_guard<std::mutex> lock(usage_->mtx);
+            auto& usage = usage_->keys[key_id];
+            usage.bytes = numBytes;
+            usage.last_used = std::time(nullptr);
         }
-        fmedinv.close();
 
-        std::ofstream fsideinv(sideinvfilepath, std::ios::binary);
-        fsideinv << totalSymptomsNum << std::endl;
-        for (const auto& symptomId : totalSymptoms) {
-            fsideinv << symptomId << ":" << 0 << std::endl;
+        {
+            std::lock_guard<std::mutex> lock(map_mtx_);
+            map_.emplace(key_id, dsinfo);
         }
-        fsideinv.close();
+        evict({key_id});
+        save_listfile(list_filepath_);
+        STDSC_LOG_INFO("Updated List file. [%s]", list_filepath_.c_str());
+        STDSC_LOG_INFO("DB usage : %s", usage().to_string().c_str());
+    }
 
-        NTL::ZZX G = context.alMod.getFactorsOverZZ()[0];
-        EncryptedArray ea(context, G);
+    std::shared_ptr<void> acquire(const int32_t key_id) const
+    {
+        const auto now = std::time(nullptr);
+        auto table = usage_;
+        std::shared_ptr<void> lease;
+        {
+            std::lock_guard<std::mutex> lock(usage_->mtx);
+            auto& usage = usage_->keys[key_id];
+            usage.last_used = now;
+            ++usage.leases;
+
+            lease = std::shared_ptr<void>(nullptr, [table, key_id](void*) {
+                std::lock_guard<std::mutex> lock(table->mtx);
+                --table->keys[key_id].leases;
+            });
+        }
 
-        STDSC_LOG_INFO("Start generating DB data.");
-        
-        for (const auto& recordPair : records)
+        // the last use is saved now and then, so that a restarted server
+        // evicts the same keys
+        bool stale;
         {
-            size_t recordId = recordPair.first;
-            Record record = recordPair.second;
-            int mask = record.maskValue;
+            std::lock_guard<std::mutex> lock(list_mtx_);
+            stale = now - list_saved_time_ >= SSES_DEFAULT_USAGE_SAVE_INTERVAL_SEC;
+        }
+        if (stale) {
+            try {
+                save_listfile(list_filepath_);
+            } catch (const std::exception& e) {
+                STDSC_LOG_WARN("Failed to save List file. (%s)", e.what());
+            }
+        }
+        return lease;
+    }
 
-             std::string encfilepath = encdata_dir + "/" + std::to_string(recordId) + ".bin";
-            std::string auxfilepath = auxdata_dir + "/" + std::to_string(recordId) + ".bin";
+    DBUsage usage() const
+    {
+        DBUsage ret;
+        ret.max_bytes = max_disk_bytes_;
+
+        const auto dsinfos = datasets();
+        std::lock_guard<std::mutex> lock(usage_->mtx);
+        ret.num_evictions = usage_->num_evictions;
+        for (const auto& m : dsinfos) {
+            const auto& usage = usage_->keys[m.first];
+            ret.keys.push_back(DBUsage::Key{m.first, usage.bytes, usage.last_used,
+                                            m.second.is_enable()});
+            ret.total_bytes += usage.bytes;
+        }
+        return ret;
+    }
 
-            STDSC_LOG_INFO("  recID:%lu, numMed:%lu, numSide:%lu",
-                           recordId,
-                           record.medicineIds.size(),
-                           record.symptomIds.size());
+    std::string dbbasic_filepath(const int32_t key_id) const
+    {
+        return plain(key_id).dbbasic_filepath();
+    }
 
-            Ctxt encmask(pubkey);
-            pubkey.Encrypt(encmask, NTL::to_ZZX(mask));
-            {
-                std::ofstream ofs(encfilepath, std::ios::binary);
-                ofs << encmask;
-                STDSC_LOG_INFO("    | %s", encfilepath.c_str());
+    std::string medinv_filepath(const int32_t key_id) const
+    {
+        return plain(key_id).medinv_filepath();
+    }
+
+    std::string sideinv_filepath(const int32_t key_id) const
+    {
+        return plain(key_id).sideinv_filepath();
+    }
+
+    std::shared_ptr<const InvertedIndex> index(const std::string& filepath,
+                                               const std::map<size_t, std::string>& segments) const
+    {
+        // the index is reloaded if the base file or any segment is changed
+        auto sig = file_signature(filepath);
+        for (const auto& seg : segments) {
+            sig += file_signature(seg.second);
+        }
+
+        auto it = index_cache_.find(filepath);
+        if (it != index_cache_.end() && it->second.signature == sig)
+        {
+            stats_count(kCounterIndexCacheHit);
+            return it->second.index;
+        }
+        stats_count(kCounterIndexCacheMiss);
+
+        std::shared_ptr<InvertedIndex> index(new InvertedIndex(filepath));
+        for (const auto& seg : segments) {
+            index->merge(InvertedIndex(seg.second));
+        }
+        index_cache_[filepath] = IndexCache{sig, index};
+        STDSC_LOG_TRACE("Loaded index. [%s, segments:%lu]", filepath.c_str(), segments.size());
+        return index;
+    }
+
+    std::shared_ptr<const InvertedIndex> medinv(const int32_t key_id) const
+    {
+        std::lock_guard<std::mutex> lock(index_mtx_);
+        const auto& layer = plain(key_id);
+        return index(layer.medinv_filepath(),
+                     layer.segment_filepaths(DEFAULT_MEDSEG_PREFIX));
+    }
+
+    std::shared_ptr<const InvertedIndex> sideinv(const int32_t key_id) const
+    {
+        std::lock_guard<std::mutex> lock(index_mtx_);
+        const auto& layer = plain(key_id);
+        return index(layer.sideinv_filepath(),
+                     layer.segment_filepaths(DEFAULT_SIDESEG_PREFIX));
+    }
+
+    std::shared_ptr<const AuxStore> aux(const int32_t key_id) const
+    {
+        plain(key_id);
+        return aux();
+    }
+
+    std::vector<int32_t> key_ids() const
+    {
+        std::vector<int32_t> ret;
+        std::lock_guard<std::mutex> lock(map_mtx_);
+        for (const auto& m : map_) {
+            ret.push_back(m.first);
+        }
+        return ret;
+    }
+
+    DBAppendResult append(const std::string& delta_csv,
+                          const std::string& db_src_filepath,
+                          const std::map<int32_t, const FHEPubKey*>& pubkeys)
+    {
+        STDSC_THROW_INVPARAM_IF_CHECK(!db_src_filepath.empty(),
+                                      "Err: DB source filepath is not given.");
+        std::lock_guard<std::mutex> lock(append_mtx_);
+        recover_append();
+        DBAppendResult result;
+
+        std::map<size_t, Record> records;
+        std::set<size_t> totalMedicines;
+        std::set<size_t> totalSymptoms;
+        auto reader = CsvReader::from_text(delta_csv);
+        parse_csv(reader, records, totalMedicines, totalSymptoms);
+
+        // without an up-to-date plaintext layer, the records are read from
+        // the DB source when the next key is set up
+        const bool up_to_date = plain_.is_enable() &&
+            sses_share::utility::file_exist(db_src_filepath) &&
+            plain_.source_signature() == file_signature(db_src_filepath);
+
+        // records already in the DB are never overwritten. the whole batch
+        // is rejected, so that the DB source never gets rows the DB does not
+        if (up_to_date) {
+            auto auxStore = aux();
+            AuxStore::Entry entry;
+            for (const auto& recordPair : records) {
+                if (auxStore->find(recordPair.first, entry)) {
+                    result.conflict_ids.push_back(static_cast<int32_t>(recordPair.first));
+                }
             }
+        } else {
+            result.conflict_ids = source_conflicts(db_src_filepath, records);
+        }
+        if (!result.conflict_ids.empty()) {
+            result.num_skipped = records.size();
+            STDSC_LOG_WARN("Rejected records to append. IDs already exist. [records:%lu, conflicts:%lu]",
+                           records.size(), result.conflict_ids.size());
+            return result;
+        }
+        if (records.empty()) {
+            return result;
+        }
 
-            std::vector<size_t> meds, sides;
-            for (const auto v : record.medicineIds) {
-                meds.push_back(v);
+        if (!up_to_date)
+        {
+            append_file(db_src_filepath, source_lines(delta_csv));
+            STDSC_LOG_INFO("Appended records to DB source. [records:%lu]", records.size());
+            result.num_applied = records.size();
+            return result;
+        }
+
+        // all set-up keys get the new records before they become visible
+        struct EncData
+        {
+            int32_t key_id;
+            std::string dirpath;
+            const FHEPubKey* pubkey;
+            size_t bytes;
+            std::vector<std::string> unsynced;
+        };
+        std::vector<EncData> encdata;
+        for (const auto& m : datasets()) {
+            if (!m.second.is_enable()) {
+                continue;
             }
-            for (const auto v : record.symptomIds) {
-                sides.push_back(v);
-            } 
+            STDSC_THROW_INVPARAM_IF_CHECK(pubkeys.count(m.first) > 0,
+                                          "Err: public key of set-up key is not given.");
+            encdata.push_back(EncData{m.first, m.second.encdata_dirpath(),
+                                      pubkeys.at(m.first), 0, {}});
+        }
 
+        const auto segdir = plain_.segment_dirpath();
+        if (!sses_share::utility::dir_exist(segdir)) {
+            STDSC_THROW_FILE_IF_CHECK(mkdir(segdir.c_str(), S_IRWXU) == 0,
+                                      "Err: failed to create segment directory");
+        }
+
+        auto medsegs = plain_.segment_filepaths(DEFAULT_MEDSEG_PREFIX);
+        auto sidesegs = plain_.segment_filepaths(DEFAULT_SIDESEG_PREFIX);
+        size_t seq = 1;
+        if (!medsegs.empty()) {
+            seq = std::max(seq, medsegs.rbegin()->first + 1);
+        }
+        if (!sidesegs.empty()) {
+            seq = std::max(seq, sidesegs.rbegin()->first + 1);
+        }
+
+        // the sizes before the append are recorded first, so that an
+        // append interrupted at any point can be rolled back
+        const auto lines = source_lines(delta_csv);
+        const auto dbbasicfilepath = plain_.dbbasic_filepath();
+        {
+            auto filepath = dbbasicfilepath;
+            DBBasicFile dbbasic(filepath);
+            const size_t srcBytes = sses_share::utility::file_size(db_src_filepath);
+            save_append_intent(plain_.append_intent_filepath(),
+                               AppendIntent{seq,
+                                            sses_share::utility::file_size(plain_.mask_filepath()),
+                                            srcBytes, srcBytes + lines.size(),
+                                            dbbasic.totalRecordsNum,
+                                            dbbasic.totalMedicinesNum,
+                                            dbbasic.totalSymptomsNum,
+                                            db_src_filepath});
+        }
+
+        STDSC_LOG_INFO("Start appending records. [keys:%lu, records:%lu]",
+                       encdata.size(), records.size());
+
+        try
+        {
+            const auto auxsegpath = plain_.segment_filepath(DEFAULT_AUXSEG_PREFIX, seq,
+                                                            DEFAULT_AUXSEG_EXTNAME);
+            InvertedIndex medSegment, sideSegment;
+            AuxStoreWriter auxSegment(auxsegpath + ".tmp");
+            std::vector<MaskEntry> masks;
+
+            for (const auto& recordPair : records)
             {
-                std::ofstream ofs(auxfilepath, std::ios::binary);
-                ofs << "Medicine: [" << meds[0];
-                for (size_t i = 1; i < meds.size(); ++i) {
-                    ofs << ", " << meds[i];
+                size_t recordId = recordPair.first;
+                const Record& record = recordPair.second;
+
+                for (auto& enc : encdata) {
+                    std::string encfilepath = enc.dirpath + "/" + std::to_string(recordId) + ".bin";
+                    enc.bytes += write_record(encfilepath, record.maskValue, *enc.pubkey);
+                    enc.unsynced.push_back(encfilepath);
                 }
-                ofs << "]" << std::endl;
-                ofs << "Side Effect: [" << sides[0];
-                for (size_t i = 1; i < sides.size(); ++i) {
-                    ofs << ", " << sides[i];
+                masks.push_back(MaskEntry{static_cast<int32_t>(recordId), record.maskValue});
+                auxSegment.add(recordId, record.medicineIds, record.symptomIds);
+
+                for (const auto v : record.medicineIds) {
+                    medSegment.add(v, recordId);
+                }
+                for (const auto v : record.symptomIds) {
+                    sideSegment.add(v, recordId);
                 }
-                ofs << "]" << std::endl;
-                STDSC_LOG_INFO("    | %s", auxfilepath.c_str());
             }
 
-            update(recordId,
-                   record.medicineIds.size(), meds,
-                   record.symptomIds.size(), sides,
-                   auxfilepath,
-                   medinvfilepath,
-                   sideinvfilepath);
-            STDSC_LOG_INFO("    | %s", medinvfilepath.c_str());
-            STDSC_LOG_INFO("    | %s", sideinvfilepath.c_str());
+            // the records are on the disk before the segments refer to them
+            for (auto& enc : encdata) {
+                sync_files(enc.unsynced, enc.dirpath);
+            }
+
+            // segments become visible to queries only when complete
+            const auto medsegpath = plain_.segment_filepath(DEFAULT_MEDSEG_PREFIX, seq);
+            const auto sidesegpath = plain_.segment_filepath(DEFAULT_SIDESEG_PREFIX, seq);
+            medSegment.save(medsegpath + ".tmp");
+            sideSegment.save(sidesegpath + ".tmp");
+            auxSegment.close();
+            for (const auto& path : {auxsegpath, medsegpath, sidesegpath}) {
+                sync_path(path + ".tmp");
+            }
+            {
+                std::lock_guard<std::mutex> lock(index_mtx_);
+                STDSC_THROW_FILE_IF_CHECK(
+                    ::rename((auxsegpath + ".tmp").c_str(), auxsegpath.c_str()) == 0 &&
+                    ::rename((medsegpath + ".tmp").c_str(), medsegpath.c_str()) == 0 &&
+                    ::rename((sidesegpath + ".tmp").c_str(), sidesegpath.c_str()) == 0,
+                    "Err: failed to add index segment");
+            }
+            sync_path(segdir);
+
+            // keys set up later encrypt the appended records as well
+            append_masks(plain_.mask_filepath(), masks);
+
+            auto filepath = dbbasicfilepath;
+            DBBasicFile dbbasic(filepath);
+            std::shared_ptr<const InvertedIndex> medIndex, sideIndex;
+            {
+                std::lock_guard<std::mutex> lock(index_mtx_);
+                medIndex = index(plain_.medinv_filepath(),
+                                 plain_.segment_filepaths(DEFAULT_MEDSEG_PREFIX));
+                sideIndex = index(plain_.sideinv_filepath(),
+                                  plain_.segment_filepaths(DEFAULT_SIDESEG_PREFIX));
+            }
+            dbbasic.write_to_file(filepath,
+                                  dbbasic.totalRecordsNum + records.size(),
+                                  medIndex->size(),
+                                  sideIndex->size());
+            sync_path(filepath);
+
+            // the append is committed when the signature of the grown
+            // source is saved
+            append_file(db_src_filepath, lines);
+            plain_.save_source_signature(file_signature(db_src_filepath));
+        }
+        catch (const std::exception& e)
+        {
+            STDSC_LOG_WARN("Failed to append records. Rolling back. (%s)", e.what());
+            recover_append();
+            throw;
         }
+        remove_append_intent();
 
-        STDSC_LOG_INFO("Finish generating DB data.");
+        if (medsegs.size() + 1 >= SSES_DEFAULT_MAX_INDEX_SEGMENTS) {
+            compactor_.request();
+        }
 
-        map_.emplace(key_id, DatasetInfo(top_dir));
+        {
+            std::lock_guard<std::mutex> lock(usage_->mtx);
+            for (const auto& enc : encdata) {
+                usage_->keys[enc.key_id].bytes += enc.bytes;
+            }
+        }
+        evict({});
         save_listfile(list_filepath_);
-        STDSC_LOG_INFO("Updated List file. [%s]", list_filepath_.c_str());
+        STDSC_LOG_INFO("DB usage : %s", usage().to_string().c_str());
+
+        STDSC_LOG_INFO("Finish appending records. [appended:%lu, keys:%lu]",
+                       records.size(), encdata.size());
+        result.num_applied = records.size();
+        result.num_keys = encdata.size();
+        return result;
     }
 
-    std::string dbbasic_filepath(const int32_t key_id) const
+    /**
+     * Finish or roll back an append interrupted by a crash or an error.
+     * Every step only cuts files back to the recorded sizes or removes the
+     * files of the append, so it can be repeated if interrupted itself.
+     */
+    void recover_append()
     {
-        return map_.at(key_id).dbbasic_filepath();
+        AppendIntent intent;
+        if (!load_append_intent(plain_.append_intent_filepath(), intent)) {
+            return;
+        }
+
+        const auto& srcpath = intent.srcFilepath;
+        const bool committed =
+            sses_share::utility::file_exist(srcpath) &&
+            sses_share::utility::file_size(srcpath) == intent.srcBytesAfter &&
+            plain_.source_signature() == file_signature(srcpath);
+        if (committed) {
+            STDSC_LOG_INFO("Finish interrupted append. [seq:%lu]", intent.seq);
+            remove_append_intent();
+            return;
+        }
+
+        STDSC_LOG_WARN("Roll back interrupted append. [seq:%lu]", intent.seq);
+        {
+            std::lock_guard<std::mutex> lock(index_mtx_);
+            for (const auto& path : {
+                     plain_.segment_filepath(DEFAULT_AUXSEG_PREFIX, intent.seq,
+                                             DEFAULT_AUXSEG_EXTNAME),
+                     plain_.segment_filepath(DEFAULT_MEDSEG_PREFIX, intent.seq),
+                     plain_.segment_filepath(DEFAULT_SIDESEG_PREFIX, intent.seq)}) {
+                for (const auto& p : {path, path + ".tmp"}) {
+                    if (sses_share::utility::file_exist(p)) {
+                        sses_share::utility::remove_file(p);
+                    }
+                }
+            }
+        }
+        if (sses_share::utility::dir_exist(plain_.segment_dirpath())) {
+            sync_path(plain_.segment_dirpath());
+        }
+        truncate_file(plain_.mask_filepath(), intent.maskBytes);
+
+        // the source is cut only if nothing but the append changed it, and
+        // then the layer is still built from it. otherwise the plaintext
+        // layer is built again from it.
+        if (sses_share::utility::file_exist(srcpath) &&
+            sses_share::utility::file_size(srcpath) <= intent.srcBytesAfter &&
+            truncate_file(srcpath, intent.srcBytes)) {
+            plain_.save_source_signature(file_signature(srcpath));
+        }
+
+        DBBasicFile dbbasic;
+        dbbasic.write_to_file(plain_.dbbasic_filepath(),
+                              intent.totalRecordsNum,
+                              intent.totalMedicinesNum,
+                              intent.totalSymptomsNum);
+        sync_path(plain_.dbbasic_filepath());
+
+        remove_append_intent();
     }
 
-    std::string medinv_filepath(const int32_t key_id) const
+    void remove_append_intent()
     {
-        return map_.at(key_id).medinv_filepath();
+        sses_share::utility::remove_file(plain_.append_intent_filepath());
+        sync_path(plain_.dir_);
     }
 
-    std::string sideinv_filepath(const int32_t key_id) const
+    void compact()
     {
-        return map_.at(key_id).sideinv_filepath();
+        std::lock_guard<std::mutex> lock(append_mtx_);
+
+        if (!plain_.is_enable()) {
+            return;
+        }
+        compact(plain_.medinv_filepath(),
+                plain_.segment_filepaths(DEFAULT_MEDSEG_PREFIX));
+        compact(plain_.sideinv_filepath(),
+                plain_.segment_filepaths(DEFAULT_SIDESEG_PREFIX));
+        compact_aux(plain_.auxstore_filepath(),
+                    plain_.segment_filepaths(DEFAULT_AUXSEG_PREFIX, DEFAULT_AUXSEG_EXTNAME));
     }
 
     std::string encdata_dirpath(const int32_t key_id) const
     {
+        std::lock_guard<std::mutex> lock(map_mtx_);
         return map_.at(key_id).encdata_dirpath();
     }
     
     std::string auxdata_dirpath(const int32_t key_id) const
     {
-        return map_.at(key_id).auxdata_dirpath();
+        return plain(key_id).auxdata_dirpath();
     }
     
 private:
+
+    /**
+     * Plaintext layer used by key. All keys share the same layer.
+     */
+    const PlainLayer& plain(const int32_t key_id) const
+    {
+        std::lock_guard<std::mutex> lock(map_mtx_);
+        map_.at(key_id);
+        return plain_;
+    }
+
+    /**
+     * Snapshot of the registered keys
+     */
+    std::unordered_map<int32_t, DatasetInfo> datasets() const
+    {
+        std::lock_guard<std::mutex> lock(map_mtx_);
+        return map_;
+    }
+
+    std::shared_ptr<const AuxStore> aux() const
+    {
+        std::lock_guard<std::mutex> lock(index_mtx_);
+
+        const auto auxstore_filepath = plain_.auxstore_filepath();
+        std::vector<std::string> filepaths = {auxstore_filepath};
+        for (const auto& seg : plain_.segment_filepaths(DEFAULT_AUXSEG_PREFIX,
+                                                        DEFAULT_AUXSEG_EXTNAME)) {
+            filepaths.push_back(seg.second);
+        }
+
+        std::string sig;
+        for (const auto& filepath : filepaths) {
+            sig += file_signature(filepath);
+        }
+
+        auto it = aux_cache_.find(auxstore_filepath);
+        if (it != aux_cache_.end() && it->second.signature == sig)
+        {
+            stats_count(kCounterAuxCacheHit);
+            return it->second.store;
+        }
+        stats_count(kCounterAuxCacheMiss);
+
+        std::shared_ptr<const AuxStore> store(new AuxStore(filepaths));
+        aux_cache_[auxstore_filepath] = AuxCache{sig, store};
+        STDSC_LOG_TRACE("Mapped aux store. [files:%lu]", filepaths.size());
+        return store;
+    }
+
+    /**
+     * Build the plaintext layer unless it is built from the current DB source
+     */
+    void setup_plain(const std::string& db_src_filepath)
+    {
+        const auto signature = file_signature(db_src_filepath);
+        if (plain_.is_enable() && plain_.source_signature() == signature) {
+            return;
+        }
+
+        // the masks encrypted from the previous version no longer match
+        for (const auto& m : datasets()) {
+            const auto ready_filepath = m.second.ready_filepath();
+            if (sses_share::utility::file_exist(ready_filepath)) {
+                sses_share::utility::remove_file(ready_filepath);
+                STDSC_LOG_WARN("DB source is changed. Key must be set up again. [keyID:%d]",
+                               m.first);
+            }
+        }
+
+        // the layer is built aside and replaced at once, so that a crashed
+        // build is never taken for a complete one
+        PlainLayer building(plain_.dir_ + DEFAULT_BUILDING_SUFFIX);
+        const auto& top_dir = building.dir_;
+
+        if (sses_share::utility::dir_exist(top_dir)) {
+            sses_share::utility::remove_dir(top_dir);
+            STDSC_LOG_INFO("Remove directory : %s", top_dir.c_str());
+        }
+
+        STDSC_LOG_INFO("Creating new DB. [In:%s, Out: %s]",
+                       db_src_filepath.c_str(),
+                       top_dir.c_str());
+        
+        STDSC_THROW_FILE_IF_CHECK(mkdir(top_dir.c_str(), S_IRWXU) == 0,
+                                  "Err: failed to create DB directory");
+        auto auxdata_dir = building.auxdata_dirpath();
+        STDSC_THROW_FILE_IF_CHECK(mkdir(auxdata_dir.c_str(), S_IRWXU) == 0,
+                                  "Err: failed to create DB directory");
+
+        // rows are grouped by record ID with external sort runs so that
+        // memory use does not depend on the size of the CSV
+        auto ingest_dir = top_dir + "/" + std::string(DEFAULT_INGEST_DIRNAME);
+        STDSC_THROW_FILE_IF_CHECK(mkdir(ingest_dir.c_str(), S_IRWXU) == 0,
+                                  "Err: failed to create DB directory");
+
+        ExternalSorter<CsvRow, CsvRowLess> rows(ingest_dir, "rows",
+                                                SSES_DEFAULT_INGEST_BLOCK_ROWS,
+                                                SSES_DEFAULT_INGEST_MERGE_FANIN);
+        {
+            auto start = std::chrono::steady_clock::now();
+
+            CsvReader reader(db_src_filepath);
+            CsvColumns cols(reader);
+            std::vector<CsvReader::Field> fields;
+            while (reader.next(fields))
+            {
+                CsvRow row;
+                parse_csv_row(fields, cols, row);
+                rows.push(row);
+            }
+
+            std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+            STDSC_LOG_INFO("Read DB source. [rows:%lu, bytes:%lu, %.3f sec, %.3f GB/s]",
+                           rows.size(), reader.bytes_read(), elapsed.count(),
+                           reader.bytes_read() / std::max(elapsed.count(), 1e-9) / 1e9);
+        }
+
+        auto dbbasicfilepath = building.dbbasic_filepath();
+        auto medinvfilepath = building.medinv_filepath();
+        auto sideinvfilepath = building.sideinv_filepath();
+
+        ExternalSorter<Posting, PostingLess> medPostings(ingest_dir, "med",
+                                                         SSES_DEFAULT_INGEST_BLOCK_ROWS,
+                                                         SSES_DEFAULT_INGEST_MERGE_FANIN);
+        ExternalSorter<Posting, PostingLess> sidePostings(ingest_dir, "side",
+                                                          SSES_DEFAULT_INGEST_BLOCK_ROWS,
+                                                          SSES_DEFAULT_INGEST_MERGE_FANIN);
+        std::map<uint32_t, size_t> medCounts;
+        std::map<uint32_t, size_t> sideCounts;
+        size_t totalRecordsNum = 0;
+
+        auto auxstorefilepath = building.auxstore_filepath();
+        AuxStoreWriter auxWriter(auxstorefilepath);
+
+        auto maskfilepath = building.mask_filepath();
+        std::ofstream maskofs(maskfilepath, std::ios::binary);
+
+        STDSC_LOG_INFO("Start generating DB data.");
+
+        auto emit = [&](const size_t recordId, const Record& record) {
+            STDSC_LOG_INFO("  recID:%lu, numMed:%lu, numSide:%lu",
+                           recordId,
+                           record.medicineIds.size(),
+                           record.symptomIds.size());
+
+            MaskEntry mask{static_cast<int32_t>(recordId), record.maskValue};
+            maskofs.write(reinterpret_cast<const char*>(&mask), sizeof(mask));
+            auxWriter.add(recordId, record.medicineIds, record.symptomIds);
+
+            for (const auto v : record.medicineIds) {
+                medPostings.push(Posting{static_cast<uint32_t>(v), recordId});
+                ++medCounts[v];
+            }
+            for (const auto v : record.symptomIds) {
+                sidePostings.push(Posting{static_cast<uint32_t>(v), recordId});
+                ++sideCounts[v];
+            }
+            ++totalRecordsNum;
+        };
+
+        bool has_record = false;
+        size_t recordId = 0;
+        Record record;
+        rows.for_each([&](const CsvRow& row) {
+            if (has_record && row.recordId != recordId) {
+                emit(recordId, record);
+                has_record = false;
+            }
+            if (!has_record) {
+                recordId = row.recordId;
+                record = Record{row.maskValue, {}, {}};
+                has_record = true;
+            }
+            record.medicineIds.insert(row.medicineId);
+            record.symptomIds.insert(row.symptomId);
+        });
+        if (has_record) {
+            emit(recordId, record);
+        }
+
+        maskofs.close();
+        STDSC_THROW_FILE_IF_CHECK(!maskofs.fail(),
+                                  "Err: failed to write mask file. (" + maskfilepath + ")");
+        STDSC_LOG_INFO("Created mask file. [%s]", maskfilepath.c_str());
+
+        auxWriter.close();
+        STDSC_LOG_INFO("Created aux store file. [%s]", auxstorefilepath.c_str());
+
+        write_index(medinvfilepath, medCounts, medPostings);
+        STDSC_LOG_INFO("Created index file. [%s]", medinvfilepath.c_str());
+        write_index(sideinvfilepath, sideCounts, sidePostings);
+        STDSC_LOG_INFO("Created index file. [%s]", sideinvfilepath.c_str());
+
+        sses_share::utility::remove_dir(ingest_dir);
+
+        building.save_source_signature(signature);
+        {
+            std::ostringstream oss;
+            oss << std::time(nullptr) << "-" << std::random_device()();
+            write_file(building.build_id_filepath(), oss.str());
+        }
+
+        DBBasicFile dbbasicfile;
+        dbbasicfile.write_to_file(dbbasicfilepath,
+                                  totalRecordsNum,
+                                  medCounts.size(),
+                                  sideCounts.size());
+        STDSC_LOG_INFO("Created DBBasic file. [%s]", dbbasicfilepath.c_str());
+
+        for (const auto& path : {maskfilepath, auxstorefilepath, medinvfilepath,
+                                 sideinvfilepath, dbbasicfilepath, auxdata_dir, top_dir}) {
+            sync_path(path);
+        }
+
+        if (sses_share::utility::dir_exist(plain_.dir_)) {
+            sses_share::utility::remove_dir(plain_.dir_);
+            STDSC_LOG_INFO("Remove directory : %s", plain_.dir_.c_str());
+        }
+        STDSC_THROW_FILE_IF_CHECK(
+            ::rename(top_dir.c_str(), plain_.dir_.c_str()) == 0,
+            "Err: failed to publish DB directory");
+        sync_path(db_basedir_);
+
+        STDSC_LOG_INFO("Finish generating DB data.");
+    }
     
+    /**
+     * Evict the encrypted masks of least recently used keys until the
+     * disk usage is within the budget
+     * @param[in] keep keys not to evict
+     */
+    void evict(const std::set<int32_t>& keep)
+    {
+        if (max_disk_bytes_ == 0) {
+            return;
+        }
+
+        const auto dsinfos = datasets();
+        while (true)
+        {
+            int32_t victim = 0;
+            size_t total = 0;
+            bool found = false;
+            {
+                std::lock_guard<std::mutex> lock(usage_->mtx);
+                const UsageTable::Key* oldest = nullptr;
+                for (const auto& k : usage_->keys) {
+                    total += k.second.bytes;
+                    if (k.second.bytes == 0 || k.second.leases > 0 ||
+                        keep.count(k.first) > 0 || dsinfos.count(k.first) == 0) {
+                        continue;
+                    }
+                    if (!oldest || k.second.last_used < oldest->last_used) {
+                        oldest = &k.second;
+                        victim = k.first;
+                    }
+                }
+                if (total <= max_disk_bytes_) {
+                    break;
+                }
+                if (oldest) {
+                    // queries acquired after this see the key disabled and set it up again
+                    sses_share::utility::remove_file(dsinfos.at(victim).ready_filepath());
+                    usage_->keys[victim].bytes = 0;
+                    ++usage_->num_evictions;
+                    found = true;
+                }
+            }
+
+            if (!found) {
+                STDSC_LOG_WARN("DB exceeds disk budget, but no key can be evicted. "
+                               "[bytes:%lu, budget:%lu]", total, max_disk_bytes_);
+                break;
+            }
+
+            sses_share::utility::remove_dir(dsinfos.at(victim).dir_);
+            STDSC_LOG_INFO("Evicted DB of least recently used key. [keyID:%d, bytes:%lu, budget:%lu]",
+                           victim, total, max_disk_bytes_);
+        }
+    }
+
     void load_listfile(const std::string& filepath)
     {
         std::ifstream ifs(filepath);
@@ -438,144 +1749,134 @@ private:
                 std::vector<std::string> elems;
                 boost::algorithm::split(elems, line, boost::is_any_of(","));
 
-                map_.emplace(std::stoi(elems[0]), DatasetInfo(elems[1]));
+                auto key_id = std::stoi(elems[0]);
+                DatasetInfo dsinfo(elems[1]);
+                auto& usage = usage_->keys[key_id];
+                if (elems.size() >= 4) {
+                    usage.bytes = std::stoul(elems[2]);
+                    usage.last_used = std::stol(elems[3]);
+                } else if (dsinfo.is_enable()) {
+                    usage.bytes = dir_size(dsinfo.encdata_dirpath());
+                }
+                map_.emplace(key_id, dsinfo);
             }
         }
     }
 
-    void save_listfile(const std::string& filepath)
+    /**
+     * Save the keys with their usage. It is called on setup, append and
+     * eviction, and periodically by queries to keep the last use.
+     */
+    void save_listfile(const std::string& filepath) const
     {
-        std::ofstream ofs(filepath);
-        if (ofs.is_open()) {
-            ofs << map_.size() << std::endl;
+        std::lock_guard<std::mutex> list_lock(list_mtx_);
+        const auto dsinfos = datasets();
+        std::ostringstream ofs;
+        {
+            std::lock_guard<std::mutex> lock(usage_->mtx);
+            ofs << dsinfos.size() << std::endl;
 
-            for (const auto& v : map_) {
+            for (const auto& v : dsinfos) {
+                const auto& usage = usage_->keys[v.first];
                 ofs << v.first;
                 ofs << ",";
                 ofs << v.second.dir_;
+                ofs << ",";
+                ofs << usage.bytes;
+                ofs << ",";
+                ofs << usage.last_used;
                 ofs << std::endl;
             }
         }
+        publish_file(filepath, ofs.str());
+        list_saved_time_ = std::time(nullptr);
     }
 
-    void update(const size_t recordId,
-                const size_t numMed,
-                const std::vector<size_t>& meds,
-                const size_t numSide,
-                const std::vector<size_t>& sides,
-                const std::string& auxfilepath,
-                const std::string& medinvfilepath,
-                const std::string& sideinvfilepath)
+private:
+    void compact(const std::string& filepath,
+                 const std::map<size_t, std::string>& segments)
     {
-        std::map<int, std::vector<int>> medIndex;
-        std::map<int, std::vector<int>> sideIndex;
+        if (segments.empty()) {
+            return;
+        }
 
-        std::ofstream faux(auxfilepath.c_str(), std::ios::binary);
-        faux << "Medicine: [" << meds[0];
-        for (size_t i = 1; i < numMed; ++i) {
-            faux << ", " << meds[i];
+        InvertedIndex index(filepath);
+        for (const auto& seg : segments) {
+            index.merge(InvertedIndex(seg.second));
         }
-        faux << "]" << std::endl;
-        faux << "Side Effect: [" << sides[0];
-        for (size_t i = 1; i < numSide; ++i) {
-            faux << ", " << sides[i];
+        index.save(filepath + ".tmp");
+
+        // queries see either the old index with the segments or the new one
+        std::lock_guard<std::mutex> lock(index_mtx_);
+        STDSC_THROW_FILE_IF_CHECK(
+            ::rename((filepath + ".tmp").c_str(), filepath.c_str()) == 0,
+            "Err: failed to replace index file");
+        for (const auto& seg : segments) {
+            sses_share::utility::remove_file(seg.second);
         }
-        faux << "]" << std::endl;
-        faux.close();
-        
-        
-        std::ifstream findexmed(medinvfilepath, std::ios::binary);
-        std::string line;
-        std::vector<std::string> medInfo;
-        int numMedDict;
-        findexmed >> numMedDict;
-        for (int i = 0; i < numMedDict; ++i)
-        {
-            findexmed >> line;
-            boost::algorithm::split(medInfo, line, boost::is_any_of(":"));
-            int medId = std::stoi(medInfo[0]);
-            int numindex = std::stoi(medInfo[1]);
-            std::vector<int> tempindex;
-            while (numindex--)
-            {
-                int temprec;
-                findexmed >> temprec;
-                tempindex.push_back(temprec);
-            }
-            medIndex.insert(std::make_pair(medId, tempindex));
-        }
-        findexmed.close();
+    }
 
-        std::ifstream findexside(sideinvfilepath, std::ios::binary);
-        std::vector<std::string> sideInfo;
-        int numSideDict;
-        findexside >> numSideDict;
-        for (int i = 0; i < numSideDict; ++i)
-        {
-            findexside >> line;
-            boost::algorithm::split(sideInfo, line, boost::is_any_of(":"));
-            int sideId = std::stoi(sideInfo[0]);
-            int numindex = std::stoi(sideInfo[1]);
-            std::vector<int> tempindex;
-            while (numindex--)
-            {
-                int temprec;
-                findexside >> temprec;
-                tempindex.push_back(temprec);
-            }
-            sideIndex.insert(make_pair(sideId, tempindex));
+    void compact_aux(const std::string& filepath,
+                     const std::map<size_t, std::string>& segments)
+    {
+        if (segments.empty()) {
+            return;
         }
-        findexside.close();
 
-        for (size_t i = 0; i < numMed; ++i) {
-            medIndex[meds[i]].push_back(recordId);
-        }
-        for (size_t i = 0; i < numSide; ++i) {
-            sideIndex[sides[i]].push_back(recordId);
+        std::vector<std::string> filepaths = {filepath};
+        for (const auto& seg : segments) {
+            filepaths.push_back(seg.second);
         }
-        STDSC_LOG_TRACE("Updated rev index");
 
-        std::ofstream findexmedw(medinvfilepath, std::ios::binary);
-        findexmedw << numMedDict << std::endl;
-
-        for (const auto& medIdxPair : medIndex)
         {
-            int medId = medIdxPair.first;
-            std::vector<int> recordIds = medIdxPair.second;
-            findexmedw << medId << ":" << recordIds.size() << std::endl;
-            for (const int& recordId : recordIds)
-            {
-                findexmedw << recordId << std::endl;
-            }
+            AuxStore store(filepaths);
+            AuxStoreWriter writer(filepath + ".tmp");
+            store.for_each([&writer](const int32_t record_id, const AuxStore::Entry& entry) {
+                writer.add(record_id, entry);
+            });
+            writer.close();
         }
-        findexmedw.close();
 
-        std::ofstream findexsidew(sideinvfilepath, std::ios::binary);
-        findexsidew << numSideDict << std::endl;
-        for (const auto& sideIdxPair : sideIndex)
-        {
-            int sideId = sideIdxPair.first;
-            std::vector<int> recordIds = sideIdxPair.second;
-            findexsidew << sideId << ":" << recordIds.size() << std::endl;
-            for (const int& recordId : recordIds)
-            {
-                findexsidew << recordId << std::endl;
-            }
+        // mapped stores keep the replaced files alive until released
+        std::lock_guard<std::mutex> lock(index_mtx_);
+        STDSC_THROW_FILE_IF_CHECK(
+            ::rename((filepath + ".tmp").c_str(), filepath.c_str()) == 0,
+            "Err: failed to replace aux store file");
+        for (const auto& seg : segments) {
+            sses_share::utility::remove_file(seg.second);
         }
-        findexsidew.close();
-
-        STDSC_LOG_TRACE("New record id: %lu", recordId);
-        STDSC_LOG_TRACE("DB successfully updated.");
     }
 
-private:
+    struct IndexCache
+    {
+        std::string signature;
+        std::shared_ptr<const InvertedIndex> index;
+    };
+
+    struct AuxCache
+    {
+        std::string signature;
+        std::shared_ptr<const AuxStore> store;
+    };
+
     std::string db_basedir_;
     std::string list_filepath_;
+    size_t max_disk_bytes_;
+    PlainLayer plain_;
     std::unordered_map<int32_t, DatasetInfo> map_;
+    mutable std::mutex map_mtx_;
+    mutable std::unordered_map<std::string, IndexCache> index_cache_;
+    mutable std::unordered_map<std::string, AuxCache> aux_cache_;
+    std::shared_ptr<UsageTable> usage_;
+    mutable std::mutex index_mtx_;
+    std::mutex append_mtx_;
+    mutable std::mutex list_mtx_;
+    mutable std::time_t list_saved_time_ = 0;
+    IndexCompactor compactor_;
 };
     
-DB::DB(const std::string& db_basedir)
-  : pimpl_(new Impl(db_basedir))
+DB::DB(const std::string& db_basedir, const size_t max_disk_bytes)
+  : pimpl_(new Impl(db_basedir, max_disk_bytes))
 {}
 
 bool DB::is_enable(const int32_t key_id) const
@@ -586,9 +1887,10 @@ bool DB::is_enable(const int32_t key_id) const
 void DB::setup(const int32_t key_id,
                const std::string& db_src_filepath,
                const FHEcontext& context,
-               const FHEPubKey& pubkey)
+               const FHEPubKey& pubkey,
+               std::function<void(const size_t, const size_t)> progress)
 {
-    pimpl_->setup(key_id, db_src_filepath, context, pubkey);
+    pimpl_->setup(key_id, db_src_filepath, context, pubkey, progress);
 }
 
 std::string DB::dbbasic_filepath(const int32_t key_id) const
@@ -606,6 +1908,72 @@ std::string DB::sideinv_filepath(const int32_t key_id) const
         return pimpl_->sideinv_filepath(key_id);
 }
 
+std::shared_ptr<const InvertedIndex> DB::medinv(const int32_t key_id) const
+{
+    return pimpl_->medinv(key_id);
+}
+
+std::shared_ptr<const InvertedIndex> DB::sideinv(const int32_t key_id) const
+{
+    return pimpl_->sideinv(key_id);
+}
+
+std::shared_ptr<const AuxStore> DB::aux(const int32_t key_id) const
+{
+    return pimpl_->aux(key_id);
+}
+
+std::vector<int32_t> DB::key_ids() const
+{
+    return pimpl_->key_ids();
+}
+
+DBAppendResult DB::append(const std::string& delta_csv,
+                          const std::string& db_src_filepath,
+                          const std::map<int32_t, const FHEPubKey*>& pubkeys)
+{
+    return pimpl_->append(delta_csv, db_src_filepath, pubkeys);
+}
+
+void DB::compact()
+{
+    pimpl_->compact();
+}
+
+std::shared_ptr<void> DB::acquire(const int32_t key_id) const
+{
+    return pimpl_->acquire(key_id);
+}
+
+DBUsage DB::usage() const
+{
+    return pimpl_->usage();
+}
+
+DBAppendResult append_records(DB& db,
+                              sses_share::FHEKeyContainer& key_container,
+                              const std::string& delta_csv,
+                              const std::string& db_src_filepath)
+{
+    // the public keys refer to the contexts
+    std::vector<std::shared_ptr<FHEcontext>> contexts;
+    std::vector<std::shared_ptr<FHEPubKey>> keys;
+    std::map<int32_t, const FHEPubKey*> pubkeys;
+    for (const auto& key_id : db.key_ids())
+    {
+        if (!db.is_enable(key_id)) {
+            continue;
+        }
+        key_container.setup(key_id);
+        contexts.emplace_back(new FHEcontext(key_container.get_context(key_id)));
+        keys.emplace_back(new FHEPubKey(*contexts.back()));
+        key_container.get(key_id, sses_share::KeyKind_t::kKindPubKey, *keys.back());
+        pubkeys.emplace(key_id, keys.back().get());
+    }
+
+    return db.append(delta_csv, db_src_filepath, pubkeys);
+}
+
 std::string DB::encdata_dirpath(const int32_t key_id) const
 {
     return pimpl_->encdata_dirpath(key_id);
@@ -18,17 +18,35 @@
 #ifndef SSES_SERVER_DB_HPP
 #define SSES_SERVER_DB_HPP
 
+#include <ctime>
+#include <functional>
+#include <map>
 #include <memory>
 #include <string>
+#include <vector>
+
+#include <sses_share/sses_define.hpp>
 
 class FHEcontext;
 class FHEPubKey;
 
+namespace sses_share
+{
+class FHEKeyContainer;
+}
+
 namespace sses_server
 {
 
+class InvertedIndex;
+class AuxStore;
+struct DBUsage;
+struct DBAppendResult;
+
 /**
  * @brief This class is used to hold the basic data, medicine data, and side effect data.
+ * The plaintext data (basic data, inverted index and aux data) is shared by
+ * all keys, and only the encrypted masks are held for each key.
  */
 class DB
 {
@@ -36,8 +54,12 @@ public:
     /**
      * Constructor
      * @param[in] db_basedir DB base directory
+     * @param[in] max_disk_bytes disk budget of the encrypted data of keys (0: unlimited)
+     * @note When the budget is exceeded, the encrypted data of the least
+     * recently used keys is evicted. Evicted keys are set up again when used.
      */
-    DB(const std::string& db_basedir);
+    DB(const std::string& db_basedir,
+       const size_t max_disk_bytes = SSES_DEFAULT_MAX_DB_DISK_BYTES);
     virtual ~DB() = default;
 
     /**
@@ -53,11 +75,61 @@ public:
      * @param[in] db_src_filepath DB source filepath
      * @param[in] context FHE Context
      * @param[in] pubkey FHE Publickey
+     * @param[in] progress function called with the number of encrypted records and the total
+     * @note The plaintext data is built only when it is not built from the
+     * current DB source. If it is rebuilt, the other keys must be set up again.
+     * Appends are not blocked while the masks are encrypted. The records
+     * appended meanwhile are encrypted before the key becomes ready.
      */
     void setup(const int32_t key_id,
                const std::string& db_src_fiilepath,
                const FHEcontext& context,
-               const FHEPubKey& pubkey);
+               const FHEPubKey& pubkey,
+               std::function<void(const size_t, const size_t)> progress = nullptr);
+
+    /**
+     * Append records
+     * @param[in] delta_csv CSV of records to append (same columns as DB source)
+     * @param[in] db_src_filepath DB source filepath to append the records to
+     * @param[in] pubkeys FHE Publickeys of all set-up keys
+     * @return numbers of appended and skipped records
+     * @note Only new records are encrypted. If any record ID already exists,
+     * nothing is appended and the IDs are returned. The index entries are
+     * written as a new segment, and the segments are merged in the
+     * background. An append interrupted by a crash is rolled back when the
+     * DB is opened again.
+     */
+    DBAppendResult append(const std::string& delta_csv,
+                          const std::string& db_src_filepath,
+                          const std::map<int32_t, const FHEPubKey*>& pubkeys);
+
+    /**
+     * Merge index segments into the index files
+     */
+    void compact();
+
+    /**
+     * Acquire key for query
+     * @param[in] key_id key ID
+     * @return lease of key. The encrypted data of the key is not evicted
+     * while the lease is alive.
+     * @note The last query time of the key is updated. It is saved to the
+     * list file at most every SSES_DEFAULT_USAGE_SAVE_INTERVAL_SEC seconds,
+     * and whenever keys are set up, appended to or evicted.
+     */
+    std::shared_ptr<void> acquire(const int32_t key_id) const;
+
+    /**
+     * Get disk usage
+     * @return disk usage of keys
+     */
+    DBUsage usage() const;
+
+    /**
+     * Get registered key IDs
+     * @return key IDs
+     */
+    std::vector<int32_t> key_ids() const;
 
     /**
      * Get DBBasic filepath
@@ -80,6 +152,31 @@ public:
      */
     std::string sideinv_filepath(const int32_t key_id) const;
 
+    /**
+     * Get MED INV
+     * @param[in] key_id key ID
+     * @return MED INV
+     * @note The index is cached and reloaded when the file is updated.
+     */
+    std::shared_ptr<const InvertedIndex> medinv(const int32_t key_id) const;
+
+    /**
+     * Get SIDE INV
+     * @param[in] key_id key ID
+     * @return SIDE INV
+     * @note The index is cached and reloaded when the file is updated.
+     */
+    std::shared_ptr<const InvertedIndex> sideinv(const int32_t key_id) const;
+
+    /**
+     * Get aux data store
+     * @param[in] key_id key ID
+     * @return aux data store
+     * @note The store files are mapped to memory once, and mapped again
+     * when they are updated.
+     */
+    std::shared_ptr<const AuxStore> aux(const int32_t key_id) const;
+
     /**
      * Get EncData dirpath
      * @param[in] key_id key ID
@@ -98,6 +195,55 @@ private:
     std::shared_ptr<Impl> pimpl_;
 };
 
+/**
+ * @brief This class is used to hold the result of appending records.
+ */
+struct DBAppendResult
+{
+    size_t num_applied = 0; ///< records appended to the DB of every key
+    size_t num_skipped = 0; ///< records not appended as the batch is rejected
+    size_t num_keys = 0;    ///< keys whose encrypted data got the records
+    std::vector<int32_t> conflict_ids; ///< IDs already in the DB (batch is rejected)
+};
+
+/**
+ * Append records to the DB of all registered keys
+ * @param[in] db DB
+ * @param[in] key_container FHE key container
+ * @param[in] delta_csv CSV text of records to append
+ * @param[in] db_src_filepath DB source filepath to append the records to
+ * @return numbers of appended and skipped records
+ */
+DBAppendResult append_records(DB& db,
+                              sses_share::FHEKeyContainer& key_container,
+                              const std::string& delta_csv,
+                              const std::string& db_src_filepath);
+
+/**
+ * @brief This class is used to hold the disk usage of DB.
+ */
+struct DBUsage
+{
+    struct Key
+    {
+        int32_t key_id;
+        size_t bytes;          ///< size of the encrypted data (0: evicted)
+        std::time_t last_used; ///< last time the key was used by query
+        bool enabled;
+    };
+
+    /**
+     * Stringfy
+     * @return string of usage
+     */
+    std::string to_string() const;
+
+    size_t max_bytes = 0;     ///< disk budget (0: unlimited)
+    size_t total_bytes = 0;
+    size_t num_evictions = 0;
+    std::vector<Key> keys;
+};
+
 /**
  * @brief This class is used to hold the basic data.
  */
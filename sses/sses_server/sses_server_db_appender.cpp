@@ -0,0 +1,179 @@
+/*
+ * Copyright 2020 Yamana Laboratory, Waseda University
+ * Supported by JST CREST Grant Number JPMJCR1503, Japan.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE‐2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <mutex>
+
+#include "FHE.h"
+
+#include <stdsc/stdsc_exception.hpp>
+#include <stdsc/stdsc_log.hpp>
+
+#include <sses_share/sses_fhekey_container.hpp>
+#include <sses_server/sses_server_db.hpp>
+#include <sses_server/sses_server_db_appender.hpp>
+
+namespace sses_server
+{
+
+struct DBAppender::Impl
+{
+    Impl(DB& db,
+         sses_share::FHEKeyContainer& key_container,
+         const std::string& db_src_filepath)
+        : db_(db),
+          key_container_(key_container),
+          db_src_filepath_(db_src_filepath)
+    {
+        te_ = stdsc::ThreadException::create();
+    }
+
+    ~Impl(void)
+    {
+        fail_appends();
+    }
+
+    void exec(DBAppenderParam& args, std::shared_ptr<stdsc::ThreadException> te)
+    {
+        while (true)
+        {
+            AppendJob job;
+            {
+                std::unique_lock<std::mutex> lock(mtx_);
+                cond_.wait(lock, [&] { return args.force_finish || !appends_.empty(); });
+                if (args.force_finish)
+                {
+                    break;
+                }
+                job = std::move(appends_.front());
+                appends_.pop_front();
+            }
+
+            try
+            {
+                job.promise.set_value(
+                  append_records(db_, key_container_, job.csv, db_src_filepath_));
+            }
+            catch (const std::exception& e)
+            {
+                STDSC_LOG_WARN("Failed to append records. (%s)", e.what());
+                job.promise.set_exception(std::current_exception());
+            }
+            catch (...)
+            {
+                STDSC_LOG_WARN("Failed to append records. (unknown error)");
+                job.promise.set_exception(std::current_exception());
+            }
+        }
+
+        fail_appends();
+    }
+
+    void stop(DBAppenderParam& args)
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        args.force_finish = true;
+        cond_.notify_all();
+    }
+
+    std::future<DBAppendResult> append(const std::string& delta_csv)
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        if (param_.force_finish) {
+            std::promise<DBAppendResult> promise;
+            promise.set_exception(std::make_exception_ptr(
+              stdsc::FailureException("Err: DB appender is stopped.")));
+            return promise.get_future();
+        }
+        appends_.emplace_back();
+        appends_.back().csv = delta_csv;
+        auto future = appends_.back().promise.get_future();
+        cond_.notify_all();
+        STDSC_LOG_INFO("Requested append of records. [pending:%lu]", appends_.size());
+        return future;
+    }
+
+    std::shared_ptr<stdsc::ThreadException> te_;
+    DBAppenderParam param_;
+
+private:
+    struct AppendJob
+    {
+        std::string csv;
+        std::promise<DBAppendResult> promise;
+    };
+
+    /**
+     * Complete the appends left when the thread is stopped, so that the
+     * callers waiting for them do not get broken promises
+     */
+    void fail_appends(void)
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        for (auto& job : appends_) {
+            job.promise.set_exception(std::make_exception_ptr(
+              stdsc::FailureException("Err: DB appender is stopped.")));
+        }
+        appends_.clear();
+    }
+
+    DB& db_;
+    sses_share::FHEKeyContainer& key_container_;
+    std::string db_src_filepath_;
+    std::deque<AppendJob> appends_;
+    std::mutex mtx_;
+    std::condition_variable cond_;
+};
+
+DBAppender::DBAppender(DB& db,
+                       sses_share::FHEKeyContainer& key_container,
+                       const std::string& db_src_filepath)
+    : pimpl_(new Impl(db, key_container, db_src_filepath))
+{
+}
+
+DBAppender::~DBAppender(void)
+{
+    stop();
+    super::join();
+}
+
+void DBAppender::start()
+{
+    pimpl_->param_.force_finish = false;
+    super::start(pimpl_->param_, pimpl_->te_);
+}
+
+void DBAppender::stop()
+{
+    pimpl_->stop(pimpl_->param_);
+}
+
+std::future<DBAppendResult> DBAppender::append(const std::string& delta_csv)
+{
+    return pimpl_->append(delta_csv);
+}
+
+void DBAppender::exec(DBAppenderParam& args,
+                      std::shared_ptr<stdsc::ThreadException> te) const
+{
+    pimpl_->exec(args, te);
+}
+
+} /* namespace sses_server */
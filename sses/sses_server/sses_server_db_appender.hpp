@@ -0,0 +1,98 @@
+/*
+ * Copyright 2020 Yamana Laboratory, Waseda University
+ * Supported by JST CREST Grant Number JPMJCR1503, Japan.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE‐2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SSES_SERVER_DB_APPENDER_HPP
+#define SSES_SERVER_DB_APPENDER_HPP
+
+#include <cstdbool>
+#include <future>
+#include <memory>
+#include <string>
+
+#include <stdsc/stdsc_thread.hpp>
+
+namespace sses_share
+{
+class FHEKeyContainer;
+}
+
+namespace sses_server
+{
+
+class DB;
+class DBAppenderParam;
+struct DBAppendResult;
+
+/**
+ * @brief Appends records to the DB in the background, one batch at a time.
+ * Appends run beside the setups of DBBuilder and are ordered against them
+ * by the DB.
+ */
+class DBAppender : public stdsc::Thread<DBAppenderParam>
+{
+    using super = stdsc::Thread<DBAppenderParam>;
+
+public:
+    /**
+     * Constructor
+     * @param[in] db DB
+     * @param[in] key_container FHE key container
+     * @param[in] db_src_filepath DB source filepath
+     */
+    DBAppender(DB& db,
+               sses_share::FHEKeyContainer& key_container,
+               const std::string& db_src_filepath);
+    virtual ~DBAppender(void);
+
+    /**
+     * Start thread
+     */
+    void start();
+
+    /**
+     * Stop thread
+     */
+    void stop();
+
+    /**
+     * Request append of records to the DB of all set-up keys
+     * @param[in] delta_csv CSV text of records to append
+     * @return future of numbers of appended and skipped records. It throws
+     * the error of the append, or FailureException if the thread is stopped.
+     */
+    std::future<DBAppendResult> append(const std::string& delta_csv);
+
+private:
+    virtual void exec(
+      DBAppenderParam& args,
+      std::shared_ptr<stdsc::ThreadException> te) const override;
+
+    struct Impl;
+    std::shared_ptr<Impl> pimpl_;
+};
+
+/**
+ * @brief This class is used to hold the parameters for DBAppender.
+ */
+struct DBAppenderParam
+{
+    bool force_finish = false;
+};
+
+} /* namespace sses_server */
+
+#endif /* SSES_SERVER_DB_APPENDER_HPP */
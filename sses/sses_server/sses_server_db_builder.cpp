@@ -0,0 +1,237 @@
+/*
+ * Copyright 2020 Yamana Laboratory, Waseda University
+ * Supported by JST CREST Grant Number JPMJCR1503, Japan.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE‐2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <unordered_map>
+
+#include "FHE.h"
+
+#include <stdsc/stdsc_exception.hpp>
+#include <stdsc/stdsc_log.hpp>
+
+#include <sses_share/sses_fhekey_container.hpp>
+#include <sses_server/sses_server_db.hpp>
+#include <sses_server/sses_server_db_appender.hpp>
+#include <sses_server/sses_server_db_builder.hpp>
+
+namespace sses_server
+{
+
+struct DBBuilder::Impl
+{
+    Impl(DB& db,
+         sses_share::FHEKeyContainer& key_container,
+         const std::string& db_src_filepath)
+        : appender_(db, key_container, db_src_filepath),
+          db_(db),
+          key_container_(key_container),
+          db_src_filepath_(db_src_filepath)
+    {
+        te_ = stdsc::ThreadException::create();
+    }
+
+    void exec(DBBuilderParam& args, std::shared_ptr<stdsc::ThreadException> te)
+    {
+        while (true)
+        {
+            int32_t key_id;
+            {
+                std::unique_lock<std::mutex> lock(mtx_);
+                cond_.wait(lock, [&] { return args.force_finish || !pending_.empty(); });
+                if (args.force_finish)
+                {
+                    break;
+                }
+                key_id = pending_.front();
+                pending_.pop_front();
+                jobs_[key_id] = Job{sses_share::kDBStatusBuilding, 0};
+            }
+
+            auto status = sses_share::kDBStatusReady;
+            try
+            {
+                STDSC_LOG_INFO("Start setting up DB. [keyID:%d]", key_id);
+
+                key_container_.setup(key_id);
+                auto context = key_container_.get_context(key_id);
+                FHEPubKey pubkey(context);
+                key_container_.get(key_id, sses_share::KeyKind_t::kKindPubKey, pubkey);
+
+                db_.setup(key_id, db_src_filepath_, context, pubkey,
+                          [this, key_id](const size_t done, const size_t total) {
+                              std::lock_guard<std::mutex> lock(mtx_);
+                              jobs_[key_id].progress =
+                                  total > 0 ? static_cast<uint32_t>(done * 100 / total) : 0;
+                          });
+
+                STDSC_LOG_INFO("Finish setting up DB. [keyID:%d]", key_id);
+            }
+            catch (const std::exception& e)
+            {
+                STDSC_LOG_WARN("Failed to set up DB. [keyID:%d] (%s)", key_id, e.what());
+                status = sses_share::kDBStatusFailed;
+            }
+            catch (...)
+            {
+                STDSC_LOG_WARN("Failed to set up DB. [keyID:%d] (unknown error)", key_id);
+                status = sses_share::kDBStatusFailed;
+            }
+
+            std::lock_guard<std::mutex> lock(mtx_);
+            jobs_[key_id] = Job{status, status == sses_share::kDBStatusReady ? 100u : 0u};
+        }
+    }
+
+    void stop(DBBuilderParam& args)
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        args.force_finish = true;
+        cond_.notify_all();
+    }
+
+    void request(const int32_t key_id)
+    {
+        if (db_.is_enable(key_id)) {
+            return;
+        }
+
+        std::lock_guard<std::mutex> lock(mtx_);
+        auto it = jobs_.find(key_id);
+        if (it != jobs_.end() &&
+            (it->second.status == sses_share::kDBStatusPending ||
+             it->second.status == sses_share::kDBStatusBuilding)) {
+            return;
+        }
+        jobs_[key_id] = Job{sses_share::kDBStatusPending, 0};
+        pending_.push_back(key_id);
+        cond_.notify_all();
+        STDSC_LOG_INFO("Requested DB setup. [keyID:%d, pending:%lu]", key_id, pending_.size());
+    }
+
+    sses_share::DBStatus_t status(const int32_t key_id, uint32_t& progress)
+    {
+        bool was_ready = false;
+        {
+            std::lock_guard<std::mutex> lock(mtx_);
+            auto it = jobs_.find(key_id);
+            if (it != jobs_.end() &&
+                it->second.status != sses_share::kDBStatusReady) {
+                progress = it->second.progress;
+                return it->second.status;
+            }
+            was_ready = it != jobs_.end();
+        }
+
+        // keys set up before the server started have no job, and ready
+        // keys may have been evicted since
+        if (db_.is_enable(key_id)) {
+            progress = 100;
+            return sses_share::kDBStatusReady;
+        }
+
+        // a key the DB knows was set up once, so it was evicted or its
+        // plaintext layer is built again. it is set up again.
+        const auto key_ids = db_.key_ids();
+        if (!was_ready &&
+            std::find(key_ids.begin(), key_ids.end(), key_id) == key_ids.end()) {
+            progress = 0;
+            return sses_share::kDBStatusNil;
+        }
+
+        request(key_id);
+        std::lock_guard<std::mutex> lock(mtx_);
+        auto it = jobs_.find(key_id);
+        if (it == jobs_.end()) {
+            // set up meanwhile
+            progress = 100;
+            return sses_share::kDBStatusReady;
+        }
+        progress = it->second.progress;
+        return it->second.status;
+    }
+
+    std::shared_ptr<stdsc::ThreadException> te_;
+    DBBuilderParam param_;
+    DBAppender appender_;
+
+private:
+    struct Job
+    {
+        sses_share::DBStatus_t status;
+        uint32_t progress;
+    };
+
+    DB& db_;
+    sses_share::FHEKeyContainer& key_container_;
+    std::string db_src_filepath_;
+    std::deque<int32_t> pending_;
+    std::unordered_map<int32_t, Job> jobs_;
+    mutable std::mutex mtx_;
+    std::condition_variable cond_;
+};
+
+DBBuilder::DBBuilder(DB& db,
+                     sses_share::FHEKeyContainer& key_container,
+                     const std::string& db_src_filepath)
+    : pimpl_(new Impl(db, key_container, db_src_filepath))
+{
+}
+
+DBBuilder::~DBBuilder(void)
+{
+    stop();
+    super::join();
+}
+
+void DBBuilder::start()
+{
+    pimpl_->param_.force_finish = false;
+    super::start(pimpl_->param_, pimpl_->te_);
+    pimpl_->appender_.start();
+}
+
+void DBBuilder::stop()
+{
+    pimpl_->stop(pimpl_->param_);
+    pimpl_->appender_.stop();
+}
+
+void DBBuilder::request(const int32_t key_id)
+{
+    pimpl_->request(key_id);
+}
+
+sses_share::DBStatus_t DBBuilder::status(const int32_t key_id, uint32_t& progress)
+{
+    return pimpl_->status(key_id, progress);
+}
+
+std::future<DBAppendResult> DBBuilder::append(const std::string& delta_csv)
+{
+    return pimpl_->appender_.append(delta_csv);
+}
+
+void DBBuilder::exec(DBBuilderParam& args,
+                     std::shared_ptr<stdsc::ThreadException> te) const
+{
+    pimpl_->exec(args, te);
+}
+
+} /* namespace sses_server */
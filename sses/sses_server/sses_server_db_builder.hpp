@@ -0,0 +1,120 @@
+/*
+ * Copyright 2020 Yamana Laboratory, Waseda University
+ * Supported by JST CREST Grant Number JPMJCR1503, Japan.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE‐2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SSES_SERVER_DB_BUILDER_HPP
+#define SSES_SERVER_DB_BUILDER_HPP
+
+#include <cstdbool>
+#include <cstdint>
+#include <future>
+#include <memory>
+#include <string>
+
+#include <stdsc/stdsc_thread.hpp>
+#include <sses_share/sses_srv2cliparam.hpp>
+
+namespace sses_share
+{
+class FHEKeyContainer;
+}
+
+namespace sses_server
+{
+
+class DB;
+class DBBuilderParam;
+struct DBAppendResult;
+
+/**
+ * @brief Sets up the DB of keys in the background, one key at a time.
+ * Requests for a key that is already pending or being set up are coalesced.
+ * Appends of records are run on a DBAppender thread of their own, so they
+ * do not wait for the masks of a key to be encrypted.
+ */
+class DBBuilder : public stdsc::Thread<DBBuilderParam>
+{
+    using super = stdsc::Thread<DBBuilderParam>;
+
+public:
+    /**
+     * Constructor
+     * @param[in] db DB
+     * @param[in] key_container FHE key container
+     * @param[in] db_src_filepath DB source filepath
+     */
+    DBBuilder(DB& db,
+              sses_share::FHEKeyContainer& key_container,
+              const std::string& db_src_filepath);
+    virtual ~DBBuilder(void);
+
+    /**
+     * Start thread
+     */
+    void start();
+
+    /**
+     * Stop thread
+     */
+    void stop();
+
+    /**
+     * Request setup of key
+     * @param[in] key_id key ID
+     * @note Nothing is done if the DB of the key is ready.
+     */
+    void request(const int32_t key_id);
+
+    /**
+     * Get DB status of key
+     * @param[in] key_id key ID
+     * @param[out] progress percent done of encryption
+     * @return DB status
+     * @note The setup is requested again for a key that was ready but has
+     * been evicted since.
+     */
+    sses_share::DBStatus_t status(const int32_t key_id, uint32_t& progress);
+
+    /**
+     * Request append of records to the DB of all set-up keys
+     * @param[in] delta_csv CSV text of records to append
+     * @return future of numbers of appended and skipped records. It throws
+     * the error of the append, or FailureException if the thread is stopped.
+     * @note The records are not encrypted for a key being set up until the
+     * setup is finished.
+     */
+    std::future<DBAppendResult> append(const std::string& delta_csv);
+
+private:
+    virtual void exec(
+      DBBuilderParam& args,
+      std::shared_ptr<stdsc::ThreadException> te) const override;
+
+    struct Impl;
+    std::shared_ptr<Impl> pimpl_;
+};
+
+/**
+ * @brief This class is used to hold the parameters for DBBuilder.
+ */
+struct DBBuilderParam
+{
+    bool force_finish = false;
+};
+
+} /* namespace sses_server */
+
+#endif /* SSES_SERVER_DB_BUILDER_HPP */
@@ -0,0 +1,232 @@
+/*
+ * Copyright 2020 Yamana Laboratory, Waseda University
+ * Supported by JST CREST Grant Number JPMJCR1503, Japan.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE‐2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SSES_SERVER_EXTERNAL_SORTER_HPP
+#define SSES_SERVER_EXTERNAL_SORTER_HPP
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <queue>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include <stdsc/stdsc_exception.hpp>
+
+namespace sses_server
+{
+
+/**
+ * @brief Sorts more elements than fit in memory.
+ * Elements are buffered in blocks, each block is sorted and written to a
+ * run file, and the runs are merged when the elements are read back. The
+ * order of equal elements is kept.
+ */
+template <class T, class Compare = std::less<T>>
+class ExternalSorter
+{
+    static_assert(std::is_trivially_copyable<T>::value,
+                  "element must be trivially copyable");
+
+public:
+    /**
+     * constructor
+     * @param[in] work_dir directory for run files
+     * @param[in] name prefix of run files
+     * @param[in] block_size max number of elements held in memory
+     * @param[in] max_fanin max number of runs merged at once
+     * @param[in] comp comparator
+     */
+    ExternalSorter(const std::string& work_dir,
+                   const std::string& name,
+                   const size_t block_size,
+                   const size_t max_fanin,
+                   Compare comp = Compare())
+        : work_dir_(work_dir),
+          name_(name),
+          block_size_(std::max<size_t>(block_size, 1)),
+          max_fanin_(std::max<size_t>(max_fanin, 2)),
+          comp_(comp),
+          num_runs_(0),
+          size_(0)
+    {
+        block_.reserve(block_size_);
+    }
+
+    ~ExternalSorter(void)
+    {
+        for (const auto& run : runs_) {
+            std::remove(run.c_str());
+        }
+    }
+
+    ExternalSorter(const ExternalSorter&) = delete;
+    ExternalSorter& operator=(const ExternalSorter&) = delete;
+
+    /**
+     * Push element
+     * @param[in] val element
+     */
+    void push(const T& val)
+    {
+        block_.push_back(val);
+        ++size_;
+        if (block_.size() >= block_size_) {
+            flush();
+        }
+    }
+
+    /**
+     * Number of pushed elements
+     */
+    size_t size(void) const
+    {
+        return size_;
+    }
+
+    /**
+     * Read all elements in sorted order
+     * @param[in] func function called for each element
+     */
+    void for_each(std::function<void(const T&)> func)
+    {
+        if (runs_.empty())
+        {
+            std::stable_sort(block_.begin(), block_.end(), comp_);
+            for (const auto& v : block_) {
+                func(v);
+            }
+            return;
+        }
+
+        flush();
+        while (runs_.size() > max_fanin_)
+        {
+            // merge neighbouring runs so that the runs stay in push order
+            std::vector<std::string> merged;
+            for (size_t i = 0; i < runs_.size(); i += max_fanin_)
+            {
+                auto last = std::min(i + max_fanin_, runs_.size());
+                std::vector<std::string> inputs(runs_.begin() + i, runs_.begin() + last);
+                if (inputs.size() == 1) {
+                    merged.push_back(inputs[0]);
+                    continue;
+                }
+
+                auto output = next_run_filepath();
+                std::ofstream ofs(output, std::ios::binary);
+                merge(inputs, [&ofs](const T& v) {
+                    ofs.write(reinterpret_cast<const char*>(&v), sizeof(T));
+                });
+                ofs.close();
+                STDSC_THROW_FILE_IF_CHECK(!ofs.fail(), "failed to write. (" + output + ")");
+
+                for (const auto& run : inputs) {
+                    std::remove(run.c_str());
+                }
+                merged.push_back(output);
+            }
+            runs_.swap(merged);
+        }
+        merge(runs_, func);
+    }
+
+private:
+    std::string next_run_filepath(void)
+    {
+        return work_dir_ + "/" + name_ + "." + std::to_string(num_runs_++) + ".run";
+    }
+
+    void flush(void)
+    {
+        if (block_.empty()) {
+            return;
+        }
+
+        std::stable_sort(block_.begin(), block_.end(), comp_);
+
+        auto filepath = next_run_filepath();
+        std::ofstream ofs(filepath, std::ios::binary);
+        ofs.write(reinterpret_cast<const char*>(block_.data()), sizeof(T) * block_.size());
+        ofs.close();
+        STDSC_THROW_FILE_IF_CHECK(!ofs.fail(), "failed to write. (" + filepath + ")");
+
+        runs_.push_back(filepath);
+        block_.clear();
+    }
+
+    void merge(const std::vector<std::string>& inputs,
+               std::function<void(const T&)> func)
+    {
+        struct Head
+        {
+            T val;
+            size_t run;
+        };
+        // earlier runs hold earlier elements, so ties go to the lower run
+        auto greater = [this](const Head& a, const Head& b) {
+            if (comp_(b.val, a.val)) {
+                return true;
+            }
+            if (comp_(a.val, b.val)) {
+                return false;
+            }
+            return a.run > b.run;
+        };
+        std::priority_queue<Head, std::vector<Head>, decltype(greater)> heads(greater);
+
+        std::vector<std::unique_ptr<std::ifstream>> ifss;
+        for (size_t i = 0; i < inputs.size(); ++i)
+        {
+            ifss.emplace_back(new std::ifstream(inputs[i], std::ios::binary));
+            STDSC_THROW_FILE_IF_CHECK(ifss.back()->is_open(),
+                                      "failed to open. (" + inputs[i] + ")");
+            Head h;
+            h.run = i;
+            if (ifss[i]->read(reinterpret_cast<char*>(&h.val), sizeof(T))) {
+                heads.push(h);
+            }
+        }
+
+        while (!heads.empty())
+        {
+            Head h = heads.top();
+            heads.pop();
+            func(h.val);
+            if (ifss[h.run]->read(reinterpret_cast<char*>(&h.val), sizeof(T))) {
+                heads.push(h);
+            }
+        }
+    }
+
+    std::string work_dir_;
+    std::string name_;
+    size_t block_size_;
+    size_t max_fanin_;
+    Compare comp_;
+    size_t num_runs_;
+    size_t size_;
+    std::vector<T> block_;
+    std::vector<std::string> runs_;
+};
+
+} /* namespace sses_server */
+
+#endif /* SSES_SERVER_EXTERNAL_SORTER_HPP */
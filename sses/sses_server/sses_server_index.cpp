@@ -0,0 +1,242 @@
+/*
+ * Copyright 2020 Yamana Laboratory, Waseda University
+ * Supported by JST CREST Grant Number JPMJCR1503, Japan.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE‐2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+#include <boost/algorithm/string.hpp>
+
+#include <stdsc/stdsc_exception.hpp>
+
+#include <sses_server/sses_server_index.hpp>
+
+namespace sses_server
+{
+
+static std::vector<int> merge_or(const std::map<int, std::vector<int>>& index,
+                                 const std::vector<int>& id)
+{
+    int len = id.size();
+
+    if (len == 0)
+    {
+        std::vector<int> ret;
+        return ret;
+    }
+
+    if (len == 1)
+    {
+        if (index.find(id[0]) == index.end())
+        {
+            std::vector<int> ret;
+            return ret;
+        }
+        return index.at(id[0]);
+    }
+
+    const std::vector<int> id_l = std::vector<int>(id.begin(), id.begin() + len / 2);
+    const std::vector<int> id_r = std::vector<int>(id.begin() + len / 2, id.end());
+
+    const std::vector<int> res_l = merge_or(index, id_l);
+    const std::vector<int> res_r = merge_or(index, id_r);
+
+    int len_l = res_l.size(), p_l = 0;
+    int len_r = res_r.size(), p_r = 0;
+
+    std::vector<int> ret;
+    while (p_l != len_l && p_r != len_r)
+    {
+        if (res_l[p_l] < res_r[p_r]) {
+            ret.push_back(res_l[p_l++]);
+        } else {
+            if (res_l[p_l] == res_r[p_r]) {
+                ++p_l;
+            }
+            ret.push_back(res_r[p_r++]);
+        }
+    }
+    while (p_l != len_l) {
+        ret.push_back(res_l[p_l++]);
+    }
+    while (p_r != len_r) {
+        ret.push_back(res_r[p_r++]);
+    }
+
+    return ret;
+}
+
+InvertedIndex::InvertedIndex(const std::string& filepath)
+{
+    load(filepath);
+}
+
+void InvertedIndex::load(const std::string& filepath)
+{
+    std::ifstream ifs(filepath, std::ios::binary);
+    if (!ifs.is_open())
+    {
+        std::ostringstream oss;
+        oss << "failed to open. (" << filepath << ")";
+        STDSC_THROW_FILE(oss.str());
+    }
+
+    index_.clear();
+
+    std::string line;
+    std::vector<std::string> info;
+    int num;
+    ifs >> num;
+    for (int i = 0; i < num; ++i)
+    {
+        ifs >> line;
+        boost::algorithm::split(info, line, boost::is_any_of(":"));
+        int id = std::stoi(info[0]);
+        int numindex = std::stoi(info[1]);
+        std::vector<int> postings;
+        postings.reserve(numindex);
+        while (numindex > 0)
+        {
+            int temprec;
+            ifs >> temprec;
+            postings.push_back(temprec);
+            numindex--;
+        }
+        index_.insert(std::make_pair(id, postings));
+    }
+}
+
+void InvertedIndex::save(const std::string& filepath) const
+{
+    std::ofstream ofs(filepath, std::ios::binary);
+    if (!ofs.is_open())
+    {
+        std::ostringstream oss;
+        oss << "failed to open. (" << filepath << ")";
+        STDSC_THROW_FILE(oss.str());
+    }
+
+    ofs << index_.size() << std::endl;
+    for (const auto& pair : index_)
+    {
+        ofs << pair.first << ":" << pair.second.size() << std::endl;
+        for (const auto& record_id : pair.second)
+        {
+            ofs << record_id << std::endl;
+        }
+    }
+
+    ofs.close();
+    STDSC_THROW_FILE_IF_CHECK(!ofs.fail(), "failed to write. (" + filepath + ")");
+}
+
+void InvertedIndex::add(const int id, const int record_id)
+{
+    auto& postings = index_[id];
+    if (!postings.empty() && postings.back() >= record_id)
+    {
+        postings.insert(std::lower_bound(postings.begin(), postings.end(), record_id),
+                        record_id);
+        postings.erase(std::unique(postings.begin(), postings.end()), postings.end());
+    }
+    else
+    {
+        postings.push_back(record_id);
+    }
+}
+
+void InvertedIndex::merge(const InvertedIndex& other)
+{
+    for (const auto& pair : other.index_)
+    {
+        auto& dst = index_[pair.first];
+        const auto& src = pair.second;
+
+        std::vector<int> merged;
+        merged.reserve(dst.size() + src.size());
+        std::set_union(dst.begin(), dst.end(), src.begin(), src.end(),
+                       std::back_inserter(merged));
+        dst.swap(merged);
+    }
+}
+
+const std::vector<int>& InvertedIndex::postings(const int id) const
+{
+    static const std::vector<int> empty;
+    auto it = index_.find(id);
+    return (it == index_.end()) ? empty : it->second;
+}
+
+std::vector<int> InvertedIndex::merge_or(const std::vector<int>& ids) const
+{
+    return sses_server::merge_or(index_, ids);
+}
+
+size_t InvertedIndex::size() const
+{
+    return index_.size();
+}
+
+std::vector<int> filter_records(const InvertedIndex& med_index,
+                                const InvertedIndex& side_index,
+                                const std::vector<int>& med_ids,
+                                const std::vector<int>& side_ids)
+{
+    // First use OR to merge between medIndex[medID] -> res1
+    const std::vector<int> medres = med_index.merge_or(med_ids);
+
+    // Then use OR to merge between sideIndex[sideID] -> res2
+    const std::vector<int> sideres = side_index.merge_or(side_ids);
+
+    // Then use AND to merge res1 and res2 -> ret
+
+    std::vector<int> ret;
+
+    int lenmed = medres.size(), pmed = 0;
+    int lenside = sideres.size(), pside = 0;
+
+    while (pmed != lenmed && pside != lenside)
+    {
+        if (medres[pmed] < sideres[pside]) {
+            ++pmed;
+        } else if (medres[pmed] > sideres[pside]) {
+            ++pside;
+        } else {
+            ret.push_back(medres[pmed++]);
+            ++pside;
+        }
+    }
+
+    return ret;
+}
+
+uint64_t estimate_cost(const InvertedIndex& med_index,
+                       const InvertedIndex& side_index,
+                       const std::vector<int>& med_ids,
+                       const std::vector<int>& side_ids)
+{
+    uint64_t nmed = 0, nside = 0;
+    for (const auto& id : med_ids) {
+        nmed += med_index.postings(id).size();
+    }
+    for (const auto& id : side_ids) {
+        nside += side_index.postings(id).size();
+    }
+    return std::min(nmed, nside);
+}
+
+} /* namespace sses_server */
@@ -0,0 +1,122 @@
+/*
+ * Copyright 2020 Yamana Laboratory, Waseda University
+ * Supported by JST CREST Grant Number JPMJCR1503, Japan.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE‐2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SSES_SERVER_INDEX_HPP
+#define SSES_SERVER_INDEX_HPP
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace sses_server
+{
+
+/**
+ * @brief This class is used to hold the inverted index (med.inv / side.inv).
+ * The index maps medicine or symptom ID to the sorted list of record IDs.
+ */
+class InvertedIndex
+{
+public:
+    InvertedIndex() = default;
+    /**
+     * Constructor
+     * @param[in] filepath index filepath
+     */
+    explicit InvertedIndex(const std::string& filepath);
+    virtual ~InvertedIndex() = default;
+
+    /**
+     * Load from file
+     * @param[in] filepath index filepath
+     */
+    void load(const std::string& filepath);
+
+    /**
+     * Save to file
+     * @param[in] filepath index filepath
+     */
+    void save(const std::string& filepath) const;
+
+    /**
+     * Add record to postings of ID
+     * @param[in] id medicine or symptom ID
+     * @param[in] record_id record ID
+     */
+    void add(const int id, const int record_id);
+
+    /**
+     * Merge other index into this index
+     * @param[in] other index
+     */
+    void merge(const InvertedIndex& other);
+
+    /**
+     * Get postings of ID
+     * @param[in] id medicine or symptom ID
+     * @return record IDs (empty if the ID is not registered)
+     */
+    const std::vector<int>& postings(const int id) const;
+
+    /**
+     * Merge postings of IDs with OR
+     * @param[in] ids medicine or symptom IDs
+     * @return sorted record IDs
+     */
+    std::vector<int> merge_or(const std::vector<int>& ids) const;
+
+    /**
+     * Number of IDs
+     * @return number of IDs
+     */
+    size_t size() const;
+
+private:
+    std::map<int, std::vector<int>> index_;
+};
+
+/**
+ * Filter records by medicines and side effects
+ * @param[in] med_index medicine index
+ * @param[in] side_index side effect index
+ * @param[in] med_ids medicine IDs
+ * @param[in] side_ids side effect IDs
+ * @return sorted record IDs having any of med_ids and any of side_ids
+ */
+std::vector<int> filter_records(const InvertedIndex& med_index,
+                                const InvertedIndex& side_index,
+                                const std::vector<int>& med_ids,
+                                const std::vector<int>& side_ids);
+
+/**
+ * Estimate cost of query
+ * @param[in] med_index medicine index
+ * @param[in] side_index side effect index
+ * @param[in] med_ids medicine IDs
+ * @param[in] side_ids side effect IDs
+ * @return upper bound of the number of records filtered by the query
+ * @note Computed from the posting-list sizes without merging.
+ */
+uint64_t estimate_cost(const InvertedIndex& med_index,
+                       const InvertedIndex& side_index,
+                       const std::vector<int>& med_ids,
+                       const std::vector<int>& side_ids);
+
+} /* namespace sses_server */
+
+#endif /* SSES_SERVER_INDEX_HPP */
@@ -0,0 +1,121 @@
+/*
+ * Copyright 2020 Yamana Laboratory, Waseda University
+ * Supported by JST CREST Grant Number JPMJCR1503, Japan.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE‐2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <condition_variable>
+#include <mutex>
+
+#include <stdsc/stdsc_exception.hpp>
+#include <stdsc/stdsc_log.hpp>
+
+#include <sses_server/sses_server_index_compactor.hpp>
+
+namespace sses_server
+{
+
+struct IndexCompactor::Impl
+{
+    explicit Impl(std::function<void()> compact)
+        : compact_(compact)
+    {
+        te_ = stdsc::ThreadException::create();
+    }
+
+    void exec(IndexCompactorParam& args, std::shared_ptr<stdsc::ThreadException> te)
+    {
+        while (true)
+        {
+            {
+                std::unique_lock<std::mutex> lock(mtx_);
+                cond_.wait(lock, [&] { return args.force_finish || pending_; });
+                if (args.force_finish)
+                {
+                    break;
+                }
+                pending_ = false;
+            }
+
+            try
+            {
+                STDSC_LOG_INFO("Start merging index segments.");
+                compact_();
+                STDSC_LOG_INFO("Finish merging index segments.");
+            }
+            catch (const stdsc::AbstractException& e)
+            {
+                STDSC_LOG_WARN("Failed to merge index segments. (%s)", e.what());
+            }
+        }
+    }
+
+    void stop(IndexCompactorParam& args)
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        args.force_finish = true;
+        cond_.notify_all();
+    }
+
+    void request()
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        pending_ = true;
+        cond_.notify_all();
+    }
+
+    std::shared_ptr<stdsc::ThreadException> te_;
+    IndexCompactorParam param_;
+
+private:
+    std::function<void()> compact_;
+    bool pending_ = false;
+    std::mutex mtx_;
+    std::condition_variable cond_;
+};
+
+IndexCompactor::IndexCompactor(std::function<void()> compact)
+    : pimpl_(new Impl(compact))
+{
+}
+
+IndexCompactor::~IndexCompactor(void)
+{
+    stop();
+    super::join();
+}
+
+void IndexCompactor::start()
+{
+    pimpl_->param_.force_finish = false;
+    super::start(pimpl_->param_, pimpl_->te_);
+}
+
+void IndexCompactor::stop()
+{
+    pimpl_->stop(pimpl_->param_);
+}
+
+void IndexCompactor::request()
+{
+    pimpl_->request();
+}
+
+void IndexCompactor::exec(IndexCompactorParam& args,
+                          std::shared_ptr<stdsc::ThreadException> te) const
+{
+    pimpl_->exec(args, te);
+}
+
+} /* namespace sses_server */
@@ -0,0 +1,83 @@
+/*
+ * Copyright 2020 Yamana Laboratory, Waseda University
+ * Supported by JST CREST Grant Number JPMJCR1503, Japan.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE‐2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SSES_SERVER_INDEX_COMPACTOR_HPP
+#define SSES_SERVER_INDEX_COMPACTOR_HPP
+
+#include <cstdbool>
+#include <cstdint>
+#include <functional>
+#include <memory>
+
+#include <stdsc/stdsc_thread.hpp>
+
+namespace sses_server
+{
+
+class IndexCompactorParam;
+
+/**
+ * @brief Merges the appended index segments in the background.
+ * Compaction requests made while merging are coalesced.
+ */
+class IndexCompactor : public stdsc::Thread<IndexCompactorParam>
+{
+    using super = stdsc::Thread<IndexCompactorParam>;
+
+public:
+    /**
+     * Constructor
+     * @param[in] compact function to merge the segments
+     */
+    explicit IndexCompactor(std::function<void()> compact);
+    virtual ~IndexCompactor(void);
+
+    /**
+     * Start thread
+     */
+    void start();
+
+    /**
+     * Stop thread
+     */
+    void stop();
+
+    /**
+     * Request compaction
+     */
+    void request();
+
+private:
+    virtual void exec(
+      IndexCompactorParam& args,
+      std::shared_ptr<stdsc::ThreadException> te) const override;
+
+    struct Impl;
+    std::shared_ptr<Impl> pimpl_;
+};
+
+/**
+ * @brief This class is used to hold the parameters for IndexCompactor.
+ */
+struct IndexCompactorParam
+{
+    bool force_finish = false;
+};
+
+} /* namespace sses_server */
+
+#endif /* SSES_SERVER_INDEX_COMPACTOR_HPP */
@@ -19,6 +19,7 @@
 #include <sses_share/sses_utility.hpp>
 #include <sses_share/sses_fhekey_container.hpp>
 #include <sses_server/sses_server_query.hpp>
+#include <sses_server/sses_server_db.hpp>
 
 namespace sses_server
 {
@@ -32,7 +33,8 @@ Query::Query(const int32_t key_id,
       param_(param),
       encmask_(encmask),
       key_container_p_(key_container_p),
-      db_p_(db_p)
+      db_p_(db_p),
+      db_lease_(db_p->acquire(key_id))
 {
     key_container_p->setup(key_id);
     auto context = key_container_p->get_context(key_id);
@@ -40,11 +42,107 @@ Query::Query(const int32_t key_id,
     key_container_p->get(key_id, sses_share::KeyKind_t::kKindPubKey, pubkey);
 }
 
+double Query::waiting_time() const
+{
+    auto now = std::chrono::system_clock::now();
+    return std::chrono::duration_cast<std::chrono::seconds>(now - enqueued_time_)
+      .count();
+}
+
+QueryQueue::QueryQueue(const double aging_cost_per_sec)
+    : aging_cost_per_sec_(aging_cost_per_sec)
+{
+}
+
 int32_t QueryQueue::push(const Query& data)
 {
     auto id = sses_share::utility::gen_uuid();
-    super::push(id, data);
+    Query query(data);
+    query.enqueued_time_ = std::chrono::system_clock::now();
+    super::push(id, query);
     return id;
 }
 
+bool QueryQueue::pop(int32_t& key, Query& val)
+{
+    std::lock_guard<std::mutex> lock(running_mtx_);
+
+    // shortest job first, aged by the waiting time to avoid starvation
+    const auto aging = aging_cost_per_sec_;
+    auto score = [aging](const Query& q) {
+        return static_cast<double>(q.cost_) - aging * q.waiting_time();
+    };
+    if (!super::pop_min(key, val, score))
+    {
+        return false;
+    }
+    running_[key] = std::make_shared<std::atomic<bool>>(false);
+    return true;
+}
+
+bool QueryQueue::pop(const int32_t& key, Query& val)
+{
+    std::lock_guard<std::mutex> lock(running_mtx_);
+    if (!super::pop(key, val))
+    {
+        return false;
+    }
+    running_[key] = std::make_shared<std::atomic<bool>>(false);
+    return true;
+}
+
+bool QueryQueue::cancel(const int32_t key)
+{
+    std::lock_guard<std::mutex> lock(running_mtx_);
+
+    Query tmp;
+    if (super::pop(key, tmp))
+    {
+        return true;
+    }
+
+    if (running_.count(key))
+    {
+        *running_.at(key) = true;
+        return true;
+    }
+
+    return false;
+}
+
+std::shared_ptr<std::atomic<bool>> QueryQueue::cancel_flag(const int32_t key) const
+{
+    std::lock_guard<std::mutex> lock(running_mtx_);
+    if (!running_.count(key))
+    {
+        return nullptr;
+    }
+    return running_.at(key);
+}
+
+bool QueryQueue::is_running(const int32_t key) const
+{
+    std::lock_guard<std::mutex> lock(running_mtx_);
+    return running_.count(key) > 0;
+}
+
+size_t QueryQueue::num_running() const
+{
+    std::lock_guard<std::mutex> lock(running_mtx_);
+    return running_.size();
+}
+
+bool QueryQueue::finish(const int32_t key)
+{
+    std::lock_guard<std::mutex> lock(running_mtx_);
+
+    bool canceled = false;
+    if (running_.count(key))
+    {
+        canceled = *running_.at(key);
+        running_.erase(key);
+    }
+    return canceled;
+}
+
 } /* namespace sses_server */
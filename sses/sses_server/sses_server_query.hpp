@@ -18,9 +18,13 @@
 #ifndef SSES_SERVER_QUERY_HPP
 #define SSES_SERVER_QUERY_HPP
 
+#include <atomic>
+#include <chrono>
 #include <cstdint>
-#include <vector>
+#include <map>
 #include <memory>
+#include <mutex>
+#include <vector>
 
 #include "FHE.h"
 #include "EncryptedArray.h"
@@ -29,6 +33,7 @@
 
 #include <sses_share/sses_cli2srvparam.hpp>
 #include <sses_share/sses_concurrent_mapqueue.hpp>
+#include <sses_share/sses_define.hpp>
 #include <sses_share/sses_fhectxt_buffer.hpp>
 
 namespace sses_share
@@ -71,14 +76,26 @@ struct Query
           param_(q.param_),
           encmask_(q.encmask_),
           key_container_p_(q.key_container_p_),
-          db_p_(q.db_p_)
+          db_p_(q.db_p_),
+          db_lease_(q.db_lease_),
+          cost_(q.cost_),
+          enqueued_time_(q.enqueued_time_)
     {}
 
+    /**
+     * Elapsed time since the query was enqueued
+     * @return elapsed time (sec)
+     */
+    double waiting_time() const;
+
     int32_t key_id_;
     sses_share::ComputationParam param_;
     sses_share::FHECtxtBuffer encmask_;
     sses_share::FHEKeyContainer* key_container_p_;
     sses_server::DB* db_p_;
+    std::shared_ptr<void> db_lease_; ///< keeps the DB of the key from eviction
+    uint64_t cost_ = 0; ///< estimated number of records to calculate
+    std::chrono::system_clock::time_point enqueued_time_;
 };
 
 /**
@@ -89,7 +106,13 @@ struct QueryQueue
 {
     using super = sses_share::ConcurrentMapQueue<int32_t, sses_server::Query>;
 
-    QueryQueue() = default;
+    /**
+     * Constructor
+     * @param[in] aging_cost_per_sec cost credited per second of waiting
+     */
+    explicit QueryQueue(const double aging_cost_per_sec =
+                          static_cast<double>(SSES_DEFAULT_MAX_QUERY_COST)
+                          / SSES_DEFAULT_QUERY_AGING_SEC);
     virtual ~QueryQueue() = default;
 
     /**
@@ -97,6 +120,62 @@ struct QueryQueue
      * @param[in] data query
      */
     virtual int32_t push(const Query& data);
+
+    /**
+     * Pop query with the lowest cost and mark it as running
+     * @param[out] key query ID
+     * @param[out] val query
+     * @return Susscess or Fail
+     */
+    virtual bool pop(int32_t& key, Query& val) override;
+
+    /**
+     * Pop query of the key and mark it as running
+     * @param[in] key query ID
+     * @param[out] val query
+     * @return Susscess or Fail
+     */
+    virtual bool pop(const int32_t& key, Query& val) override;
+
+    /**
+     * Cancel query
+     * @param[in] key query ID
+     * @return true if the query was queued or running
+     * @note A queued query is removed, a running query is flagged to stop.
+     */
+    bool cancel(const int32_t key);
+
+    /**
+     * Get the cancellation flag of running query
+     * @param[in] key query ID
+     * @return cancellation flag (nullptr if the query is not running)
+     */
+    std::shared_ptr<std::atomic<bool>> cancel_flag(const int32_t key) const;
+
+    /**
+     * Whether the query is running or not
+     * @param[in] key query ID
+     * @return whether the query is running or not
+     */
+    bool is_running(const int32_t key) const;
+
+    /**
+     * Number of running queries
+     * @return number of running queries
+     */
+    size_t num_running() const;
+
+    /**
+     * Unmark running query
+     * @param[in] key query ID
+     * @return whether the query was canceled while running
+     */
+    bool finish(const int32_t key);
+
+private:
+    const double aging_cost_per_sec_;
+    std::map<int32_t, std::shared_ptr<std::atomic<bool>>> running_;
+    mutable std::mutex running_mtx_;
 };
 
 } /* namespace sses_server */
@@ -0,0 +1,129 @@
+/*
+ * Copyright 2020 Yamana Laboratory, Waseda University
+ * Supported by JST CREST Grant Number JPMJCR1503, Japan.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE‐2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+#include <iterator>
+
+#include <stdsc/stdsc_log.hpp>
+
+#include <sses_server/sses_server_index.hpp>
+#include <sses_server/sses_server_query_batcher.hpp>
+
+namespace sses_server
+{
+
+static size_t count_intersection(const std::vector<int>& a, const std::vector<int>& b)
+{
+    size_t n = 0;
+    auto ia = a.begin();
+    auto ib = b.begin();
+    while (ia != a.end() && ib != b.end())
+    {
+        if (*ia < *ib) {
+            ++ia;
+        } else if (*ib < *ia) {
+            ++ib;
+        } else {
+            ++n; ++ia; ++ib;
+        }
+    }
+    return n;
+}
+
+struct QueryBatcher::Impl
+{
+    Impl(QueryQueue& que, const uint32_t max_batch_size, const double min_overlap)
+        : que_(que),
+          max_batch_size_(max_batch_size),
+          min_overlap_(min_overlap)
+    {}
+
+    void collect(const InvertedIndex& med_index,
+                 const InvertedIndex& side_index,
+                 std::vector<BatchedQuery>& batch)
+    {
+        if (batch.empty() || max_batch_size_ <= 1)
+        {
+            return;
+        }
+
+        const auto key_id = batch[0].query.key_id_;
+        std::vector<int> records = batch[0].filtered;
+
+        for (const auto& query_id : que_.keys())
+        {
+            if (batch.size() >= max_batch_size_)
+            {
+                break;
+            }
+
+            Query query;
+            if (!que_.get(query_id, query) || query.key_id_ != key_id)
+            {
+                continue;
+            }
+
+            std::vector<int> med_ids, side_ids;
+            query.param_.get_med_ids(med_ids);
+            query.param_.get_side_ids(side_ids);
+            auto filtered = filter_records(med_index, side_index, med_ids, side_ids);
+
+            const auto n_and = count_intersection(records, filtered);
+            const auto n_or = records.size() + filtered.size() - n_and;
+            if (n_or == 0 || static_cast<double>(n_and) / n_or < min_overlap_)
+            {
+                continue;
+            }
+
+            // the query may have been popped by another thread meanwhile
+            if (!que_.pop(query_id, query))
+            {
+                continue;
+            }
+
+            std::vector<int> merged;
+            merged.reserve(n_or);
+            std::set_union(records.begin(), records.end(),
+                           filtered.begin(), filtered.end(),
+                           std::back_inserter(merged));
+            records.swap(merged);
+
+            batch.push_back(BatchedQuery{query_id, query, filtered});
+        }
+    }
+
+private:
+    QueryQueue& que_;
+    const uint32_t max_batch_size_;
+    const double min_overlap_;
+};
+
+QueryBatcher::QueryBatcher(QueryQueue& que,
+                           const uint32_t max_batch_size,
+                           const double min_overlap)
+    : pimpl_(new Impl(que, max_batch_size, min_overlap))
+{
+}
+
+void QueryBatcher::collect(const InvertedIndex& med_index,
+                           const InvertedIndex& side_index,
+                           std::vector<BatchedQuery>& batch) const
+{
+    pimpl_->collect(med_index, side_index, batch);
+}
+
+} /* namespace sses_server */
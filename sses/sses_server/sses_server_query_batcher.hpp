@@ -0,0 +1,81 @@
+/*
+ * Copyright 2020 Yamana Laboratory, Waseda University
+ * Supported by JST CREST Grant Number JPMJCR1503, Japan.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE‐2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SSES_SERVER_QUERY_BATCHER_HPP
+#define SSES_SERVER_QUERY_BATCHER_HPP
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include <sses_share/sses_define.hpp>
+#include <sses_server/sses_server_query.hpp>
+
+namespace sses_server
+{
+
+class InvertedIndex;
+
+/**
+ * @brief This class is used to hold the query evaluated in a batch.
+ */
+struct BatchedQuery
+{
+    int32_t query_id;
+    Query query;
+    std::vector<int> filtered; ///< sorted record IDs matched by the query
+};
+
+/**
+ * @brief Groups the queued queries which can share the encrypted records.
+ * Queries with the same key ID whose filtered records overlap enough are
+ * popped together, so that the records are loaded and packed only once.
+ */
+class QueryBatcher
+{
+public:
+    /**
+     * Constructor
+     * @param[in] que            query queue
+     * @param[in] max_batch_size max number of queries in a batch
+     * @param[in] min_overlap    min Jaccard index between the filtered records
+     *                           of the query and those of the batch
+     */
+    QueryBatcher(QueryQueue& que,
+                 const uint32_t max_batch_size = SSES_DEFAULT_MAX_BATCH_SIZE,
+                 const double min_overlap = SSES_DEFAULT_BATCH_MIN_OVERLAP);
+    virtual ~QueryBatcher() = default;
+
+    /**
+     * Collect queries to be evaluated with the leading query
+     * @param[in] med_index medicine index of the key
+     * @param[in] side_index side effect index of the key
+     * @param[in,out] batch batch whose first element is the leading query
+     * @note Collected queries are popped from the queue as running.
+     */
+    void collect(const InvertedIndex& med_index,
+                 const InvertedIndex& side_index,
+                 std::vector<BatchedQuery>& batch) const;
+
+private:
+    struct Impl;
+    std::shared_ptr<Impl> pimpl_;
+};
+
+} /* namespace sses_server */
+
+#endif /* SSES_SERVER_QUERY_BATCHER_HPP */
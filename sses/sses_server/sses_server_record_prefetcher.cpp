@@ -0,0 +1,229 @@
+/*
+ * Copyright 2020 Yamana Laboratory, Waseda University
+ * Supported by JST CREST Grant Number JPMJCR1503, Japan.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE‐2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <fcntl.h>    // for open
+#include <sys/stat.h> // for fstat
+#include <unistd.h>   // for pread
+#include <cerrno>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <sstream>
+
+#include "FHE.h"
+#include "EncryptedArray.h"
+
+#include <stdsc/stdsc_buffer.hpp>
+#include <stdsc/stdsc_exception.hpp>
+#include <stdsc/stdsc_log.hpp>
+
+#include <sses_server/sses_server_record_prefetcher.hpp>
+#include <sses_server/sses_server_stats.hpp>
+
+namespace sses_server
+{
+
+struct RecordPrefetcher::Impl
+{
+    Impl(const std::string& encdata_dir,
+         const FHEPubKey& pubkey,
+         const std::vector<std::vector<int>>& chunks,
+         const size_t first,
+         const size_t last,
+         const uint32_t window)
+        : encdata_dir_(encdata_dir),
+          pubkey_(pubkey),
+          chunks_(chunks),
+          first_(first),
+          last_(last),
+          window_(window > 0 ? window : 1),
+          num_popped_(0)
+    {
+        te_ = stdsc::ThreadException::create();
+    }
+
+    void exec(RecordPrefetcherParam& args,
+              std::shared_ptr<stdsc::ThreadException> te)
+    {
+        try
+        {
+            for (size_t i = first_; i < last_; ++i)
+            {
+                {
+                    std::unique_lock<std::mutex> lock(mtx_);
+                    cond_.wait(lock, [&] {
+                        return args.force_finish || loaded_.size() < window_;
+                    });
+                    if (args.force_finish)
+                    {
+                        break;
+                    }
+                }
+
+                StageTimer load_timer(kStageRecordLoad);
+                std::vector<Ctxt> ctxts;
+                ctxts.reserve(chunks_[i].size());
+                for (const auto record_id : chunks_[i])
+                {
+                    load_record(record_id, ctxts);
+                }
+                load_timer.stop();
+
+                {
+                    std::lock_guard<std::mutex> lock(mtx_);
+                    loaded_.push_back(std::move(ctxts));
+                }
+                cond_.notify_all();
+            }
+        }
+        catch (...)
+        {
+            std::lock_guard<std::mutex> lock(mtx_);
+            te->set_current_exception();
+            cond_.notify_all();
+        }
+    }
+
+    void stop(RecordPrefetcherParam& args)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mtx_);
+            args.force_finish = true;
+        }
+        cond_.notify_all();
+    }
+
+    void pop(std::vector<Ctxt>& ctxts)
+    {
+        std::unique_lock<std::mutex> lock(mtx_);
+        STDSC_THROW_FAILURE_IF_CHECK(num_popped_ < last_ - first_,
+                                     "Err: no more chunks to pop.");
+
+        cond_.wait(lock, [&] {
+            return !loaded_.empty() || te_->has_exception();
+        });
+        if (loaded_.empty())
+        {
+            te_->rethrow_if_has_exception();
+        }
+
+        ctxts = std::move(loaded_.front());
+        loaded_.pop_front();
+        ++num_popped_;
+        cond_.notify_all();
+    }
+
+    void load_record(const int record_id, std::vector<Ctxt>& ctxts) const
+    {
+        auto filepath = encdata_dir_ + "/" + std::to_string(record_id) + ".bin";
+        ctxts.emplace_back(pubkey_);
+
+        int fd = ::open(filepath.c_str(), O_RDONLY);
+        if (fd < 0)
+        {
+            STDSC_LOG_WARN("Failed to open encrypted record. (%s)",
+                           filepath.c_str());
+            return;
+        }
+
+        struct stat st;
+        size_t size = (::fstat(fd, &st) == 0) ? st.st_size : 0;
+
+        stdsc::BufferStream bs(size);
+        auto* p = static_cast<char*>(bs.data());
+        size_t offset = 0;
+        while (offset < size)
+        {
+            auto ret = ::pread(fd, p + offset, size - offset, offset);
+            if (ret < 0 && errno == EINTR)
+            {
+                continue;
+            }
+            if (ret <= 0)
+            {
+                break;
+            }
+            offset += ret;
+        }
+        ::close(fd);
+
+        if (offset != size || size == 0)
+        {
+            STDSC_LOG_WARN("Failed to read encrypted record. (%s)",
+                           filepath.c_str());
+            return;
+        }
+
+        std::iostream is(&bs);
+        is >> ctxts.back();
+    }
+
+    std::shared_ptr<stdsc::ThreadException> te_;
+    RecordPrefetcherParam param_;
+
+private:
+    const std::string encdata_dir_;
+    const FHEPubKey& pubkey_;
+    const std::vector<std::vector<int>>& chunks_;
+    const size_t first_;
+    const size_t last_;
+    const size_t window_;
+    size_t num_popped_;
+    std::deque<std::vector<Ctxt>> loaded_;
+    std::mutex mtx_;
+    std::condition_variable cond_;
+};
+
+RecordPrefetcher::RecordPrefetcher(const std::string& encdata_dir,
+                                   const FHEPubKey& pubkey,
+                                   const std::vector<std::vector<int>>& chunks,
+                                   const size_t first,
+                                   const size_t last,
+                                   const uint32_t window)
+    : pimpl_(new Impl(encdata_dir, pubkey, chunks, first, last, window))
+{
+}
+
+RecordPrefetcher::~RecordPrefetcher(void)
+{
+    stop();
+    super::join();
+}
+
+void RecordPrefetcher::start()
+{
+    pimpl_->param_.force_finish = false;
+    super::start(pimpl_->param_, pimpl_->te_);
+}
+
+void RecordPrefetcher::stop()
+{
+    pimpl_->stop(pimpl_->param_);
+}
+
+void RecordPrefetcher::pop(std::vector<Ctxt>& ctxts)
+{
+    pimpl_->pop(ctxts);
+}
+
+void RecordPrefetcher::exec(RecordPrefetcherParam& args,
+                            std::shared_ptr<stdsc::ThreadException> te) const
+{
+    pimpl_->exec(args, te);
+}
+
+} /* namespace sses_server */
@@ -0,0 +1,101 @@
+/*
+ * Copyright 2020 Yamana Laboratory, Waseda University
+ * Supported by JST CREST Grant Number JPMJCR1503, Japan.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE‐2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SSES_SERVER_RECORD_PREFETCHER_HPP
+#define SSES_SERVER_RECORD_PREFETCHER_HPP
+
+#include <cstdbool>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <stdsc/stdsc_thread.hpp>
+
+#include <sses_share/sses_define.hpp>
+
+class Ctxt;
+class FHEPubKey;
+
+namespace sses_server
+{
+
+class RecordPrefetcherParam;
+
+/**
+ * @brief Loads the encrypted records of chunks ahead of the calculation.
+ * The records of chunks [first, last) are read and deserialized in the
+ * background, in order, keeping at most 'window' chunks ahead of the consumer.
+ */
+class RecordPrefetcher : public stdsc::Thread<RecordPrefetcherParam>
+{
+    using super = stdsc::Thread<RecordPrefetcherParam>;
+
+public:
+    /**
+     * Constructor
+     * @param[in] encdata_dir EncData directory
+     * @param[in] pubkey      FHE public key
+     * @param[in] chunks      record IDs per chunk
+     * @param[in] first       first chunk index to load
+     * @param[in] last        last chunk index to load (exclusive)
+     * @param[in] window      max number of chunks loaded ahead
+     */
+    RecordPrefetcher(const std::string& encdata_dir,
+                     const FHEPubKey& pubkey,
+                     const std::vector<std::vector<int>>& chunks,
+                     const size_t first,
+                     const size_t last,
+                     const uint32_t window = SSES_DEFAULT_PREFETCH_WINDOW);
+    virtual ~RecordPrefetcher(void);
+
+    /**
+     * Start thread
+     */
+    void start();
+
+    /**
+     * Stop thread
+     */
+    void stop();
+
+    /**
+     * Pop the encrypted records of the next chunk
+     * @param[out] ctxts encrypted records
+     * @note Blocks until the records of the next chunk have been loaded.
+     */
+    void pop(std::vector<Ctxt>& ctxts);
+
+private:
+    virtual void exec(
+      RecordPrefetcherParam& args,
+      std::shared_ptr<stdsc::ThreadException> te) const override;
+
+    struct Impl;
+    std::shared_ptr<Impl> pimpl_;
+};
+
+/**
+ * @brief This class is used to hold the parameters for RecordPrefetcher.
+ */
+struct RecordPrefetcherParam
+{
+    bool force_finish = false;
+};
+
+} /* namespace sses_server */
+
+#endif /* SSES_SERVER_RECORD_PREFETCHER_HPP */
@@ -50,4 +50,29 @@ double Result::elapsed_time() const
       .count();
 }
 
+// ResultQueue
+size_t ResultQueue::held_bytes() const
+{
+    size_t sz = 0;
+    for_each([&](const int32_t, const Result& result) {
+        if (!result.chunk_res_.is_spilled())
+        {
+            sz += result.chunk_res_.size();
+        }
+    });
+    return sz;
+}
+
+size_t ResultQueue::spilled_bytes() const
+{
+    size_t sz = 0;
+    for_each([&](const int32_t, const Result& result) {
+        if (result.chunk_res_.is_spilled())
+        {
+            sz += result.chunk_res_.size();
+        }
+    });
+    return sz;
+}
+
 } /* namespace sses_server */
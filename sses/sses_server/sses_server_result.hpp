@@ -71,6 +71,18 @@ struct ResultQueue : public sses_share::ConcurrentMapQueue<int32_t, Result>
 
     ResultQueue() = default;
     virtual ~ResultQueue() = default;
+
+    /**
+     * Bytes of results held in memory
+     * @return size (bytes)
+     */
+    size_t held_bytes() const;
+
+    /**
+     * Bytes of results spilled to files
+     * @return size (bytes)
+     */
+    size_t spilled_bytes() const;
 };
 
 } /* namespace sses_server */
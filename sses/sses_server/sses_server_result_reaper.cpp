@@ -0,0 +1,301 @@
+/*
+ * Copyright 2020 Yamana Laboratory, Waseda University
+ * Supported by JST CREST Grant Number JPMJCR1503, Japan.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE‐2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <dirent.h>
+#include <signal.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <condition_variable>
+#include <mutex>
+#include <vector>
+
+#include <stdsc/stdsc_exception.hpp>
+#include <stdsc/stdsc_log.hpp>
+
+#include <sses_server/sses_server_result.hpp>
+#include <sses_server/sses_server_result_reaper.hpp>
+
+namespace sses_server
+{
+
+struct ResultReaper::Impl
+{
+    Impl(ResultQueue& rque,
+         const uint32_t result_lifetime_sec,
+         const size_t max_result_bytes,
+         const std::string& spill_dir,
+         const uint32_t interval_sec)
+        : rque_(rque),
+          result_lifetime_sec_(result_lifetime_sec),
+          max_result_bytes_(max_result_bytes),
+          spill_dir_(spill_dir),
+          interval_sec_(interval_sec)
+    {
+        te_ = stdsc::ThreadException::create();
+        if (!spill_dir_.empty())
+        {
+            prepare_spill_dir();
+        }
+    }
+
+    void exec(ResultReaperParam& args, std::shared_ptr<stdsc::ThreadException> te)
+    {
+        STDSC_LOG_INFO("Launched result reaper. (lifetime:%u sec, budget:%lu bytes, spill:%s)",
+                       result_lifetime_sec_, max_result_bytes_, spill_dir_.c_str());
+
+        while (true)
+        {
+            {
+                std::unique_lock<std::mutex> lock(mtx_);
+                cond_.wait_for(lock, std::chrono::seconds(interval_sec_),
+                               [&] { return args.force_finish; });
+                if (args.force_finish)
+                {
+                    break;
+                }
+            }
+
+            try
+            {
+                sweep();
+            }
+            catch (const stdsc::AbstractException& e)
+            {
+                STDSC_LOG_WARN("Failed to sweep results. (%s)", e.what());
+            }
+        }
+    }
+
+    void stop(ResultReaperParam& args)
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        args.force_finish = true;
+        cond_.notify_all();
+    }
+
+    void sweep()
+    {
+        std::lock_guard<std::mutex> lock(sweep_mtx_);
+
+        struct Entry
+        {
+            int32_t query_id;
+            std::chrono::system_clock::time_point created_time;
+            size_t size;
+        };
+
+        // look at the queue under its lock, results are copied only when
+        // spilled
+        size_t held_bytes = 0;
+        std::vector<int32_t> expired;
+        std::vector<Entry> in_memory;
+        rque_.for_each([&](const int32_t query_id, const Result& result) {
+            if (result.elapsed_time() >= result_lifetime_sec_)
+            {
+                expired.push_back(query_id);
+            }
+            else if (!result.chunk_res_.is_spilled())
+            {
+                held_bytes += result.chunk_res_.size();
+                in_memory.push_back(
+                  {query_id, result.created_time_, result.chunk_res_.size()});
+            }
+        });
+
+        for (const auto& query_id : expired)
+        {
+            Result tmp;
+            if (rque_.pop(query_id, tmp))
+            {
+                STDSC_LOG_INFO(
+                  "Deleted the results of query%d because it has expired.",
+                  query_id);
+            }
+        }
+
+        if (held_bytes <= max_result_bytes_)
+        {
+            return;
+        }
+
+        // the oldest results are the least likely to be fetched soon
+        std::sort(in_memory.begin(), in_memory.end(),
+                  [](const Entry& a, const Entry& b) {
+                      return a.created_time < b.created_time;
+                  });
+
+        for (const auto& e : in_memory)
+        {
+            if (held_bytes <= max_result_bytes_)
+            {
+                break;
+            }
+
+            Result r;
+            if (!rque_.get(e.query_id, r))
+            {
+                held_bytes -= e.size; // fetched meanwhile
+                continue;
+            }
+
+            if (!spill_dir_.empty() && spill(r))
+            {
+                STDSC_LOG_INFO("Spilled the results of query%d. (%lu bytes)",
+                               r.query_id_, e.size);
+            }
+            else
+            {
+                Result tmp;
+                rque_.pop(r.query_id_, tmp);
+                STDSC_LOG_INFO(
+                  "Deleted the results of query%d because of the memory budget.",
+                  r.query_id_);
+            }
+            held_bytes -= e.size;
+        }
+    }
+
+    std::shared_ptr<stdsc::ThreadException> te_;
+    ResultReaperParam param_;
+
+private:
+    /* files are named result_<pid>_<queryID>.spill, so that servers may
+     * share the directory */
+    bool spill(Result& result)
+    {
+        const auto filepath = spill_dir_ + "/result_" +
+                              std::to_string(::getpid()) + "_" +
+                              std::to_string(result.query_id_) + ".spill";
+        try
+        {
+            result.chunk_res_.spill(filepath);
+        }
+        catch (const stdsc::AbstractException& e)
+        {
+            STDSC_LOG_WARN("Failed to spill the results of query%d. (%s)",
+                           result.query_id_, e.what());
+            return false;
+        }
+        return true;
+    }
+
+    /* create the spill directory, and remove the files left by servers
+     * which are not running any more, e.g. after a crash */
+    void prepare_spill_dir()
+    {
+        if (0 != ::mkdir(spill_dir_.c_str(), S_IRWXU) && EEXIST != errno)
+        {
+            STDSC_LOG_WARN("Failed to create spill directory. (%s)",
+                           spill_dir_.c_str());
+            return;
+        }
+
+        DIR* dir = ::opendir(spill_dir_.c_str());
+        if (!dir)
+        {
+            return;
+        }
+
+        const std::string prefix = "result_";
+        const std::string suffix = ".spill";
+        size_t num_removed = 0;
+        while (auto* ent = ::readdir(dir))
+        {
+            const std::string name = ent->d_name;
+            if (name.size() <= prefix.size() + suffix.size()
+                || 0 != name.compare(0, prefix.size(), prefix)
+                || 0 != name.compare(name.size() - suffix.size(),
+                                     suffix.size(), suffix))
+            {
+                continue;
+            }
+
+            // result_<queryID>.spill of older servers has no owner
+            auto pid = static_cast<pid_t>(std::atol(name.c_str() + prefix.size()));
+            auto sep = name.find('_', prefix.size());
+            bool alive = std::string::npos != sep && 0 < pid && ::getpid() != pid
+                         && (0 == ::kill(pid, 0) || EPERM == errno);
+            if (!alive && 0 == std::remove((spill_dir_ + "/" + name).c_str()))
+            {
+                ++num_removed;
+            }
+        }
+        ::closedir(dir);
+
+        if (0 < num_removed)
+        {
+            STDSC_LOG_INFO("Removed %lu stale spill files in %s.", num_removed,
+                           spill_dir_.c_str());
+        }
+    }
+
+    ResultQueue& rque_;
+    const uint32_t result_lifetime_sec_;
+    const size_t max_result_bytes_;
+    const std::string spill_dir_;
+    const uint32_t interval_sec_;
+    std::mutex mtx_;
+    std::condition_variable cond_;
+    std::mutex sweep_mtx_;
+};
+
+ResultReaper::ResultReaper(ResultQueue& rque,
+                           const uint32_t result_lifetime_sec,
+                           const size_t max_result_bytes,
+                           const std::string& spill_dir,
+                           const uint32_t interval_sec)
+    : pimpl_(new Impl(rque, result_lifetime_sec, max_result_bytes, spill_dir,
+                      interval_sec))
+{
+}
+
+ResultReaper::~ResultReaper(void)
+{
+    stop();
+    super::join();
+}
+
+void ResultReaper::start()
+{
+    pimpl_->param_.force_finish = false;
+    super::start(pimpl_->param_, pimpl_->te_);
+}
+
+void ResultReaper::stop()
+{
+    pimpl_->stop(pimpl_->param_);
+}
+
+void ResultReaper::sweep()
+{
+    pimpl_->sweep();
+}
+
+void ResultReaper::exec(ResultReaperParam& args,
+                        std::shared_ptr<stdsc::ThreadException> te) const
+{
+    pimpl_->exec(args, te);
+}
+
+} /* namespace sses_server */
@@ -0,0 +1,94 @@
+/*
+ * Copyright 2020 Yamana Laboratory, Waseda University
+ * Supported by JST CREST Grant Number JPMJCR1503, Japan.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE‐2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SSES_SERVER_RESULT_REAPER_HPP
+#define SSES_SERVER_RESULT_REAPER_HPP
+
+#include <cstdbool>
+#include <memory>
+#include <string>
+
+#include <stdsc/stdsc_thread.hpp>
+
+#include <sses_share/sses_define.hpp>
+
+namespace sses_server
+{
+
+class ResultReaperParam;
+class ResultQueue;
+
+/**
+ * @brief Evicts the results held in ResultQueue periodically.
+ * Results older than the lifetime are deleted, and when the results in memory
+ * exceed the byte budget the oldest ones are spilled to files.
+ */
+class ResultReaper : public stdsc::Thread<ResultReaperParam>
+{
+    using super = stdsc::Thread<ResultReaperParam>;
+
+public:
+    /**
+     * Constructor
+     * @param[in] rque                result queue
+     * @param[in] result_lifetime_sec lifetime to hold (sec)
+     * @param[in] max_result_bytes    max bytes of results held in memory
+     * @param[in] spill_dir           directory to spill results (empty: delete instead)
+     * @param[in] interval_sec        sweep interval (sec)
+     */
+    ResultReaper(ResultQueue& rque,
+                 const uint32_t result_lifetime_sec,
+                 const size_t max_result_bytes,
+                 const std::string& spill_dir,
+                 const uint32_t interval_sec = SSES_DEFAULT_RESULT_REAPER_INTERVAL_SEC);
+    virtual ~ResultReaper(void);
+
+    /**
+     * Start thread
+     */
+    void start();
+
+    /**
+     * Stop thread
+     */
+    void stop();
+
+    /**
+     * Sweep results once
+     */
+    void sweep();
+
+private:
+    virtual void exec(
+      ResultReaperParam& args,
+      std::shared_ptr<stdsc::ThreadException> te) const override;
+
+    struct Impl;
+    std::shared_ptr<Impl> pimpl_;
+};
+
+/**
+ * @brief This class is used to hold the parameters for ResultReaper.
+ */
+struct ResultReaperParam
+{
+    bool force_finish = false;
+};
+
+} /* namespace sses_server */
+
+#endif /* SSES_SERVER_RESULT_REAPER_HPP */
@@ -0,0 +1,205 @@
+/*
+ * Copyright 2020 Yamana Laboratory, Waseda University
+ * Supported by JST CREST Grant Number JPMJCR1503, Japan.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE‐2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <atomic>
+#include <sstream>
+
+#include <stdsc/stdsc_compression.hpp>
+
+#include <sses_server/sses_server_stats.hpp>
+
+namespace sses_server
+{
+
+// upper bounds of the histogram buckets (usec), the last bucket is +Inf
+static const uint64_t kBucketBounds[] = {
+    100, 250, 500,
+    1000, 2500, 5000,
+    10000, 25000, 50000,
+    100000, 250000, 500000,
+    1000000, 2500000, 5000000,
+    10000000, 30000000, 60000000,
+};
+static const size_t kNumBuckets = sizeof(kBucketBounds) / sizeof(kBucketBounds[0]) + 1;
+
+static const char* kStageNames[kNumStages] = {
+    "index_load",
+    "filter",
+    "record_load",
+    "chunk_assemble",
+    "range_product",
+    "serialize",
+    "send",
+};
+
+/**
+ * @brief Latency histogram updated with atomic counters only.
+ */
+struct Histogram
+{
+    std::atomic<uint64_t> buckets[kNumBuckets];
+    std::atomic<uint64_t> sum_usec;
+
+    Histogram(void) : sum_usec(0)
+    {
+        for (auto& b : buckets) {
+            b = 0;
+        }
+    }
+
+    void observe(const uint64_t usec)
+    {
+        size_t i = 0;
+        while (i < kNumBuckets - 1 && kBucketBounds[i] < usec) {
+            ++i;
+        }
+        buckets[i].fetch_add(1, std::memory_order_relaxed);
+        sum_usec.fetch_add(usec, std::memory_order_relaxed);
+    }
+};
+
+static Histogram histograms[kNumStages];
+static std::atomic<uint64_t> counters[kNumCounters];
+
+void stats_observe(const Stage_t stage, const uint64_t usec)
+{
+    if (stage < kNumStages) {
+        histograms[stage].observe(usec);
+    }
+}
+
+void stats_count(const Counter_t counter, const uint64_t n)
+{
+    if (counter < kNumCounters) {
+        counters[counter].fetch_add(n, std::memory_order_relaxed);
+    }
+}
+
+static void write_header(std::ostream& os, const std::string& name,
+                         const std::string& type, const std::string& help)
+{
+    os << "# HELP " << name << " " << help << "\n"
+       << "# TYPE " << name << " " << type << "\n";
+}
+
+static void write_counter(std::ostream& os, const std::string& name,
+                          const std::string& help, const uint64_t value)
+{
+    write_header(os, name, "counter", help);
+    os << name << " " << value << "\n";
+}
+
+std::string stats_to_prometheus(const std::vector<Gauge>& gauges)
+{
+    std::ostringstream oss;
+    oss.precision(12);
+
+    const std::string hname = "sses_stage_duration_seconds";
+    write_header(oss, hname, "histogram",
+                 "Time spent in each stage of query processing.");
+    for (size_t s = 0; s < kNumStages; ++s)
+    {
+        const auto& h = histograms[s];
+        const std::string label = std::string("stage=\"") + kStageNames[s] + "\"";
+
+        // the count is taken from the buckets read, so that the output is
+        // consistent while other threads are updating them
+        uint64_t cumulative = 0;
+        for (size_t i = 0; i < kNumBuckets; ++i)
+        {
+            cumulative += h.buckets[i].load(std::memory_order_relaxed);
+            oss << hname << "_bucket{" << label << ",le=\"";
+            if (i < kNumBuckets - 1) {
+                oss << kBucketBounds[i] / 1e6;
+            } else {
+                oss << "+Inf";
+            }
+            oss << "\"} " << cumulative << "\n";
+        }
+        oss << hname << "_sum{" << label << "} "
+            << h.sum_usec.load(std::memory_order_relaxed) / 1e6 << "\n";
+        oss << hname << "_count{" << label << "} " << cumulative << "\n";
+    }
+
+    write_counter(oss, "sses_queries_total", "Queries computed.",
+                  counters[kCounterQueries]);
+    write_counter(oss, "sses_chunks_total", "Chunks computed.",
+                  counters[kCounterChunks]);
+    write_counter(oss, "sses_sent_bytes_total", "Bytes of results sent to clients.",
+                  counters[kCounterBytesSent]);
+
+    const std::string cname = "sses_cache_lookups_total";
+    write_header(oss, cname, "counter", "Lookups of the index and aux store caches.");
+    oss << cname << "{cache=\"index\",result=\"hit\"} " << counters[kCounterIndexCacheHit] << "\n"
+        << cname << "{cache=\"index\",result=\"miss\"} " << counters[kCounterIndexCacheMiss] << "\n"
+        << cname << "{cache=\"aux\",result=\"hit\"} " << counters[kCounterAuxCacheHit] << "\n"
+        << cname << "{cache=\"aux\",result=\"miss\"} " << counters[kCounterAuxCacheMiss] << "\n";
+
+    const auto comp = stdsc::compression_stats();
+    write_counter(oss, "sses_compressed_payloads_total",
+                  "Payloads (frames of streams) sent compressed.", comp.num_compressed);
+    write_counter(oss, "sses_decompressed_payloads_total",
+                  "Payloads (frames of streams) received compressed.", comp.num_decompressed);
+    write_counter(oss, "sses_compression_raw_bytes_total",
+                  "Size of compressed payloads before compression.", comp.raw_bytes);
+    write_counter(oss, "sses_compression_wire_bytes_total",
+                  "Size of compressed payloads on the wire.", comp.wire_bytes);
+
+    const std::string zname = "sses_compression_cpu_seconds_total";
+    write_header(oss, zname, "counter", "CPU time spent to compress and decompress payloads.");
+    oss << zname << "{op=\"compress\"} " << comp.compress_usec / 1e6 << "\n"
+        << zname << "{op=\"decompress\"} " << comp.decompress_usec / 1e6 << "\n";
+
+    const std::string* prev = nullptr;
+    for (const auto& g : gauges)
+    {
+        if (!prev || *prev != g.name) {
+            write_header(oss, g.name, "gauge", g.help);
+        }
+        prev = &g.name;
+        oss << g.name;
+        if (!g.labels.empty()) {
+            oss << "{" << g.labels << "}";
+        }
+        oss << " " << g.value << "\n";
+    }
+
+    return oss.str();
+}
+
+StageTimer::StageTimer(const Stage_t stage)
+    : stage_(stage), start_(std::chrono::steady_clock::now()), is_stopped_(false)
+{
+}
+
+StageTimer::~StageTimer(void)
+{
+    stop();
+}
+
+void StageTimer::stop(void)
+{
+    if (!is_stopped_)
+    {
+        auto elapsed = std::chrono::steady_clock::now() - start_;
+        stats_observe(stage_,
+                      std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count());
+        is_stopped_ = true;
+    }
+}
+
+} /* namespace sses_server */
@@ -0,0 +1,115 @@
+/*
+ * Copyright 2020 Yamana Laboratory, Waseda University
+ * Supported by JST CREST Grant Number JPMJCR1503, Japan.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE‐2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SSES_SERVER_STATS_HPP
+#define SSES_SERVER_STATS_HPP
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace sses_server
+{
+
+/**
+ * @brief Enumeration for stages of query processing timed by the server.
+ */
+enum Stage_t : uint32_t
+{
+    kStageIndexLoad = 0,  ///< loading the inverted indexes
+    kStageFilter,         ///< filtering records by the indexes
+    kStageRecordLoad,     ///< reading the encrypted records of a chunk
+    kStageChunkAssemble,  ///< packing the records of a chunk into slots
+    kStageRangeProduct,   ///< range product and randomization of a chunk
+    kStageSerialize,      ///< serializing the results of a query
+    kStageSend,           ///< encoding and sending the results to the client
+    kNumStages,
+};
+
+/**
+ * @brief Enumeration for event counters of the server.
+ */
+enum Counter_t : uint32_t
+{
+    kCounterQueries = 0,     ///< queries computed
+    kCounterChunks,          ///< chunks computed
+    kCounterIndexCacheHit,   ///< inverted indexes found in the cache
+    kCounterIndexCacheMiss,  ///< inverted indexes loaded from files
+    kCounterAuxCacheHit,     ///< aux stores found in the cache
+    kCounterAuxCacheMiss,    ///< aux stores mapped from files
+    kCounterBytesSent,       ///< bytes of results sent to clients
+    kNumCounters,
+};
+
+/**
+ * @brief Value sampled when the statistics are dumped.
+ */
+struct Gauge
+{
+    std::string name;
+    std::string help;
+    double value;
+    std::string labels; ///< e.g. key_id="1" (gauges of the same name must be adjacent)
+};
+
+/**
+ * Record the time spent in a stage.
+ * @param[in] stage stage
+ * @param[in] usec  elapsed time (usec)
+ * @note This only increments atomic counters and may be called from any thread.
+ */
+void stats_observe(const Stage_t stage, const uint64_t usec);
+
+/**
+ * Increment a counter.
+ * @param[in] counter counter
+ * @param[in] n       increment
+ */
+void stats_count(const Counter_t counter, const uint64_t n = 1);
+
+/**
+ * Dump the statistics in the Prometheus text exposition format.
+ * @param[in] gauges values sampled by the caller (queue depths, etc.)
+ * @return text
+ */
+std::string stats_to_prometheus(const std::vector<Gauge>& gauges);
+
+/**
+ * @brief Records the time spent in a stage when it goes out of scope.
+ */
+class StageTimer
+{
+public:
+    explicit StageTimer(const Stage_t stage);
+    ~StageTimer(void);
+
+    /**
+     * Record the time spent so far.
+     * Nothing is recorded when the timer goes out of scope after this.
+     */
+    void stop(void);
+
+private:
+    Stage_t stage_;
+    std::chrono::steady_clock::time_point start_;
+    bool is_stopped_;
+};
+
+} /* namespace sses_server */
+
+#endif /* SSES_SERVER_STATS_HPP */
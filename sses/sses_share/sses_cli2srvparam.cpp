@@ -38,7 +38,7 @@ std::istream& operator>>(std::istream& is, C2SEnckeyParam& param)
 
 std::ostream& operator<<(std::ostream& os, const C2SQueryParam& param)
 {
-    os << param.comp_param << std::endl;
+    os << param.comp_param_stream_sz << std::endl;
     os << param.encdata_stream_sz << std::endl;
     os << param.key_id << std::endl;
     return os;
@@ -46,7 +46,7 @@ std::ostream& operator<<(std::ostream& os, const C2SQueryParam& param)
 
 std::istream& operator>>(std::istream& is, C2SQueryParam& param)
 {
-    is >> param.comp_param;
+    is >> param.comp_param_stream_sz;
     is >> param.encdata_stream_sz;
     is >> param.key_id;
     return is;
@@ -55,12 +55,14 @@ std::istream& operator>>(std::istream& is, C2SQueryParam& param)
 std::ostream& operator<<(std::ostream& os, const C2SChunkResreqParam& param)
 {
     os << param.query_id << std::endl;
+    os << param.wait << std::endl;
     return os;
 }
 
 std::istream& operator>>(std::istream& is, C2SChunkResreqParam& param)
 {
     is >> param.query_id;
+    is >> param.wait;
     return is;
 }
 
@@ -78,6 +80,54 @@ std::istream& operator>>(std::istream& is, C2SResreqParam& param)
     return is;
 }
 
+std::ostream& operator<<(std::ostream& os, const C2SCancelParam& param)
+{
+    os << param.query_id << std::endl;
+    return os;
+}
+
+std::istream& operator>>(std::istream& is, C2SCancelParam& param)
+{
+    is >> param.query_id;
+    return is;
+}
+
+std::ostream& operator<<(std::ostream& os, const C2SQueryStatusParam& param)
+{
+    os << param.query_id << std::endl;
+    return os;
+}
+
+std::istream& operator>>(std::istream& is, C2SQueryStatusParam& param)
+{
+    is >> param.query_id;
+    return is;
+}
+
+std::ostream& operator<<(std::ostream& os, const C2SDBStatusParam& param)
+{
+    os << param.key_id << std::endl;
+    return os;
+}
+
+std::istream& operator>>(std::istream& is, C2SDBStatusParam& param)
+{
+    is >> param.key_id;
+    return is;
+}
+
+std::ostream& operator<<(std::ostream& os, const C2SAppendParam& param)
+{
+    os << param.csv_stream_sz << std::endl;
+    return os;
+}
+
+std::istream& operator>>(std::istream& is, C2SAppendParam& param)
+{
+    is >> param.csv_stream_sz;
+    return is;
+}
+
 std::ostream& operator<<(std::ostream& os, const C2SSelectedInfo& param)
 {
     os << param.chunk_id << std::endl;
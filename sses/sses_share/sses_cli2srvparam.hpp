@@ -40,11 +40,11 @@ std::istream& operator>>(std::istream& is, C2SEnckeyParam& param);
 
 /**
  * @brief This class is used to hold the parameters of query from client to
- * server.
+ * server. The encoded ComputationParam and the encrypted mask follow.
  */
 struct C2SQueryParam
 {
-    ComputationParam comp_param;
+    size_t comp_param_stream_sz;
     size_t encdata_stream_sz;
     int32_t key_id;
 };
@@ -59,6 +59,7 @@ std::istream& operator>>(std::istream& is, C2SQueryParam& param);
 struct C2SChunkResreqParam
 {
     int32_t query_id;
+    int32_t wait = 1; ///< 0: answer kServerResultStatusPending if not computed yet
 };
 
 std::ostream& operator<<(std::ostream& os, const C2SChunkResreqParam& param);
@@ -77,6 +78,54 @@ struct C2SResreqParam
 std::ostream& operator<<(std::ostream& os, const C2SResreqParam& param);
 std::istream& operator>>(std::istream& is, C2SResreqParam& param);
 
+/**
+ * @brief This class is used to hold the parameters of cancel query from
+ * client to server.
+ */
+struct C2SCancelParam
+{
+    int32_t query_id;
+};
+
+std::ostream& operator<<(std::ostream& os, const C2SCancelParam& param);
+std::istream& operator>>(std::istream& is, C2SCancelParam& param);
+
+/**
+ * @brief This class is used to hold the parameters of query status request
+ * from client to server. One is sent for each query polled.
+ */
+struct C2SQueryStatusParam
+{
+    int32_t query_id;
+};
+
+std::ostream& operator<<(std::ostream& os, const C2SQueryStatusParam& param);
+std::istream& operator>>(std::istream& is, C2SQueryStatusParam& param);
+
+/**
+ * @brief This class is used to hold the parameters of DB status request from
+ * client to server.
+ */
+struct C2SDBStatusParam
+{
+    int32_t key_id;
+};
+
+std::ostream& operator<<(std::ostream& os, const C2SDBStatusParam& param);
+std::istream& operator>>(std::istream& is, C2SDBStatusParam& param);
+
+/**
+ * @brief This class is used to hold the parameters of appending records from
+ * client to server.
+ */
+struct C2SAppendParam
+{
+    size_t csv_stream_sz;
+};
+
+std::ostream& operator<<(std::ostream& os, const C2SAppendParam& param);
+std::istream& operator>>(std::istream& is, C2SAppendParam& param);
+
 /**
  * @brief This class is used to hold the selected indeces.
  */
@@ -15,58 +15,153 @@
  * limitations under the License.
  */
 
-#include <boost/algorithm/string.hpp>
+#include <algorithm>
+#include <sstream>
 
 #include <stdsc/stdsc_exception.hpp>
 #include <sses_share/sses_computation_param.hpp>
+#include <sses_share/sses_varint.hpp>
 
 namespace sses_share
 {
 
-void ComputationParam::get_med_ids(std::vector<int>& ids) const
+static std::string join_ids(const std::vector<int32_t>& ids)
 {
-    std::vector<std::string> elems;
+    std::ostringstream oss;
+    for (size_t i = 0; i < ids.size(); ++i) {
+        oss << (i ? ":" : "") << ids[i];
+    }
+    return oss.str();
+}
 
-    auto str = std::string(meds);
-    boost::algorithm::split(elems, str, boost::is_any_of(":"));
+std::string ComputationParam::to_string() const
+{
+    std::ostringstream oss;
+    oss << age << ", " << gender << ", "
+        << join_ids(med_ids) << ", " << join_ids(side_ids);
+    return oss.str();
+}
 
-    for (const auto& v : elems) {
-        ids.push_back(std::stoi(v));
-    }
+void ComputationParam::get_med_ids(std::vector<int>& ids) const
+{
+    ids.insert(ids.end(), med_ids.begin(), med_ids.end());
 }
 
 void ComputationParam::get_side_ids(std::vector<int>& ids) const
 {
-    std::vector<std::string> elems;
-
-    auto str = std::string(sides);
-    boost::algorithm::split(elems, str, boost::is_any_of(":"));
+    ids.insert(ids.end(), side_ids.begin(), side_ids.end());
+}
 
-    for (const auto& v : elems) {
-        ids.push_back(std::stoi(v));
+std::vector<int32_t> ComputationParam::parse_ids(const std::string& str)
+{
+    std::vector<int32_t> ids;
+    size_t begin = 0;
+    while (begin <= str.size())
+    {
+        auto end = str.find(':', begin);
+        if (end == std::string::npos) {
+            end = str.size();
+        }
+        if (end > begin) {
+            ids.push_back(std::stoi(str.substr(begin, end - begin)));
+        }
+        begin = end + 1;
     }
+    std::sort(ids.begin(), ids.end());
+    ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+    return ids;
 }
     
 std::ostream& operator<<(std::ostream& os, const ComputationParam& param)
 {
     os << param.age << std::endl;
-    os << std::string(param.gender) << std::endl;
-    os << std::string(param.meds) << std::endl;
-    os << std::string(param.sides) << std::endl;
+    os << param.gender << std::endl;
+    os << join_ids(param.med_ids) << std::endl;
+    os << join_ids(param.side_ids) << std::endl;
     return os;
 }
 
 std::istream& operator>>(std::istream& is, ComputationParam& param)
 {
     is >> param.age;
-    std::string gender, meds, sides;
-    is >> gender;
+    std::string meds, sides;
+    is >> param.gender;
     is >> meds;
     is >> sides;
-    gender.copy(param.gender, gender.size());
-    meds.copy(param.meds, meds.size());
-    sides.copy(param.sides, sides.size());
+    param.med_ids = ComputationParam::parse_ids(meds);
+    param.side_ids = ComputationParam::parse_ids(sides);
     return is;
 }
 
+template <class Func>
+static void for_each_varint(const ComputationParam& param, Func func)
+{
+    auto ids = [&func](const std::vector<int32_t>& v) {
+        func(v.size());
+        int64_t prev = 0;
+        for (const auto id : v) {
+            func(varint::zigzag(id - prev));
+            prev = id;
+        }
+    };
+
+    func(param.age);
+    func(param.gender.size());
+    ids(param.med_ids);
+    ids(param.side_ids);
+}
+
+size_t encoded_size(const ComputationParam& param)
+{
+    size_t sz = param.gender.size();
+    for_each_varint(param, [&sz](const uint64_t v) { sz += varint::size(v); });
+    return sz;
+}
+
+size_t encode(const ComputationParam& param, void* buf)
+{
+    auto head = static_cast<uint8_t*>(buf);
+    auto p = head;
+    size_t n = 0;
+    for_each_varint(param, [&](const uint64_t v) {
+        p = varint::put(p, v);
+        // gender string follows its length
+        if (++n == 2) {
+            std::copy(param.gender.begin(), param.gender.end(), p);
+            p += param.gender.size();
+        }
+    });
+    return p - head;
+}
+
+void decode(const void* buf, const size_t size, ComputationParam& param)
+{
+    auto p = static_cast<const uint8_t*>(buf);
+    const auto end = p + size;
+
+    auto ids = [&p, end](std::vector<int32_t>& v) {
+        uint64_t n, d;
+        p = varint::get(p, end, n);
+        // each ID takes at least one byte
+        STDSC_THROW_INVPARAM_IF_CHECK(n <= static_cast<uint64_t>(end - p), "truncated query.");
+        v.resize(n);
+        int64_t prev = 0;
+        for (auto& id : v) {
+            p = varint::get(p, end, d);
+            prev += varint::unzigzag(d);
+            id = static_cast<int32_t>(prev);
+        }
+    };
+
+    uint64_t v;
+    p = varint::get(p, end, v);
+    param.age = v;
+    p = varint::get(p, end, v);
+    STDSC_THROW_INVPARAM_IF_CHECK(v <= static_cast<uint64_t>(end - p), "truncated query.");
+    param.gender.assign(reinterpret_cast<const char*>(p), v);
+    p += v;
+    ids(param.med_ids);
+    ids(param.side_ids);
+}
+
 } /* namespace sses_share */
@@ -18,13 +18,11 @@
 #ifndef SSES_COMPUTATION_PARAM_HPP
 #define SSES_COMPUTATION_PARAM_HPP
 
-#include <sstream>
+#include <cstdint>
+#include <iostream>
 #include <string>
-#include <unordered_map>
 #include <vector>
 
-#include <sses_share/sses_define.hpp>
-
 namespace sses_share
 {
 
@@ -34,25 +32,52 @@ namespace sses_share
 struct ComputationParam
 {
     size_t age;
-    char gender[SSES_DEFAULT_SIZE_OF_STR_FOR_TRANSDATA];
-    char meds[SSES_DEFAULT_SIZE_OF_STR_FOR_TRANSDATA];
-    char sides[SSES_DEFAULT_SIZE_OF_STR_FOR_TRANSDATA];
-
-    std::string to_string() const
-    {
-        std::ostringstream oss;
-        oss << age << ", " << std::string(gender) << ", "
-            << std::string(meds) << ", " << std::string(sides);
-        return oss.str();
-    }
+    std::string gender;
+    std::vector<int32_t> med_ids;  ///< sorted query medicine IDs
+    std::vector<int32_t> side_ids; ///< sorted query side effect IDs
+
+    std::string to_string() const;
 
     void get_med_ids(std::vector<int>& ids) const;
     void get_side_ids(std::vector<int>& ids) const;
+
+    /**
+     * Parse colon-separated IDs (e.g. "1:5:3")
+     * @param[in] str IDs
+     * @return sorted unique IDs
+     */
+    static std::vector<int32_t> parse_ids(const std::string& str);
 };
 
 std::ostream& operator<<(std::ostream& os, const ComputationParam& param);
 std::istream& operator>>(std::istream& is, ComputationParam& param);
 
+/**
+ * Get size of binary encoding of ComputationParam
+ * @param[in] param param
+ * @return size in bytes
+ */
+size_t encoded_size(const ComputationParam& param);
+
+/**
+ * Encode ComputationParam to binary
+ * Varints of age, gender length, gender, the number of medicine IDs, the
+ * medicine IDs delta coded, the number of side effect IDs and the side
+ * effect IDs delta coded.
+ * @param[in] param param
+ * @param[out] buf output buffer (at least encoded_size(param) bytes)
+ * @return size in bytes
+ */
+size_t encode(const ComputationParam& param, void* buf);
+
+/**
+ * Decode ComputationParam from binary
+ * @param[in] buf input buffer
+ * @param[in] size size of input buffer
+ * @param[out] param param
+ */
+void decode(const void* buf, const size_t size, ComputationParam& param);
+
 } /* namespace sses_share */
 
 #endif /* SSES_COMPUTATION_PARAM_HPP */
@@ -19,8 +19,10 @@
 #define SSES_CONCURRENT_MAPQUEUE_HPP
 
 #include <cstdbool>
+#include <iterator>
 #include <map>
 #include <mutex>
+#include <vector>
 
 #include <stdsc/stdsc_exception.hpp>
 
@@ -88,6 +90,23 @@ public:
         return map_.count(key);
     }
 
+    /**
+     * Keys in the queue
+     * @return snapshot of keys
+     */
+    virtual std::vector<Tk> keys() const
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+
+        std::vector<Tk> ret;
+        ret.reserve(map_.size());
+        for (const auto& pair : map_)
+        {
+            ret.push_back(pair.first);
+        }
+        return ret;
+    }
+
     /**
      * Pop data
      * @param[out] key key
@@ -133,6 +152,57 @@ public:
         return true;
     }
 
+    /**
+     * Pop data with min score
+     * @param[out] key key
+     * @param[out] val value
+     * @param[in] score function to score the value
+     * @return Susscess or Fail
+     * @note The elements will be removed from the queue
+     */
+    template <class Score>
+    bool pop_min(Tk& key, Tv& val, Score score)
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+
+        if (0 == map_.size())
+        {
+            return false;
+        }
+
+        auto min = map_.begin();
+        auto min_score = score(min->second);
+        for (auto it = std::next(min); it != map_.end(); ++it)
+        {
+            auto s = score(it->second);
+            if (s < min_score)
+            {
+                min = it;
+                min_score = s;
+            }
+        }
+
+        key = min->first;
+        val = min->second;
+        map_.erase(min);
+        return true;
+    }
+
+    /**
+     * Visit each element under the lock, without copying the values
+     * @param[in] func function called with key and value
+     */
+    template <class Func>
+    void for_each(Func func) const
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+
+        for (const auto& pair : map_)
+        {
+            func(pair.first, pair.second);
+        }
+    }
+
     /**
      * Get data
      * @param[out] key key
@@ -154,7 +224,7 @@ public:
 
 private:
     std::map<Tk, Tv> map_;
-    std::mutex mtx_;
+    mutable std::mutex mtx_;
 };
 
 } /* namespace sses_share */
@@ -20,16 +20,39 @@
 
 #define SSES_TIMEOUT_SEC (60)
 #define SSES_RETRY_INTERVAL_USEC (2000000)
+#define SSES_DB_READY_TIMEOUT_SEC (3600)
+
+#define SSES_DEFAULT_MAX_CONNECTIONS 256
+#define SSES_DEFAULT_IDLE_TIMEOUT_SEC 3600
 
 #define SSES_DEFAULT_MAX_CONCURRENT_QUERIES 128
+#define SSES_DEFAULT_MAX_QUERY_COST 1000000
+#define SSES_DEFAULT_QUERY_AGING_SEC 60
 #define SSES_DEFAULT_MAX_RESULTS 128
 #define SSES_DEFAULT_MAX_RESULT_LIFETIME_SEC 50000
+#define SSES_DEFAULT_MAX_RESULT_BYTES (1024UL * 1024 * 1024)
+#define SSES_DEFAULT_RESULT_SPILL_DIR "result_spill"
+#define SSES_DEFAULT_RESULT_REAPER_INTERVAL_SEC 10
 
 #define SSES_DEFAULT_SERVER_DB_SRC_FILEAPATH "data.csv"
 #define SSES_DEFAULT_SERVER_DB_BASE_DIR "."
-
-#define SSES_DEFAULT_SIZE_OF_STR_FOR_TRANSDATA 2048
+#define SSES_DEFAULT_MAX_INDEX_SEGMENTS 4
+#define SSES_DEFAULT_MAX_DB_DISK_BYTES 0
+#define SSES_DEFAULT_USAGE_SAVE_INTERVAL_SEC 60
+#define SSES_DEFAULT_SETUP_CHECKPOINT_RECORDS 1000
+#define SSES_DEFAULT_INGEST_BLOCK_ROWS (1 << 20)
+#define SSES_DEFAULT_INGEST_MERGE_FANIN 64
+#define SSES_DEFAULT_CSV_BLOCK_SIZE (4 << 20)
 
 #define SSES_DEFAULT_NUM_THREADS 28
 
+#define SSES_DEFAULT_CHUNK_SIZE 100
+#define SSES_DEFAULT_PREFETCH_WINDOW 2
+
+#define SSES_DEFAULT_CLIENT_DECRYPT_THREADS 2
+#define SSES_DEFAULT_CLIENT_POLL_INTERVAL_USEC (100000)
+
+#define SSES_DEFAULT_MAX_BATCH_SIZE 8
+#define SSES_DEFAULT_BATCH_MIN_OVERLAP 0.5
+
 #endif /* SSES_DEFINE_HPP */
@@ -14,13 +14,20 @@
  * See the License for the specific language governing permissions and
  * limitations under the License.
  */
-#include <vector>
+#include <unistd.h>
+#include <cstdio>
+#include <fstream>
 #include <iostream>
+#include <mutex>
+#include <vector>
 
 #include "EncryptedArray.h"
 #include "FHE.h"
 
 #include <stdsc/stdsc_buffer.hpp>
+#include <stdsc/stdsc_socket.hpp>
+#include <stdsc/stdsc_exception.hpp>
+#include <stdsc/stdsc_log.hpp>
 
 #include <sses_share/sses_encdata.hpp>
 #include <sses_share/sses_fhectxt_buffer.hpp>
@@ -31,31 +38,65 @@ namespace sses_share
 struct FHECtxtBuffer::Impl
 {
     Impl()
+        : size_(0)
     {}
 
+    ~Impl()
+    {
+        if (!spill_filepath_.empty())
+        {
+            std::remove(spill_filepath_.c_str());
+        }
+    }
+
     void serialize(const FHEPubKey& pubkey, const std::vector<Ctxt>& ctxts)
     {
-        vec_.clear();
+        std::lock_guard<std::mutex> lock(mtx_);
+
+        buffer_.release();
+        if (!spill_filepath_.empty())
+        {
+            std::remove(spill_filepath_.c_str());
+            spill_filepath_.clear();
+        }
 
         EncData encdata(pubkey, ctxts);
-        
-        stdsc::BufferStream bs(encdata.stream_size());
+
+        // serialize straight into the pooled buffer
+        buffer_.resize(encdata.stream_size());
+        stdsc::BufferStream bs(buffer_.data(), buffer_.size());
         std::iostream ios(&bs);
         encdata.save(ios);
-
-        stdsc::Buffer& buffer = bs;
-        vec_.resize(buffer.size());
-        std::memcpy(vec_.data(), buffer.data(), buffer.size());
+        size_ = buffer_.size();
     }
 
     void deserialize(const FHEPubKey& pubkey, std::vector<Ctxt>& ctxts) const
     {
-        stdsc::BufferStream bs(vec_.size());
-        stdsc::Buffer& buffer = bs;
-        std::memcpy(bs.data(), vec_.data(), vec_.size());
+        std::lock_guard<std::mutex> lock(mtx_);
+
+        if (spill_filepath_.empty())
+        {
+            // read from the held buffer without copying
+            stdsc::BufferStream bs(buffer_.data(), buffer_.size());
+            std::iostream ios(&bs);
+            load(pubkey, ios, ctxts);
+            return;
+        }
+
+        stdsc::BufferStream bs(size_);
+        std::ifstream ifs(spill_filepath_, std::ios::binary);
+        ifs.read(static_cast<char*>(bs.data()), size_);
+        STDSC_THROW_FILE_IF_CHECK(
+            ifs && static_cast<size_t>(ifs.gcount()) == size_,
+            "Failed to read spilled ctxts. (" + spill_filepath_ + ")");
 
         std::iostream ios(&bs);
-        
+        load(pubkey, ios, ctxts);
+    }
+
+    static void load(const FHEPubKey& pubkey, std::iostream& ios,
+                     std::vector<Ctxt>& ctxts)
+    {
         EncData encdata(pubkey);
         encdata.load(ios);
 
@@ -64,7 +105,46 @@ struct FHECtxtBuffer::Impl
         }
     }
 
-    std::vector<uint8_t> vec_;
+    void spill(const std::string& filepath)
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+
+        if (!spill_filepath_.empty())
+        {
+            return;
+        }
+
+        std::ofstream ofs(filepath, std::ios::binary | std::ios::trunc);
+        ofs.write(static_cast<const char*>(buffer_.data()), buffer_.size());
+        ofs.close();
+        if (!ofs)
+        {
+            std::remove(filepath.c_str());
+            STDSC_THROW_FILE("Failed to spill ctxts. (" + filepath + ")");
+        }
+
+        spill_filepath_ = filepath;
+        buffer_.release();
+    }
+
+    void send(const stdsc::Socket& sock) const
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+
+        if (spill_filepath_.empty())
+        {
+            sock.send_buffer(buffer_);
+        }
+        else
+        {
+            sock.send_file(spill_filepath_, size_);
+        }
+    }
+
+    stdsc::Buffer buffer_;
+    size_t size_;
+    std::string spill_filepath_;
+    mutable std::mutex mtx_;
 };
 
 FHECtxtBuffer::FHECtxtBuffer()
@@ -81,4 +161,25 @@ void FHECtxtBuffer::deserialize(const FHEPubKey& pubkey, std::vector<Ctxt>& ctxt
     pimpl_->deserialize(pubkey, ctxts);
 }
 
+size_t FHECtxtBuffer::size() const
+{
+    return pimpl_->size_;
+}
+
+bool FHECtxtBuffer::is_spilled() const
+{
+    std::lock_guard<std::mutex> lock(pimpl_->mtx_);
+    return !pimpl_->spill_filepath_.empty();
+}
+
+void FHECtxtBuffer::spill(const std::string& filepath)
+{
+    pimpl_->spill(filepath);
+}
+
+void FHECtxtBuffer::send(const stdsc::Socket& sock) const
+{
+    pimpl_->send(sock);
+}
+
 } /* namespace sses_share */
@@ -19,10 +19,16 @@
 #define SSES_FHECTXT_BUFFER_HPP
 
 #include <memory>
+#include <string>
 #include <vector>
 
 class Ctxt;
 
+namespace stdsc
+{
+class Socket;
+}
+
 namespace sses_share
 {
 
@@ -48,6 +54,33 @@ public:
      * @param[out] ctxt ctxt
      */
     void deserialize(const FHEPubKey& pubkey, std::vector<Ctxt>& ctxts) const;
+
+    /**
+     * Size of serialized ctxts
+     * @return size (bytes)
+     */
+    size_t size() const;
+
+    /**
+     * Whether the serialized ctxts are spilled to file or not
+     * @return whether spilled or not
+     */
+    bool is_spilled() const;
+
+    /**
+     * Move serialized ctxts from memory to file
+     * @param[in] filepath file path
+     * @note The file is read back in deserialize() and removed when the
+     * last copy of this buffer is destroyed.
+     */
+    void spill(const std::string& filepath);
+
+    /**
+     * Send serialized ctxts as they are, i.e. as saved by EncData
+     * @param[in] sock socket
+     * @note Spilled ctxts are sent from the file by sendfile(2).
+     */
+    void send(const stdsc::Socket& sock) const;
     
 private:
     struct Impl;
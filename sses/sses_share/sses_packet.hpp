@@ -31,18 +31,28 @@ enum ControlCode_t : uint64_t
     /* Code for Request packet: 0x201-0x2FF */
 
     /* Code for Data packet: 0x401-0x4FF */
-    kControlCodeDataEncKeys = 0x401,
     kControlCodeDataQueryID = 0x402,
     kControlCodeDataChunkResult = 0x403,
     kControlCodeDataResult = 0x404,
     kControlCodeDataCancelQuery = 0x405,
+    kControlCodeDataAppendRecords = 0x406,
+    kControlCodeDataDBStatus = 0x407,
+    kControlCodeDataStats = 0x408,
+    kControlCodeDataQueryStatus = 0x409,
 
     /* Code for Download packet: 0x801-0x8FF */
+    kControlCodeDownloadStats = 0x801,
 
     /* Code for UpDownload packet: 0x1000-0x10FF */
-    kControlCodeUpDownloadQuery = 0x1001,
     kControlCodeUpDownloadChunkResult = 0x1002,
     kControlCodeUpDownloadResult = 0x1003,
+    kControlCodeUpDownloadDBStatus = 0x1004,
+    kControlCodeUpDownloadAppendRecords = 0x1005,
+    kControlCodeUpDownloadQueryStatus = 0x1006,
+
+    /* Code for Stream packet: 0x2001-0x20FF */
+    kControlCodeStreamEncKeys = 0x2001,
+    kControlCodeStreamQuery = 0x2002,
 };
 
 } /* namespace sses_share */
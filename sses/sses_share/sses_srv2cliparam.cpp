@@ -15,16 +15,95 @@
  * limitations under the License.
  */
 
+#include <cstring>
 #include <stdsc/stdsc_exception.hpp>
 #include <sses_share/sses_srv2cliparam.hpp>
+#include <sses_share/sses_varint.hpp>
 
 namespace sses_share
 {
 
+std::ostream& operator<<(std::ostream& os, const S2CQueryAckParam& param)
+{
+    auto i32_db_status = static_cast<int32_t>(param.db_status);
+    os << param.query_id << std::endl;
+    os << param.estimated_cost << std::endl;
+    os << i32_db_status << std::endl;
+    return os;
+}
+
+std::istream& operator>>(std::istream& is, S2CQueryAckParam& param)
+{
+    int32_t i32_db_status;
+    is >> param.query_id;
+    is >> param.estimated_cost;
+    is >> i32_db_status;
+    param.db_status = static_cast<DBStatus_t>(i32_db_status);
+    return is;
+}
+
+std::ostream& operator<<(std::ostream& os, const S2CQueryStatusParam& param)
+{
+    auto i32_status = static_cast<int32_t>(param.status);
+    os << param.query_id << std::endl;
+    os << i32_status << std::endl;
+    return os;
+}
+
+std::istream& operator>>(std::istream& is, S2CQueryStatusParam& param)
+{
+    int32_t i32_status;
+    is >> param.query_id;
+    is >> i32_status;
+    param.status = static_cast<ServerResultStatus_t>(i32_status);
+    return is;
+}
+
+std::ostream& operator<<(std::ostream& os, const S2CDBStatusParam& param)
+{
+    auto i32_status = static_cast<int32_t>(param.status);
+    os << i32_status << std::endl;
+    os << param.progress << std::endl;
+    return os;
+}
+
+std::istream& operator>>(std::istream& is, S2CDBStatusParam& param)
+{
+    int32_t i32_status;
+    is >> i32_status;
+    is >> param.progress;
+    param.status = static_cast<DBStatus_t>(i32_status);
+    return is;
+}
+
+std::ostream& operator<<(std::ostream& os, const S2CAppendResultParam& param)
+{
+    auto i32_status = static_cast<int32_t>(param.status);
+    os << i32_status << std::endl;
+    os << param.num_applied << std::endl;
+    os << param.num_skipped << std::endl;
+    os << param.num_keys << std::endl;
+    os << param.num_conflicts << std::endl;
+    return os;
+}
+
+std::istream& operator>>(std::istream& is, S2CAppendResultParam& param)
+{
+    int32_t i32_status;
+    is >> i32_status;
+    is >> param.num_applied;
+    is >> param.num_skipped;
+    is >> param.num_keys;
+    is >> param.num_conflicts;
+    param.status = static_cast<ServerResultStatus_t>(i32_status);
+    return is;
+}
+
 std::ostream& operator<<(std::ostream& os, const S2CChunkResultParam& param)
 {
     auto i32_status = static_cast<int32_t>(param.status);
     os << i32_status << std::endl;
+    os << param.key_id << std::endl;
     return os;
 }
 
@@ -32,6 +111,7 @@ std::istream& operator>>(std::istream& is, S2CChunkResultParam& param)
 {
     int32_t i32_status;
     is >> i32_status;
+    is >> param.key_id;
     param.status = static_cast<ServerResultStatus_t>(i32_status);
     return is;
 }
@@ -114,5 +194,94 @@ std::istream& operator>>(std::istream& is, S2CResultParam& param)
     return is;
 }
 
+template <class Func>
+static void for_each_varint(const S2CResultParam& param, Func func)
+{
+    STDSC_THROW_INVPARAM_IF_CHECK(param.recordIds.size() == param.numRes &&
+                                  param.medIds.size() == param.numRes &&
+                                  param.sideIds.size() == param.numRes,
+                                  "The size of results dones NOT match 'numRes'");
+    auto ids = [&func](const std::vector<int32_t>& v) {
+        func(v.size());
+        int64_t prev = 0;
+        for (const auto id : v) {
+            func(varint::zigzag(id - prev));
+            prev = id;
+        }
+    };
+
+    func(param.numRes);
+    int64_t prev = 0;
+    for (size_t i = 0; i < param.numRes; ++i) {
+        func(varint::zigzag(param.recordIds[i] - prev));
+        prev = param.recordIds[i];
+        ids(param.medIds[i]);
+        ids(param.sideIds[i]);
+    }
+}
+
+size_t encoded_size(const S2CResultParam& param)
+{
+    size_t sz = sizeof(uint64_t);
+    for_each_varint(param, [&sz](const uint64_t v) { sz += varint::size(v); });
+    return sz;
+}
+
+size_t encode(const S2CResultParam& param, void* buf)
+{
+    auto head = static_cast<uint8_t*>(buf);
+    auto p = head + sizeof(uint64_t);
+    for_each_varint(param, [&p](const uint64_t v) { p = varint::put(p, v); });
+
+    uint64_t payload_sz = p - head - sizeof(uint64_t);
+    std::memcpy(head, &payload_sz, sizeof(payload_sz));
+    return p - head;
+}
+
+void decode(const void* buf, const size_t size, S2CResultParam& param)
+{
+    STDSC_THROW_INVPARAM_IF_CHECK(size >= sizeof(uint64_t), "truncated result.");
+    auto p = static_cast<const uint8_t*>(buf);
+    uint64_t payload_sz;
+    std::memcpy(&payload_sz, p, sizeof(payload_sz));
+    p += sizeof(uint64_t);
+    STDSC_THROW_INVPARAM_IF_CHECK(payload_sz <= size - sizeof(uint64_t), "truncated result.");
+    const auto end = p + payload_sz;
+
+    auto ids = [&p, end](std::vector<int32_t>& v) {
+        uint64_t n, d;
+        p = varint::get(p, end, n);
+        // each ID takes at least one byte
+        STDSC_THROW_INVPARAM_IF_CHECK(n <= static_cast<uint64_t>(end - p), "truncated result.");
+        v.resize(n);
+        int64_t prev = 0;
+        for (auto& id : v) {
+            p = varint::get(p, end, d);
+            prev += varint::unzigzag(d);
+            id = static_cast<int32_t>(prev);
+        }
+    };
+
+    uint64_t n, d;
+    p = varint::get(p, end, n);
+    STDSC_THROW_INVPARAM_IF_CHECK(n <= static_cast<uint64_t>(end - p), "truncated result.");
+    param.numRes = n;
+    param.numMeds.resize(n);
+    param.numSides.resize(n);
+    param.recordIds.resize(n);
+    param.medIds.resize(n);
+    param.sideIds.resize(n);
+
+    int64_t prev = 0;
+    for (size_t i = 0; i < n; ++i) {
+        p = varint::get(p, end, d);
+        prev += varint::unzigzag(d);
+        param.recordIds[i] = static_cast<int32_t>(prev);
+        ids(param.medIds[i]);
+        param.numMeds[i] = param.medIds[i].size();
+        ids(param.sideIds[i]);
+        param.numSides[i] = param.sideIds[i].size();
+    }
+}
 
 } /* namespace sses_share */
@@ -18,6 +18,7 @@
 #ifndef SSES_SRV2CLIPARAM_HPP
 #define SSES_SRV2CLIPARAM_HPP
 
+#include <cstdint>
 #include <iostream>
 #include <vector>
 
@@ -32,8 +33,73 @@ enum ServerResultStatus_t : int32_t
     kServerResultStatusNil = -1,
     kServerResultStatusFailed = 0,
     kServerResultStatusSuccess = 1,
+    kServerResultStatusPending = 2, ///< not computed yet (only if not waiting)
 };
 
+/**
+ * @brief Enumeration for DB status of key.
+ */
+enum DBStatus_t : int32_t
+{
+    kDBStatusNil = -1,     ///< not registered
+    kDBStatusPending = 0,  ///< waiting for setup
+    kDBStatusBuilding = 1, ///< encrypting records
+    kDBStatusReady = 2,
+    kDBStatusFailed = 3,
+};
+
+/**
+ * @brief This class is used to hold the acknowledgement of query sent from server to client.
+ */
+struct S2CQueryAckParam
+{
+    int32_t query_id;        ///< query ID (-1 if the query was rejected)
+    uint64_t estimated_cost; ///< estimated number of records to calculate
+    DBStatus_t db_status;    ///< DB status of key (queries are rejected unless ready)
+};
+
+std::ostream& operator<<(std::ostream& os, const S2CQueryAckParam& param);
+std::istream& operator>>(std::istream& is, S2CQueryAckParam& param);
+
+/**
+ * @brief This class is used to hold the status of query sent from server to client.
+ */
+struct S2CQueryStatusParam
+{
+    int32_t query_id;
+    ServerResultStatus_t status; ///< kServerResultStatusPending while computed
+};
+
+std::ostream& operator<<(std::ostream& os, const S2CQueryStatusParam& param);
+std::istream& operator>>(std::istream& is, S2CQueryStatusParam& param);
+
+/**
+ * @brief This class is used to hold the DB status of key sent from server to client.
+ */
+struct S2CDBStatusParam
+{
+    DBStatus_t status;
+    uint32_t progress; ///< percent done of encryption
+};
+
+std::ostream& operator<<(std::ostream& os, const S2CDBStatusParam& param);
+std::istream& operator>>(std::istream& is, S2CDBStatusParam& param);
+
+/**
+ * @brief This class is used to hold the result of appending records sent from server to client.
+ */
+struct S2CAppendResultParam
+{
+    ServerResultStatus_t status;
+    uint64_t num_applied;   ///< records appended to the DB of every key
+    uint64_t num_skipped;   ///< records not appended as the batch is rejected
+    uint32_t num_keys;      ///< keys whose encrypted data got the records
+    uint32_t num_conflicts; ///< IDs already in the DB, followed by PlainData<int32_t> of them if any
+};
+
+std::ostream& operator<<(std::ostream& os, const S2CAppendResultParam& param);
+std::istream& operator>>(std::istream& is, S2CAppendResultParam& param);
+
 /**
  * @brief This class is used to hold the results for each chunk sent from server to client.
  */
@@ -62,6 +128,32 @@ struct S2CResultParam
 
 std::ostream& operator<<(std::ostream& os, const S2CResultParam& param);
 std::istream& operator>>(std::istream& is, S2CResultParam& param);
+
+/**
+ * Get size of binary encoding of S2CResultParam
+ * @param[in] param param
+ * @return size in bytes
+ */
+size_t encoded_size(const S2CResultParam& param);
+
+/**
+ * Encode S2CResultParam to binary
+ * The payload size (uint64_t) is followed by varints: numRes, then for
+ * each record the record ID, numMeds, medicine IDs, numSides and symptom
+ * IDs. Record IDs and the IDs in each list are delta coded with zigzag.
+ * @param[in] param param
+ * @param[out] buf output buffer (at least encoded_size(param) bytes)
+ * @return size in bytes
+ */
+size_t encode(const S2CResultParam& param, void* buf);
+
+/**
+ * Decode S2CResultParam from binary
+ * @param[in] buf input buffer
+ * @param[in] size size of input buffer
+ * @param[out] param param (capacity of vectors is reused)
+ */
+void decode(const void* buf, const size_t size, S2CResultParam& param);
     
 
 } /* namespace sses_share */
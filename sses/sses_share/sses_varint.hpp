@@ -0,0 +1,98 @@
+/*
+ * Copyright 2020 Yamana Laboratory, Waseda University
+ * Supported by JST CREST Grant Number JPMJCR1503, Japan.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE‐2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SSES_VARINT_HPP
+#define SSES_VARINT_HPP
+
+#include <cstddef>
+#include <cstdint>
+
+#include <stdsc/stdsc_exception.hpp>
+
+namespace sses_share
+{
+namespace varint
+{
+
+/**
+ * Map signed value to unsigned so that small magnitudes stay small
+ */
+inline uint64_t zigzag(const int64_t v)
+{
+    return (static_cast<uint64_t>(v) << 1) ^ static_cast<uint64_t>(v >> 63);
+}
+
+inline int64_t unzigzag(const uint64_t v)
+{
+    return static_cast<int64_t>(v >> 1) ^ -static_cast<int64_t>(v & 1);
+}
+
+/**
+ * Encoded size of value (LEB128)
+ */
+inline size_t size(uint64_t v)
+{
+    size_t n = 1;
+    while (v >= 0x80) {
+        v >>= 7;
+        ++n;
+    }
+    return n;
+}
+
+/**
+ * Write value (LEB128)
+ * @param[in] p output position
+ * @param[in] v value
+ * @return next output position
+ */
+inline uint8_t* put(uint8_t* p, uint64_t v)
+{
+    while (v >= 0x80) {
+        *p++ = static_cast<uint8_t>(v) | 0x80;
+        v >>= 7;
+    }
+    *p++ = static_cast<uint8_t>(v);
+    return p;
+}
+
+/**
+ * Read value (LEB128)
+ * @param[in] p input position
+ * @param[in] end end of input
+ * @param[out] v value
+ * @return next input position
+ */
+inline const uint8_t* get(const uint8_t* p, const uint8_t* end, uint64_t& v)
+{
+    v = 0;
+    for (int shift = 0; shift < 64; shift += 7)
+    {
+        STDSC_THROW_INVPARAM_IF_CHECK(p < end, "truncated varint.");
+        uint8_t b = *p++;
+        v |= static_cast<uint64_t>(b & 0x7f) << shift;
+        if (!(b & 0x80)) {
+            return p;
+        }
+    }
+    STDSC_THROW_INVPARAM("too long varint.");
+}
+
+} /* namespace varint */
+} /* namespace sses_share */
+
+#endif /* SSES_VARINT_HPP */
@@ -16,28 +16,207 @@
  */
 
 #include <vector>
+#include <mutex>
+#include <cstring>
 #include <stdsc/stdsc_buffer.hpp>
+#include <stdsc/stdsc_define.hpp>
 
 namespace stdsc
 {
 
+/* BufferPool */
+
+/**
+ * Size-classed pool of uninitialized blocks. Blocks are power-of-two
+ * sized between STDSC_BUFFER_POOL_MIN_BLOCK and STDSC_BUFFER_POOL_MAX_BLOCK
+ * and at most STDSC_BUFFER_POOL_MAX_BYTES are kept for reuse. Larger
+ * blocks are allocated and freed directly.
+ */
+class BufferPool
+{
+public:
+    static BufferPool& instance(void)
+    {
+        // never destroyed, buffers may be released during static destruction
+        static BufferPool* pool = new BufferPool();
+        return *pool;
+    }
+
+    uint8_t* acquire(std::size_t size, std::size_t& capacity)
+    {
+        int cls = size_class(size);
+        if (cls < 0)
+        {
+            capacity = size;
+            return new uint8_t[size];
+        }
+
+        capacity = block_size(cls);
+        {
+            std::lock_guard<std::mutex> lock(mtx_);
+            auto& list = free_[cls];
+            if (!list.empty())
+            {
+                auto* p = list.back();
+                list.pop_back();
+                pooled_bytes_ -= capacity;
+                return p;
+            }
+        }
+        return new uint8_t[capacity];
+    }
+
+    void release(uint8_t* p, std::size_t capacity)
+    {
+        int cls = size_class(capacity);
+        if (0 <= cls && block_size(cls) == capacity)
+        {
+            std::lock_guard<std::mutex> lock(mtx_);
+            if (pooled_bytes_ + capacity <= STDSC_BUFFER_POOL_MAX_BYTES)
+            {
+                free_[cls].push_back(p);
+                pooled_bytes_ += capacity;
+                return;
+            }
+        }
+        delete[] p;
+    }
+
+private:
+    BufferPool(void) : free_(num_classes()), pooled_bytes_(0)
+    {
+    }
+
+    static std::size_t block_size(int cls)
+    {
+        return static_cast<std::size_t>(STDSC_BUFFER_POOL_MIN_BLOCK) << cls;
+    }
+
+    static int num_classes(void)
+    {
+        int n = 0;
+        while (block_size(n) < STDSC_BUFFER_POOL_MAX_BLOCK)
+        {
+            ++n;
+        }
+        return n + 1;
+    }
+
+    /* smallest class holding size, -1 if too large to pool */
+    static int size_class(std::size_t size)
+    {
+        if (STDSC_BUFFER_POOL_MAX_BLOCK < size)
+        {
+            return -1;
+        }
+        int cls = 0;
+        while (block_size(cls) < size)
+        {
+            ++cls;
+        }
+        return cls;
+    }
+
+    std::vector<std::vector<uint8_t*>> free_;
+    std::size_t pooled_bytes_;
+    std::mutex mtx_;
+};
+
 /* Buffer */
 
 struct Buffer::Impl
 {
-    Impl(void) : buffer_()
+    Impl(void) : data_(nullptr), size_(0), capacity_(0), owned_(true)
     {
     }
 
-    Impl(std::size_t size) : buffer_(size)
+    explicit Impl(std::size_t size) : Impl()
     {
+        resize(size);
+    }
+
+    Impl(std::size_t size, uint8_t val) : Impl(size)
+    {
+        if (0 < size)
+        {
+            std::memset(data_, val, size);
+        }
     }
 
-    Impl(std::size_t size, uint8_t val) : buffer_(size, val)
+    /* non-owning view */
+    Impl(void* data, std::size_t size)
+        : data_(static_cast<uint8_t*>(data)),
+          size_(size),
+          capacity_(size),
+          owned_(false)
     {
     }
 
-    std::vector<uint8_t> buffer_;
+    /* memory given away by the caller */
+    Impl(void* data, std::size_t size,
+         std::function<void(void*, std::size_t)> deleter)
+        : Impl(data, size)
+    {
+        deleter_ = std::move(deleter);
+    }
+
+    ~Impl(void)
+    {
+        release();
+    }
+
+    Impl(const Impl&) = delete;
+    Impl& operator=(const Impl&) = delete;
+
+    /* contents are kept, added bytes are uninitialized */
+    void resize(std::size_t size)
+    {
+        if (capacity_ < size)
+        {
+            std::size_t capacity;
+            auto* p = BufferPool::instance().acquire(size, capacity);
+            if (0 < size_)
+            {
+                std::memcpy(p, data_, size_);
+            }
+            release();
+            data_ = p;
+            capacity_ = capacity;
+            owned_ = true;
+        }
+        size_ = size;
+    }
+
+    void release(void)
+    {
+        if (deleter_)
+        {
+            deleter_(data_, capacity_);
+            deleter_ = nullptr;
+        }
+        else if (owned_ && data_)
+        {
+            BufferPool::instance().release(data_, capacity_);
+        }
+        data_ = nullptr;
+        size_ = capacity_ = 0;
+        owned_ = true;
+    }
+
+    void swap(Impl& rhs)
+    {
+        std::swap(data_, rhs.data_);
+        std::swap(size_, rhs.size_);
+        std::swap(capacity_, rhs.capacity_);
+        std::swap(owned_, rhs.owned_);
+        std::swap(deleter_, rhs.deleter_);
+    }
+
+    uint8_t* data_;
+    std::size_t size_;
+    std::size_t capacity_;
+    bool owned_;
+    std::function<void(void*, std::size_t)> deleter_;
 };
 
 Buffer::Buffer(void) : pimpl_(new Impl())
@@ -52,41 +231,58 @@ Buffer::Buffer(std::size_t size, uint8_t val) : pimpl_(new Impl(size, val))
 {
 }
 
+Buffer::Buffer(void* data, std::size_t size) : pimpl_(new Impl(data, size))
+{
+}
+
+Buffer::Buffer(void* data, std::size_t size,
+               std::function<void(void*, std::size_t)> deleter)
+    : pimpl_(new Impl(data, size, std::move(deleter)))
+{
+}
+
 Buffer::Buffer(Buffer&& buffer) : pimpl_(new Impl())
 {
-    pimpl_->buffer_ = std::move(buffer.pimpl_->buffer_);
+    pimpl_->swap(*buffer.pimpl_);
 }
 
 Buffer& Buffer::operator=(Buffer&& buffer)
 {
-    pimpl_->buffer_ = std::move(buffer.pimpl_->buffer_);
+    pimpl_->release();
+    pimpl_->swap(*buffer.pimpl_);
     return *this;
 }
 
 void Buffer::resize(std::size_t size)
 {
-    pimpl_->buffer_.resize(size);
+    pimpl_->resize(size);
 }
 
 std::size_t Buffer::size(void) const
 {
-    return pimpl_->buffer_.size();
+    return pimpl_->size_;
 }
 
 const void* Buffer::data(void) const
 {
-    return reinterpret_cast<const void*>(pimpl_->buffer_.data());
+    return reinterpret_cast<const void*>(pimpl_->data_);
 }
 
 void* Buffer::data(void)
 {
-    return reinterpret_cast<void*>(pimpl_->buffer_.data());
+    return reinterpret_cast<void*>(pimpl_->data_);
+}
+
+void Buffer::release(void)
+{
+    pimpl_->release();
 }
 
 /* BufferStream */
 
-BufferStream::BufferStream(std::size_t size) : BufferStream(size, 0)
+BufferStream::BufferStream(std::size_t size) : Buffer(size)
 {
+    setup(reinterpret_cast<char*>(super::data()), size);
 }
 
 BufferStream::BufferStream(std::size_t size, uint8_t val) : Buffer(size, val)
@@ -99,6 +295,19 @@ BufferStream::BufferStream(const Buffer& buffer) : Buffer(buffer)
     setup(reinterpret_cast<char*>(super::data()), super::size());
 }
 
+BufferStream::BufferStream(void* data, std::size_t size) : Buffer(data, size)
+{
+    setup(reinterpret_cast<char*>(super::data()), size);
+}
+
+BufferStream::BufferStream(const void* data, std::size_t size)
+    : Buffer(const_cast<void*>(data), size)
+{
+    // read-only view, no put area
+    char* p = reinterpret_cast<char*>(super::data());
+    setg(p, p, p + size);
+}
+
 std::ios::pos_type BufferStream::seekoff(
     std::ios::off_type __off, 
     std::ios_base::seekdir __way, 
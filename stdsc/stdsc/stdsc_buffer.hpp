@@ -19,6 +19,7 @@
 #define STDSC_BUFFER_HPP
 
 #include <memory>
+#include <functional>
 #include <iostream>
 
 namespace stdsc
@@ -26,6 +27,8 @@ namespace stdsc
 
 /**
  * @brief This class is used to hold the generic data.
+ * Storage is taken from a size-classed pool and is not initialized
+ * unless a fill value is given. Copies share the storage.
  */
 class Buffer
 {
@@ -36,6 +39,24 @@ public:
     explicit Buffer(std::size_t size);
     Buffer(std::size_t size, uint8_t val);
 
+    /**
+     * Non-owning view over existing memory. The memory must outlive the
+     * buffer. Growing the buffer by resize() makes an owned copy.
+     * @param[in] data memory
+     * @param[in] size size of memory
+     */
+    Buffer(void* data, std::size_t size);
+
+    /**
+     * Takes existing memory, which is handed to deleter when the last
+     * copy of the buffer releases it.
+     * @param[in] data memory
+     * @param[in] size size of memory
+     * @param[in] deleter called with data and size on release
+     */
+    Buffer(void* data, std::size_t size,
+           std::function<void(void*, std::size_t)> deleter);
+
     virtual ~Buffer(void) = default;
 
     Buffer(const Buffer&) = default;
@@ -72,6 +93,20 @@ public:
     BufferStream(std::size_t size, uint8_t val);
     BufferStream(const Buffer& buffer);
 
+    /**
+     * Non-owning stream over existing memory.
+     * @param[in] data memory
+     * @param[in] size size of memory
+     */
+    BufferStream(void* data, std::size_t size);
+
+    /**
+     * Non-owning read-only stream over existing memory.
+     * @param[in] data memory
+     * @param[in] size size of memory
+     */
+    BufferStream(const void* data, std::size_t size);
+
     virtual ~BufferStream(void) = default;
 
     BufferStream(const BufferStream&) = delete;
@@ -49,6 +49,15 @@ void CallbackFunction::eval(uint64_t code, const Buffer& buffer,
     updownload_function(code, buffer, sock, state, cdata_on_each, cdata_on_all);
 }
 
+void CallbackFunction::eval(uint64_t code, const Buffer& buffer,
+                            const Socket& sock, uint64_t stream_size,
+                            StateContext& state,
+                            void* cdata_on_each, void* cdata_on_all)
+{
+    stream_function(code, buffer, sock, stream_size, state,
+                    cdata_on_each, cdata_on_all);
+}
+
 void CallbackFunction::request_function(uint64_t code, StateContext& state,
                                         void* cdata_on_each, void* cdata_on_all)
 {
@@ -76,4 +85,12 @@ void CallbackFunction::updownload_function(uint64_t code, const Buffer& buffer,
     STDSC_LOG_WARN("%s is not implemented.", __FUNCTION__);
 }
 
+void CallbackFunction::stream_function(uint64_t code, const Buffer& buffer,
+                                       const Socket& sock, uint64_t stream_size,
+                                       StateContext& state,
+                                       void* cdata_on_each, void* cdata_on_all)
+{
+    STDSC_LOG_WARN("%s is not implemented.", __FUNCTION__);
+}
+
 } /* stdsc */
@@ -65,6 +65,19 @@
             void* cdata_on_each, void* cdata_on_all) override;          \
     }
 
+#define DECLARE_STREAM_CLASS(cls)                                       \
+    class cls : public stdsc::CallbackFunction                          \
+    {                                                                   \
+    protected:                                                          \
+        virtual void stream_function(                                   \
+            uint64_t code,                                              \
+            const stdsc::Buffer& buffer,                                \
+            const stdsc::Socket& sock,                                  \
+            uint64_t stream_size,                                       \
+            stdsc::StateContext& state,                                 \
+            void* cdata_on_each, void* cdata_on_all) override;          \
+    }
+
 #define DEFUN_DATA(cls)                                                 \
     void cls::data_function(uint64_t code,                              \
                             const stdsc::Buffer& buffer,                \
@@ -89,6 +102,14 @@
                                   stdsc::StateContext& state,           \
                                   void* cdata_on_each, void* cdata_on_all)
 
+#define DEFUN_STREAM(cls)                                               \
+    void cls::stream_function(uint64_t code,                            \
+                              const stdsc::Buffer& buffer,              \
+                              const stdsc::Socket& sock,                \
+                              uint64_t stream_size,                     \
+                              stdsc::StateContext& state,               \
+                              void* cdata_on_each, void* cdata_on_all)
+
 /* DEFINE_REQUEST_FUNC macro is deplicated in v2.x */
 #define DEFINE_REQUEST_FUNC(cls)                                        \
     void cls::request_function(uint64_t code,                           \
@@ -139,6 +160,9 @@ public:
               void* cdata_on_each=nullptr, void* cdata_on_all=nullptr);
     void eval(uint64_t code, const Buffer& buffer, const Socket& sock, StateContext& state,
               void* cdata_on_each=nullptr, void* cdata_on_all=nullptr);
+    void eval(uint64_t code, const Buffer& buffer, const Socket& sock,
+              uint64_t stream_size, StateContext& state,
+              void* cdata_on_each=nullptr, void* cdata_on_all=nullptr);
 
 protected:
     virtual void request_function(uint64_t code, StateContext& state,
@@ -152,6 +176,16 @@ protected:
     virtual void updownload_function(uint64_t code, const Buffer& buffer,
                                      const Socket& sock, StateContext& state,
                                      void* cdata_on_each, void* cdata_on_all);
+    /**
+     * Called for stream packets. `buffer` holds the in-memory head and
+     * the remaining `stream_size` bytes are still on `sock`; receive them
+     * with Socket::recv_file or Socket::recv_buffer. Bytes left unread are
+     * discarded after the callback returns.
+     */
+    virtual void stream_function(uint64_t code, const Buffer& buffer,
+                                 const Socket& sock, uint64_t stream_size,
+                                 StateContext& state,
+                                 void* cdata_on_each, void* cdata_on_all);
 };
 } /* namespace stdsc */
 
@@ -26,6 +26,7 @@
 #include <stdsc/stdsc_socket.hpp>
 #include <stdsc/stdsc_buffer.hpp>
 #include <stdsc/stdsc_state.hpp>
+#include <stdsc/stdsc_exception.hpp>
 
 namespace stdsc
 {
@@ -34,7 +35,7 @@ struct CallbackFunctionContainer::Impl
 {
     Impl(void)
         : cdata_on_all_(),
-          cdata_on_each_()
+          factory_()
     {
     }
     ~Impl(void) = default;
@@ -45,18 +46,21 @@ struct CallbackFunctionContainer::Impl
         funcmap_.emplace(code, func);
     }
 
-    void eval(const Socket& sock, const Packet& packet, StateContext& state)
+    void eval(const Socket& sock, const Packet& packet, StateContext& state,
+              void* cdata_on_each)
     {
-        cdatamap_.emplace(sock.connection_id(), cdata_on_each_);
-        void* cdata_on_each = nullptr;
-        if (!cdata_on_each_.empty()) {
-            cdata_on_each = static_cast<void*>(cdatamap_[sock.connection_id()].data());
-        }
         void* cdata_on_all = (cdata_on_all_.empty()) ? nullptr : cdata_on_all_.data();
         
         auto code = static_cast<uint64_t>(packet.control_code);
         STDSC_LOG_TRACE("eval for 0x%x.", code);
-        if (code & kControlCodeGroupRequest)
+        if (code == kControlCodeDisConnected)
+        {
+            if (funcmap_.count(code))
+            {
+                funcmap_[code]->eval(code, state, cdata_on_each, cdata_on_all);
+            }
+        }
+        else if (code & kControlCodeGroupRequest)
         {
             if (funcmap_.count(code))
             {
@@ -92,7 +96,42 @@ struct CallbackFunctionContainer::Impl
                 funcmap_[code]->eval(code, buffer, sock, state, cdata_on_each, cdata_on_all);
             }
         }
-        
+        else if (code & kControlCodeGroupStream)
+        {
+            std::size_t head_size = packet.u_body.stream.head_size;
+            std::size_t stream_size = packet.u_body.stream.size - head_size;
+            STDSC_LOG_TRACE("head size: %lu, stream size: %lu",
+                            head_size, stream_size);
+            Buffer buffer(head_size);
+            sock.recv_buffer(buffer);
+
+            // keep the connection in sync even if the callback did not
+            // consume the whole stream (e.g. rejected it)
+            auto start = sock.received_bytes();
+            auto drain = [&]() {
+                auto consumed = sock.received_bytes() - start;
+                if (consumed < stream_size)
+                {
+                    sock.discard(stream_size - consumed);
+                }
+            };
+            try
+            {
+                if (funcmap_.count(code))
+                {
+                    funcmap_[code]->eval(code, buffer, sock, stream_size,
+                                         state, cdata_on_each, cdata_on_all);
+                }
+            }
+            catch (...)
+            {
+                // whatever the callback threw, the unread part of the
+                // stream must not be taken as the next packet
+                drain();
+                throw;
+            }
+            drain();
+        }
     }
 
     void set_commondata(const void* data, const size_t size, const CommonDataKind_t kind)
@@ -105,17 +144,31 @@ struct CallbackFunctionContainer::Impl
             break;
         case kCommonDataOnEachConnection:
         default:
-            cdata_on_each_.clear();
-            cdata_on_each_.resize(size);
-            std::memcpy(cdata_on_each_.data(), data, size);
+            // each connection gets a copy of the bytes
+            auto tmpl = std::make_shared<std::vector<uint8_t>>(
+              static_cast<const uint8_t*>(data),
+              static_cast<const uint8_t*>(data) + size);
+            factory_ = [tmpl]() {
+                auto copy = std::make_shared<std::vector<uint8_t>>(*tmpl);
+                return std::shared_ptr<void>(copy, copy->data());
+            };
         }
     }
 
+    void set_connection_data_factory(connection_data_factory_t factory)
+    {
+        factory_ = factory;
+    }
+
+    std::shared_ptr<void> create_connection_data(void) const
+    {
+        return factory_ ? factory_() : std::shared_ptr<void>();
+    }
+
 private:
     std::vector<uint8_t> cdata_on_all_; ///< common data on all connection
-    std::vector<uint8_t> cdata_on_each_; ///< common data on each connection
+    connection_data_factory_t factory_; ///< creates data on each connection
     std::unordered_map<uint64_t, std::shared_ptr<CallbackFunction>> funcmap_; ///< func map for each control code
-    std::unordered_map<int, std::vector<uint8_t>> cdatamap_; ///< common data map on each connection
 };
 
 CallbackFunctionContainer::CallbackFunctionContainer(void) : pimpl_(new Impl())
@@ -133,9 +186,9 @@ void CallbackFunctionContainer::set(uint64_t code,
 }
 
 void CallbackFunctionContainer::eval(const Socket& sock, const Packet& packet,
-                                        StateContext& state)
+                                     StateContext& state, void* cdata_on_each)
 {
-    pimpl_->eval(sock, packet, state);
+    pimpl_->eval(sock, packet, state, cdata_on_each);
 }
 
 void CallbackFunctionContainer::set_commondata(const void* data, const size_t size,
@@ -144,4 +197,15 @@ void CallbackFunctionContainer::set_commondata(const void* data, const size_t si
     pimpl_->set_commondata(data, size, kind);
 }
 
+void CallbackFunctionContainer::set_connection_data_factory(
+  connection_data_factory_t factory)
+{
+    pimpl_->set_connection_data_factory(factory);
+}
+
+std::shared_ptr<void> CallbackFunctionContainer::create_connection_data(void) const
+{
+    return pimpl_->create_connection_data();
+}
+
 } /* namespace stdsc */
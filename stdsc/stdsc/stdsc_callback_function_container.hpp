@@ -18,6 +18,7 @@
 #ifndef STDSC_CALLBACK_FUNCTION_CONTAINER_HPP
 #define STDSC_CALLBACK_FUNCTION_CONTAINER_HPP
 
+#include <functional>
 #include <memory>
 #include <vector>
 
@@ -45,12 +46,53 @@ enum CommonDataKind_t
 class CallbackFunctionContainer
 {
 public:
+    using connection_data_factory_t = std::function<std::shared_ptr<void>(void)>;
+
     CallbackFunctionContainer(void);
     virtual ~CallbackFunctionContainer(void);
     void set(uint64_t code, std::shared_ptr<CallbackFunction>& func);
-    void eval(const Socket& sock, const Packet& packet, StateContext& state);
+
+    /**
+     * Evaluate callback function for packet
+     * @param[in] sock          socket
+     * @param[in] packet        packet
+     * @param[in] state         state of connection
+     * @param[in] cdata_on_each data of connection (see create_connection_data)
+     */
+    void eval(const Socket& sock, const Packet& packet, StateContext& state,
+              void* cdata_on_each);
+
+    /**
+     * Set common data. Data on each connection is copied bytewise for each
+     * connection, so it must be trivially copyable; use
+     * set_connection_data otherwise.
+     */
     void set_commondata(const void* data, const size_t size,
                         const CommonDataKind_t kind=kCommonDataOnEachConnection);
+
+    /**
+     * Set factory of the data on each connection. The data is created when
+     * a connection is accepted and destroyed when it is closed.
+     * @param[in] factory factory
+     */
+    void set_connection_data_factory(connection_data_factory_t factory);
+
+    /**
+     * Hold a default constructed T on each connection.
+     */
+    template <class T>
+    void set_connection_data(void)
+    {
+        set_connection_data_factory(
+          []() { return std::shared_ptr<void>(std::make_shared<T>()); });
+    }
+
+    /**
+     * Create the data of a new connection
+     * @return data (nullptr if there is no data on each connection)
+     */
+    std::shared_ptr<void> create_connection_data(void) const;
+
 private:
     struct Impl;
     std::shared_ptr<Impl> pimpl_;
@@ -16,6 +16,7 @@
  */
 
 #include <unistd.h>
+#include <sys/stat.h>
 #include <sstream>
 #include <mutex>
 #include <stdsc/stdsc_client.hpp>
@@ -25,6 +26,7 @@
 #include <stdsc/stdsc_exception.hpp>
 #include <stdsc/stdsc_buffer.hpp>
 #include <stdsc/stdsc_define.hpp>
+#include <stdsc/stdsc_compression.hpp>
 
 namespace stdsc
 {
@@ -55,6 +57,12 @@ static inline std::string count2str(uint32_t count)
 struct Client::Impl
 {
     Impl(void)
+        : framing_(kFramingCompact),
+          request_id_(0),
+          codec_(kCodecNone),
+          threshold_(STDSC_COMPRESSION_THRESHOLD),
+          shm_(false),
+          shm_threshold_(STDSC_SHM_THRESHOLD)
     {
     }
 
@@ -79,6 +87,7 @@ struct Client::Impl
             try
             {
                 sock_ = Socket::establish_connection(host, port);
+                sock_.set_framing(framing_);
                 is_success = true;
             }
             catch (const SocketException& e)
@@ -94,6 +103,15 @@ struct Client::Impl
         STDSC_THROW_SOCKET_IF_CHECK(max_retry_count > retry_count,
                                     "Connection time out");
 
+        if (kCodecNone != codec_ && kFramingCompact == framing_)
+        {
+            negotiate_compression();
+        }
+        if (shm_ && sock_.is_local() && kFramingCompact == framing_)
+        {
+            negotiate_shared_memory();
+        }
+
         STDSC_LOG_TRACE("Connected to server (%s)", host);
     }
 
@@ -110,7 +128,7 @@ struct Client::Impl
         
         STDSC_LOG_TRACE("Send request packet. (code:0x%08x)", code);
         auto control_code = code;
-        auto packet = make_packet(control_code);
+        auto packet = stamp(make_packet(control_code));
         sock_.send_packet(packet);
 
         Packet ack;
@@ -141,8 +159,7 @@ struct Client::Impl
                         buffer.size());
         auto size = static_cast<uint64_t>(buffer.size());
         auto control_code = code;
-        sock_.send_packet(make_data_packet(control_code, size));
-        sock_.send_buffer(buffer);
+        sock_.send_packet(stamp(make_data_packet(control_code, size)), buffer);
 
         Packet ack;
         sock_.recv_packet(ack);
@@ -170,7 +187,7 @@ struct Client::Impl
         
         STDSC_LOG_TRACE("Send data request packet. (code:0x%08x)", code);
         auto control_code = code;
-        auto packet = make_packet(control_code);
+        auto packet = stamp(make_packet(control_code));
         sock_.send_packet(packet);
 
         Packet recv_packet;
@@ -220,8 +237,25 @@ struct Client::Impl
                         sbuffer.size());
         auto ssize = static_cast<uint64_t>(sbuffer.size());
         auto control_code = code;
-        sock_.send_packet(make_data_packet(control_code, ssize));
-        sock_.send_buffer(sbuffer);
+        send_recv(make_data_packet(control_code, ssize), sbuffer, rbuffer);
+    }
+
+    void send_recv_stream(const uint64_t code, const Buffer& sbuffer,
+                          const std::size_t head_size, Buffer& rbuffer)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        
+        STDSC_LOG_TRACE("Send stream packet. (code:0x%08x, sz:%lu, head:%lu)",
+                        code, sbuffer.size(), head_size);
+        auto ssize = static_cast<uint64_t>(sbuffer.size());
+        auto control_code = code;
+        send_recv(make_stream_packet(control_code, ssize, head_size),
+                  sbuffer, rbuffer);
+    }
+
+    void send_recv(const Packet& packet, const Buffer& sbuffer, Buffer& rbuffer)
+    {
+        sock_.send_packet(stamp(packet), sbuffer);
 
         Packet recv_packet;
         sock_.recv_packet(recv_packet);
@@ -262,9 +296,128 @@ struct Client::Impl
         }
     }
 
+    void send_stream(const uint64_t code, const Buffer& head,
+                     const std::vector<std::string>& filepaths)
+    {
+        std::vector<std::size_t> sizes;
+        uint64_t size = head.size();
+        for (const auto& filepath : filepaths)
+        {
+            struct stat st;
+            STDSC_THROW_FILE_IF_CHECK(0 == ::stat(filepath.c_str(), &st),
+                                      "Failed to stat. (" + filepath + ")");
+            sizes.push_back(static_cast<std::size_t>(st.st_size));
+            size += st.st_size;
+        }
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        
+        STDSC_LOG_TRACE("Send stream packet. (code:0x%08x, sz:%lu, files:%lu)",
+                        code, size, filepaths.size());
+        auto control_code = code;
+        sock_.send_packet(stamp(make_stream_packet(control_code, size, head.size())),
+                          head);
+        for (std::size_t i = 0; i < filepaths.size(); ++i)
+        {
+            sock_.send_file(filepaths[i], sizes[i]);
+        }
+
+        Packet ack;
+        sock_.recv_packet(ack);
+        STDSC_LOG_TRACE("ack: 0x%x", ack.control_code);
+
+        if (ack.control_code == kControlCodeReject)
+        {
+            std::ostringstream ss;
+            ss << "Rejected to send stream. (0x" << std::hex
+               << ack.control_code << ")";
+            STDSC_THROW_REJECT(ss.str());
+        }
+        if (ack.control_code == kControlCodeFailed)
+        {
+            std::ostringstream ss;
+            ss << "Failed to send stream. (0x" << std::hex << ack.control_code
+               << ")";
+            STDSC_THROW_FAILURE(ss.str());
+        }
+    }
+
+    void set_framing(const Framing_t framing)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        framing_ = framing;
+        sock_.set_framing(framing);
+    }
+
+    void set_compression(const uint32_t codec, const std::size_t threshold)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        codec_ = codec;
+        threshold_ = threshold;
+    }
+
+    void set_shared_memory(const bool enable, const std::size_t threshold)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        shm_ = enable;
+        shm_threshold_ = threshold;
+    }
+
 private:
+    void negotiate_compression(void)
+    {
+        auto packet = stamp(make_packet(kControlCodeCompression));
+        packet.u_body.compression.codec = codec_;
+        packet.u_body.compression.threshold = threshold_;
+        sock_.send_packet(packet);
+
+        // servers without compression answer Accept with no codec
+        Packet ack;
+        sock_.recv_packet(ack);
+        uint32_t codec = kCodecNone;
+        if (kControlCodeAccept == ack.control_code)
+        {
+            codec = static_cast<uint32_t>(ack.u_body.compression.codec) & codec_;
+        }
+        sock_.set_compression(codec, threshold_);
+        STDSC_LOG_INFO("Negotiated compression. (codec:0x%x, threshold:%lu)",
+                       codec, threshold_);
+    }
+
+    void negotiate_shared_memory(void)
+    {
+        auto packet = stamp(make_packet(kControlCodeSharedMemory));
+        packet.u_body.shared_memory.enable = 1;
+        packet.u_body.shared_memory.threshold = shm_threshold_;
+        sock_.send_packet(packet);
+
+        Packet ack;
+        sock_.recv_packet(ack);
+        bool enable = kControlCodeAccept == ack.control_code
+                      && 0 != ack.u_body.shared_memory.enable;
+        sock_.set_shared_memory(enable, shm_threshold_);
+        STDSC_LOG_INFO("Negotiated shared memory. (enable:%d, threshold:%lu)",
+                       sock_.shared_memory(), shm_threshold_);
+    }
+
+    Packet stamp(Packet packet)
+    {
+        if (0 == ++request_id_)
+        {
+            ++request_id_; // 0 means "no request ID"
+        }
+        packet.request_id = request_id_;
+        return packet;
+    }
+
     stdsc::Socket sock_;
     std::mutex mutex_;
+    Framing_t framing_;
+    uint32_t request_id_;
+    uint32_t codec_;
+    std::size_t threshold_;
+    bool shm_;
+    std::size_t shm_threshold_;
 };
 
 Client::Client(void) : pimpl_(new Impl())
@@ -287,6 +440,21 @@ void Client::close(void)
     pimpl_->close();
 }
 
+void Client::set_framing(const Framing_t framing)
+{
+    pimpl_->set_framing(framing);
+}
+
+void Client::set_compression(const uint32_t codec, const std::size_t threshold)
+{
+    pimpl_->set_compression(codec, threshold);
+}
+
+void Client::set_shared_memory(const bool enable, const std::size_t threshold)
+{
+    pimpl_->set_shared_memory(enable, threshold);
+}
+
 void Client::send_request(const uint64_t code)
 {
     try
@@ -335,6 +503,32 @@ void Client::send_recv_data(const uint64_t code, const Buffer& sbuffer, Buffer&
     }
 }
 
+void Client::send_stream(const uint64_t code, const Buffer& head,
+                         const std::vector<std::string>& filepaths)
+{
+    try
+    {
+        pimpl_->send_stream(code, head, filepaths);
+    }
+    catch (const stdsc::SocketException& e)
+    {
+        STDSC_LOG_TRACE("Failed to send stream.");
+    }
+}
+
+void Client::send_recv_stream(const uint64_t code, const Buffer& sbuffer,
+                              const std::size_t head_size, Buffer& rbuffer)
+{
+    try
+    {
+        pimpl_->send_recv_stream(code, sbuffer, head_size, rbuffer);
+    }
+    catch (const stdsc::SocketException& e)
+    {
+        STDSC_LOG_TRACE("Failed to recv data.");
+    }
+}
+
 void Client::send_request_blocking(const uint64_t code,
                                    const uint32_t retry_interval_usec,
                                    const uint32_t timeout_sec)
@@ -460,4 +654,70 @@ void Client::send_recv_data_blocking(const uint64_t code,
                                 "Receiving data time out");
 }
 
+void Client::send_recv_stream_blocking(const uint64_t code,
+                                      const Buffer& sbuffer,
+                                      const std::size_t head_size,
+                                      Buffer& rbuffer,
+                                      const uint32_t retry_interval_usec,
+                                      const uint32_t timeout_sec)
+{
+    bool is_success = false;
+    uint32_t retry_count = 0;
+
+    uint32_t max_retry_count =
+      calc_retry_count(timeout_sec, retry_interval_usec);
+
+    while (!is_success && max_retry_count > retry_count)
+    {
+        try
+        {
+            send_recv_stream(code, sbuffer, head_size, rbuffer);
+            is_success = true;
+        }
+        catch (const stdsc::RejectException& e)
+        {
+            retry_count++;
+            STDSC_LOG_TRACE("Retry to recv data. (%d / %d)", retry_count,
+                            max_retry_count);
+            usleep(retry_interval_usec);
+            continue;
+        }
+    }
+
+    STDSC_THROW_SOCKET_IF_CHECK(max_retry_count > retry_count,
+                                "Receiving data time out");
+}
+
+void Client::send_stream_blocking(const uint64_t code, const Buffer& head,
+                                  const std::vector<std::string>& filepaths,
+                                  const uint32_t retry_interval_usec,
+                                  const uint32_t timeout_sec)
+{
+    bool is_success = false;
+    uint32_t retry_count = 0;
+
+    uint32_t max_retry_count =
+      calc_retry_count(timeout_sec, retry_interval_usec);
+
+    while (!is_success && max_retry_count > retry_count)
+    {
+        try
+        {
+            send_stream(code, head, filepaths);
+            is_success = true;
+        }
+        catch (const stdsc::RejectException& e)
+        {
+            retry_count++;
+            STDSC_LOG_TRACE("Retry to send stream. (%d / %d)", retry_count,
+                            max_retry_count);
+            usleep(retry_interval_usec);
+            continue;
+        }
+    }
+
+    STDSC_THROW_SOCKET_IF_CHECK(max_retry_count > retry_count,
+                                "Sending stream time out");
+}
+
 } /* namespace opsica_packet */
@@ -19,7 +19,11 @@
 #define STDSC_CLIENT_HPP
 
 #include <memory>
+#include <string>
+#include <vector>
 #include <stdsc/stdsc_define.hpp>
+#include <stdsc/stdsc_packet.hpp>
+#include <stdsc/stdsc_compression.hpp>
 
 namespace stdsc
 {
@@ -41,10 +45,56 @@ public:
 
     void close(void);
 
+    /**
+     * Select framing of packets. Use kFramingLegacy to talk to servers
+     * built with older stdsc.
+     * @param[in] framing framing (default: kFramingCompact)
+     */
+    void set_framing(const Framing_t framing);
+
+    /**
+     * Request payload compression. Negotiated with the server on connect,
+     * so call this before connect(). Needs the compact framing.
+     * @param[in] codec     codec (Codec_t, kCodecNone to disable)
+     * @param[in] threshold payloads smaller than this are sent raw
+     */
+    void set_compression(const uint32_t codec,
+                         const std::size_t threshold = STDSC_COMPRESSION_THRESHOLD);
+
+    /**
+     * Pass large payloads in shared memory (memfd) instead of through the
+     * socket. Only takes effect for "unix:<path>" endpoints; negotiated
+     * with the server on connect, so call this before connect().
+     * @param[in] enable    enable or disable
+     * @param[in] threshold payloads smaller than this go through the socket
+     */
+    void set_shared_memory(const bool enable,
+                           const std::size_t threshold = STDSC_SHM_THRESHOLD);
+
     void send_request(const uint64_t code);
     void send_data(const uint64_t code, const Buffer& buffer);
     void recv_data(const uint64_t code, Buffer& buffer);
     void send_recv_data(const uint64_t code, const Buffer& sbuffer, Buffer& rbuffer);
+    /**
+     * Send head followed by the contents of files. File contents are sent
+     * with sendfile(2), i.e. not loaded into memory.
+     * @param[in] code      control code (stream group)
+     * @param[in] head      in-memory head
+     * @param[in] filepaths files to follow the head
+     */
+    void send_stream(const uint64_t code, const Buffer& head,
+                     const std::vector<std::string>& filepaths);
+    /**
+     * Send buffer as stream packet and receive the response. The server
+     * gets the first `head_size` bytes in memory and reads the rest from
+     * the socket while processing (see SocketStreamBuf).
+     * @param[in]  code      control code (stream group)
+     * @param[in]  sbuffer   buffer to send
+     * @param[in]  head_size size of head in sbuffer
+     * @param[out] rbuffer   received buffer
+     */
+    void send_recv_stream(const uint64_t code, const Buffer& sbuffer,
+                          const std::size_t head_size, Buffer& rbuffer);
 
     void send_request_blocking(const uint64_t code,
                                const uint32_t retry_interval_usec =
@@ -64,6 +114,18 @@ public:
                                  const uint32_t retry_interval_usec =
                                  STDSC_RETRY_INTERVAL_USEC,
                                  const uint32_t timeout_sec = STDSC_TIME_INFINITE);
+    void send_recv_stream_blocking(const uint64_t code,
+                                   const Buffer& sbuffer,
+                                   const std::size_t head_size, Buffer& rbuffer,
+                                   const uint32_t retry_interval_usec =
+                                     STDSC_RETRY_INTERVAL_USEC,
+                                   const uint32_t timeout_sec =
+                                     STDSC_TIME_INFINITE);
+    void send_stream_blocking(const uint64_t code, const Buffer& head,
+                              const std::vector<std::string>& filepaths,
+                              const uint32_t retry_interval_usec =
+                                STDSC_RETRY_INTERVAL_USEC,
+                              const uint32_t timeout_sec = STDSC_TIME_INFINITE);
 
 private:
     struct Impl;
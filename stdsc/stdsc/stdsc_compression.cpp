@@ -0,0 +1,143 @@
+/*
+ * Copyright 2018 Yamana Laboratory, Waseda University
+ * Supported by JST CREST Grant Number JPMJCR1503, Japan.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE‐2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <time.h>
+#include <atomic>
+#include <sstream>
+#if defined(STDSC_WITH_ZLIB)
+#include <zlib.h>
+#endif
+#include <stdsc/stdsc_compression.hpp>
+#include <stdsc/stdsc_buffer.hpp>
+#include <stdsc/stdsc_define.hpp>
+#include <stdsc/stdsc_exception.hpp>
+#include <stdsc/stdsc_log.hpp>
+
+namespace stdsc
+{
+
+static std::atomic<uint64_t> num_compressed(0);
+static std::atomic<uint64_t> num_skipped(0);
+static std::atomic<uint64_t> raw_bytes(0);
+static std::atomic<uint64_t> wire_bytes(0);
+static std::atomic<uint64_t> compress_usec(0);
+static std::atomic<uint64_t> num_decompressed(0);
+static std::atomic<uint64_t> decompress_usec(0);
+
+static uint64_t cputime_usec(void)
+{
+    struct timespec ts;
+    ::clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1000000 + ts.tv_nsec / 1000;
+}
+
+double CompressionStats::ratio(void) const
+{
+    return (0 < raw_bytes) ? static_cast<double>(wire_bytes) / raw_bytes : 1.0;
+}
+
+std::string CompressionStats::to_string(void) const
+{
+    std::ostringstream oss;
+    oss << "compressed: " << num_compressed
+        << ", skipped: " << num_skipped
+        << ", raw: " << raw_bytes << " bytes"
+        << ", wire: " << wire_bytes << " bytes"
+        << ", ratio: " << ratio()
+        << ", compress: " << compress_usec << " usec"
+        << ", decompressed: " << num_decompressed
+        << ", decompress: " << decompress_usec << " usec";
+    return oss.str();
+}
+
+uint32_t supported_codecs(void)
+{
+#if defined(STDSC_WITH_ZLIB)
+    return kCodecZlib;
+#else
+    return kCodecNone;
+#endif
+}
+
+bool compress(const uint32_t codec, const void* src, const std::size_t size,
+              Buffer& dst)
+{
+    bool is_smaller = false;
+    auto start = cputime_usec();
+
+#if defined(STDSC_WITH_ZLIB)
+    if (kCodecZlib == codec)
+    {
+        uLongf dst_size = ::compressBound(size);
+        dst.resize(dst_size);
+        int ret = ::compress2(static_cast<Bytef*>(dst.data()), &dst_size,
+                              static_cast<const Bytef*>(src), size,
+                              STDSC_COMPRESSION_LEVEL);
+        STDSC_THROW_FAILURE_IF_CHECK(Z_OK == ret, "Failed to compress");
+        dst.resize(dst_size);
+        is_smaller = (dst_size < size);
+    }
+#endif
+
+    compress_usec += cputime_usec() - start;
+    if (is_smaller)
+    {
+        ++num_compressed;
+        raw_bytes += size;
+        wire_bytes += dst.size();
+    }
+    else
+    {
+        ++num_skipped;
+    }
+    return is_smaller;
+}
+
+void decompress(const uint32_t codec, const void* src, const std::size_t size,
+                void* dst, const std::size_t dst_size)
+{
+    auto start = cputime_usec();
+
+#if defined(STDSC_WITH_ZLIB)
+    STDSC_THROW_FAILURE_IF_CHECK(kCodecZlib == codec, "Unsupported codec");
+    uLongf len = dst_size;
+    int ret = ::uncompress(static_cast<Bytef*>(dst), &len,
+                           static_cast<const Bytef*>(src), size);
+    STDSC_THROW_FAILURE_IF_CHECK(Z_OK == ret && dst_size == len,
+                                 "Failed to decompress");
+#else
+    STDSC_THROW_FAILURE("Unsupported codec");
+#endif
+
+    decompress_usec += cputime_usec() - start;
+    ++num_decompressed;
+}
+
+CompressionStats compression_stats(void)
+{
+    CompressionStats stats;
+    stats.num_compressed = num_compressed;
+    stats.num_skipped = num_skipped;
+    stats.raw_bytes = raw_bytes;
+    stats.wire_bytes = wire_bytes;
+    stats.compress_usec = compress_usec;
+    stats.num_decompressed = num_decompressed;
+    stats.decompress_usec = decompress_usec;
+    return stats;
+}
+
+} /* namespace stdsc */
@@ -0,0 +1,95 @@
+/*
+ * Copyright 2018 Yamana Laboratory, Waseda University
+ * Supported by JST CREST Grant Number JPMJCR1503, Japan.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE‐2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef STDSC_COMPRESSION_HPP
+#define STDSC_COMPRESSION_HPP
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+
+namespace stdsc
+{
+
+class Buffer;
+
+/**
+ * @brief Enumeration for codec of payload compression.
+ */
+enum Codec_t : uint32_t
+{
+    kCodecNone = 0x0,
+    kCodecZlib = 0x1,
+};
+
+/**
+ * @brief Statistics of payload compression in this process.
+ */
+struct CompressionStats
+{
+    uint64_t num_compressed = 0;   ///< payloads sent compressed
+    uint64_t num_skipped = 0;      ///< payloads not smaller when compressed
+    uint64_t raw_bytes = 0;        ///< size of compressed payloads before compression
+    uint64_t wire_bytes = 0;       ///< size of compressed payloads on the wire
+    uint64_t compress_usec = 0;    ///< CPU time spent to compress
+    uint64_t num_decompressed = 0; ///< payloads received compressed
+    uint64_t decompress_usec = 0;  ///< CPU time spent to decompress
+
+    /**
+     * wire_bytes / raw_bytes (1.0 if nothing was compressed)
+     */
+    double ratio(void) const;
+
+    std::string to_string(void) const;
+};
+
+/**
+ * Codecs available in this build.
+ * @return bitmask of Codec_t
+ */
+uint32_t supported_codecs(void);
+
+/**
+ * Compress data.
+ * @param[in]  codec codec
+ * @param[in]  src   data
+ * @param[in]  size  size of data
+ * @param[out] dst   compressed data
+ * @return false if the data did not get smaller (dst is undefined)
+ */
+bool compress(const uint32_t codec, const void* src, const std::size_t size,
+              Buffer& dst);
+
+/**
+ * Decompress data.
+ * @param[in]  codec    codec
+ * @param[in]  src      compressed data
+ * @param[in]  size     size of compressed data
+ * @param[out] dst      buffer for the original data
+ * @param[in]  dst_size size of the original data
+ */
+void decompress(const uint32_t codec, const void* src, const std::size_t size,
+                void* dst, const std::size_t dst_size);
+
+/**
+ * Snapshot of the compression statistics.
+ */
+CompressionStats compression_stats(void);
+
+} /* namespace stdsc */
+
+#endif /* STDSC_COMPRESSION_HPP */
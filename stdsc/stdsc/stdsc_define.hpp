@@ -24,5 +24,20 @@
 
 #define STDSC_TCP_BUFFER_SIZE (1 * 1024 * 1024)
 #define STDSC_CONN_TIMEOUT_SEC (30)
+#define STDSC_FILE_CHUNK_SIZE (1 * 1024 * 1024)
+#define STDSC_STREAM_WINDOW_SIZE (1 * 1024 * 1024)
+
+#define STDSC_BUFFER_POOL_MIN_BLOCK (4 * 1024)
+#define STDSC_BUFFER_POOL_MAX_BLOCK (64 * 1024 * 1024)
+#define STDSC_BUFFER_POOL_MAX_BYTES (256 * 1024 * 1024)
+
+#define STDSC_COMPRESSION_THRESHOLD (4 * 1024)
+#define STDSC_COMPRESSION_LEVEL (1)
+#define STDSC_COMPRESSION_FRAME_SIZE (256 * 1024)
+
+#define STDSC_SERVER_MAX_CONNECTIONS (256)
+#define STDSC_SERVER_POLL_INTERVAL_SEC (1)
+
+#define STDSC_SHM_THRESHOLD (64 * 1024)
 
 #endif /* STDSC_DEFINE_HPP */
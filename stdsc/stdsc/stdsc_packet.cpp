@@ -23,12 +23,13 @@
 namespace stdsc
 {
 
-Packet::Packet(void) : control_code(kControlCodeNil)
+Packet::Packet(void) : control_code(kControlCodeNil), request_id(0)
 {
     std::fill(&u_body.padding[0], &u_body.padding[STDSC_PACKET_BODY_SIZE], 0);
 }
 
-Packet::Packet(uint64_t control_code_) : control_code(control_code_)
+Packet::Packet(uint64_t control_code_)
+    : control_code(control_code_), request_id(0)
 {
     std::fill(&u_body.padding[0], &u_body.padding[STDSC_PACKET_BODY_SIZE], 0);
 }
@@ -36,6 +37,7 @@ Packet::Packet(uint64_t control_code_) : control_code(control_code_)
 void initialize_packet(Packet& packet)
 {
     packet.control_code = kControlCodeNil;
+    packet.request_id = 0;
     std::fill(&packet.u_body.padding[0],
               &packet.u_body.padding[STDSC_PACKET_BODY_SIZE], 0);
 }
@@ -50,6 +52,18 @@ Packet make_data_packet(uint64_t control_code, uint64_t size)
     return packet;
 }
 
+Packet make_stream_packet(uint64_t control_code, uint64_t size,
+                          uint64_t head_size)
+{
+    STDSC_IF_CHECK(static_cast<uint64_t>(control_code) & kControlCodeGroupStream,
+                   "invalid control code");
+    STDSC_IF_CHECK(head_size <= size, "invalid head size");
+    Packet packet(control_code);
+    packet.u_body.stream.size = size;
+    packet.u_body.stream.head_size = head_size;
+    return packet;
+}
+
 Packet make_packet(uint64_t control_code)
 {
     return make_enum_field_packet(control_code, 0);
@@ -19,6 +19,7 @@
 #define STDSC_PACKET_HPP
 
 #include <cstdint>
+#include <cstddef>
 #include <string>
 
 namespace stdsc
@@ -42,6 +43,8 @@ enum ControlCode_t : uint64_t
     kControlCodeFailed          = 0x0103,
     kControlCodeConnected       = 0x0104,
     kControlCodeDisConnected    = 0x0105,
+    kControlCodeCompression     = 0x0106, ///< negotiate compression
+    kControlCodeSharedMemory    = 0x0107, ///< negotiate memfd payloads
 
     /* Code for Request packet: 0x0200-0x02FF */
     kControlCodeGroupRequest    = 0x0200,
@@ -54,6 +57,9 @@ enum ControlCode_t : uint64_t
 
     /* Code for UpDownload packet: 0x1000-0x10FF */
     kControlCodeGroupUpDownload = 0x1000,
+
+    /* Code for Stream packet: 0x2000-0x20FF */
+    kControlCodeGroupStream     = 0x2000,
 };
 
 struct DataHeader
@@ -61,6 +67,24 @@ struct DataHeader
     uint64_t size;
 };
 
+struct StreamHeader
+{
+    uint64_t size;      ///< total payload size (head + file segments)
+    uint64_t head_size; ///< size of in-memory head
+};
+
+struct CompressionBody
+{
+    uint64_t codec;     ///< bitmask of Codec_t
+    uint64_t threshold; ///< payloads smaller than this are sent raw
+};
+
+struct SharedMemoryBody
+{
+    uint64_t enable;
+    uint64_t threshold; ///< smaller payloads are sent through the socket
+};
+
 struct FixedStringBody
 {
     char str[STDSC_FIXED_STRING_SIZE];
@@ -75,24 +99,80 @@ union Body
 {
     uint8_t padding[STDSC_PACKET_BODY_SIZE];
     DataHeader data;
+    StreamHeader stream;
+    CompressionBody compression;
+    SharedMemoryBody shared_memory;
     FixedStringBody fixed_string;
     EnumFieldBody enum_field;
 };
 
 /**
  * @brief This class is used to hold the packet data.
+ * Only `control_code` and `u_body` are sent with the legacy framing.
  */
 struct Packet
 {
     uint64_t control_code;
     Body u_body;
+    uint32_t request_id; ///< carried by the compact framing only
 
     Packet(void);
     Packet(uint64_t control_code_);
 };
 
+/**
+ * @brief Framing of packets on the wire.
+ * Compact: CompactHeader (40 bytes), used when the body fits in two words.
+ * Legacy : control code and the whole body (1032 bytes).
+ */
+enum Framing_t : uint32_t
+{
+    kFramingCompact = 0,
+    kFramingLegacy = 1,
+};
+
+static const uint32_t STDSC_COMPACT_MAGIC = 0x32435453; // "STC2"
+static const uint8_t STDSC_COMPACT_VERSION = 1;
+static const uint8_t STDSC_COMPACT_FLAG_PAYLOAD = 0x01; ///< payload follows
+static const uint8_t STDSC_COMPACT_FLAG_COMPRESSED = 0x02; ///< payload is compressed
+static const uint8_t STDSC_COMPACT_FLAG_SHM = 0x04; ///< payload is in passed memfd
+static const uint8_t STDSC_COMPACT_FLAG_FRAMED = 0x08; ///< compressed payload is in frames
+
+/**
+ * @brief Compact packet header. The magic never collides with the low
+ * bytes of a legacy packet, whose control codes are below 0x10000.
+ */
+struct CompactHeader
+{
+    uint32_t magic;
+    uint8_t version;
+    uint8_t flags;
+    uint16_t reserved;
+    uint32_t request_id;
+    uint32_t wire_size; ///< size of compressed payload, if compressed
+    uint64_t control_code;
+    uint64_t body[2]; ///< first two words of Body (e.g. data size)
+};
+
+/**
+ * @brief Header of a frame of a framed payload. Stream payloads are
+ * compressed in frames, so that the receiver inflates them as it reads.
+ */
+struct CompactFrameHeader
+{
+    uint32_t raw_size;  ///< size of the frame inflated
+    uint32_t wire_size; ///< size of the frame on the wire (raw_size: stored as is)
+};
+
+static const std::size_t STDSC_LEGACY_PACKET_SIZE =
+    sizeof(uint64_t) + STDSC_PACKET_BODY_SIZE;
+static const std::size_t STDSC_COMPACT_BODY_SIZE =
+    sizeof(CompactHeader::body);
+
 void initialize_packet(Packet& packet);
 Packet make_data_packet(uint64_t control_code, uint64_t size);
+Packet make_stream_packet(uint64_t control_code, uint64_t size,
+                          uint64_t head_size);
 Packet make_fixed_string_packet(const std::string string_);
 Packet make_fixed_string_packet(int32_t val);
 Packet make_packet(uint64_t control_code);
@@ -16,6 +16,7 @@
  */
 
 #include <unistd.h>
+#include <atomic>
 #include <memory>
 #include <limits>
 #include <vector>
@@ -27,6 +28,7 @@
 #include <stdsc/stdsc_callback_function_container.hpp>
 #include <stdsc/stdsc_buffer.hpp>
 #include <stdsc/stdsc_state.hpp>
+#include <stdsc/stdsc_compression.hpp>
 
 namespace stdsc
 {
@@ -46,13 +48,16 @@ struct Server<T>::Impl
     {
         ResourceContainer(Socket& sock,
                           StateContext& state,
-                          CallbackFunctionContainer& callback)
+                          CallbackFunctionContainer& callback,
+                          const uint32_t idle_timeout_sec)
             : sock_(sock),
               state_(state),        // copy
               callback_(callback),  // ref
               th_(new ServerThread<>(sock_, state_, callback)),
               is_released_(false)
-        {}
+        {
+            th_->set_idle_timeout(idle_timeout_sec);
+        }
 
         virtual ~ResourceContainer()
         {
@@ -64,6 +69,16 @@ struct Server<T>::Impl
             th_->start();
         }
 
+        void stop(void)
+        {
+            th_->stop();
+        }
+
+        bool is_finished(void) const
+        {
+            return th_->is_finished();
+        }
+
         void wait(void)
         {
             try
@@ -98,6 +113,9 @@ struct Server<T>::Impl
          StateContext& state,
          CallbackFunctionContainer& callback)
         : param_(),
+          max_connections_(STDSC_SERVER_MAX_CONNECTIONS),
+          idle_timeout_sec_(STDSC_TIME_INFINITE),
+          num_connections_(0),
           port_(port),
           state_(state),       // copy
           callback_(callback)  // copy
@@ -112,36 +130,91 @@ struct Server<T>::Impl
         STDSC_LOG_INFO("Listening socket for port %s.", port_);
 
         std::vector<std::shared_ptr<ResourceContainer>> resources;
+        bool is_full = false;
             
         while (!args.force_finish)
         {
+            reap(resources);
+
+            // further connections wait in the listen backlog
+            if (max_connections_ <= resources.size())
+            {
+                if (!is_full)
+                {
+                    STDSC_LOG_WARN("Reached max number of connections. (%lu)",
+                                   max_connections_);
+                    is_full = true;
+                }
+                sleep(STDSC_SERVER_POLL_INTERVAL_SEC);
+                continue;
+            }
+            is_full = false;
+
+            // wake up periodically to reap closed connections
+            if (!listen_socket.wait_readable(STDSC_SERVER_POLL_INTERVAL_SEC))
+            {
+                continue;
+            }
+
             try
             {
                 Socket sock = Socket::accept_connection(listen_socket);
                 
                 std::shared_ptr<ResourceContainer>
-                    rc(new ResourceContainer(sock, state_, callback_));
+                    rc(new ResourceContainer(sock, state_, callback_,
+                                             idle_timeout_sec_));
                 rc->invoke();
                 
                 resources.push_back(std::move(rc));
+                num_connections_ = resources.size();
             }
             catch (stdsc::SocketException& e)
             {}
         }
 
+        for (auto& r : resources)
+        {
+            r->stop();
+        }
         for (auto& r : resources)
         {
             r->wait();
             r->release();
         }
+        resources.clear();
+        num_connections_ = 0;
 
         listen_socket.close();
     }
 
+    /* release connections closed by the client or by idle timeout */
+    void reap(std::vector<std::shared_ptr<ResourceContainer>>& resources)
+    {
+        auto it = resources.begin();
+        while (it != resources.end())
+        {
+            if ((*it)->is_finished())
+            {
+                (*it)->wait();
+                (*it)->release();
+                it = resources.erase(it);
+            }
+            else
+            {
+                ++it;
+            }
+        }
+        num_connections_ = resources.size();
+    }
+
 public:
     std::shared_ptr<ThreadException> te_;
     ServerParam param_;
     
+    std::size_t max_connections_;
+    uint32_t idle_timeout_sec_;
+    std::atomic<std::size_t> num_connections_;
+
 private:
     const char* port_;
     StateContext state_;
@@ -178,6 +251,24 @@ void Server<T>::stop(void)
     pimpl_->param_.force_finish = true;
 }
 
+template <class T>
+void Server<T>::set_max_connections(const std::size_t max_connections)
+{
+    pimpl_->max_connections_ = (0 < max_connections) ? max_connections : 1;
+}
+
+template <class T>
+void Server<T>::set_idle_timeout(const uint32_t idle_timeout_sec)
+{
+    pimpl_->idle_timeout_sec_ = idle_timeout_sec;
+}
+
+template <class T>
+std::size_t Server<T>::num_connections(void) const
+{
+    return pimpl_->num_connections_;
+}
+
 template <class T>
 void Server<T>::wait(void)
 {
@@ -204,35 +295,90 @@ struct ServerThread<T>::Impl
          StateContext& state,
          CallbackFunctionContainer& callback)
         : param_(),
+          idle_timeout_sec_(STDSC_TIME_INFINITE),
+          is_finished_(false),
           sock_(sock),
           state_(state),      // ref
-          callback_(callback) // ref
+          callback_(callback), // ref
+          cdata_on_each_(callback.create_connection_data())
     {
         te_ = ThreadException::create();
     }
 
     void exec(T& args, std::shared_ptr<ThreadException> te)
+    {
+        run(args, te);
+        is_finished_ = true;
+    }
+
+    /* wait for next request; false if stopped or idle for too long */
+    bool wait_request(T& args)
+    {
+        uint32_t idle_sec = 0;
+        while (!args.force_finish)
+        {
+            if (sock_.wait_readable(STDSC_SERVER_POLL_INTERVAL_SEC))
+            {
+                if (sock_.peer_closed())
+                {
+                    STDSC_LOG_INFO("Connection closed by client.");
+                    return false;
+                }
+                return true;
+            }
+            idle_sec += STDSC_SERVER_POLL_INTERVAL_SEC;
+            if (STDSC_TIME_INFINITE != idle_timeout_sec_
+                && idle_timeout_sec_ <= idle_sec)
+            {
+                STDSC_LOG_INFO("Closing idle connection. (%u sec)", idle_sec);
+                return false;
+            }
+        }
+        return false;
+    }
+
+    void run(T& args, std::shared_ptr<ThreadException> te)
     {
         while (!args.force_finish)
         {
             try
             {
+                if (!wait_request(args))
+                {
+                    break;
+                }
+
                 Packet packet;
                 sock_.recv_packet(packet);
                 STDSC_LOG_TRACE("Received packet. (code:0x%08x)",
                                 packet.control_code);
 
+                if (kControlCodeCompression == packet.control_code)
+                {
+                    negotiate_compression(packet);
+                    continue;
+                }
+                if (kControlCodeSharedMemory == packet.control_code)
+                {
+                    negotiate_shared_memory(packet);
+                    continue;
+                }
+
                 try
                 {
-                    callback_.eval(sock_, packet, state_);
+                    callback_.eval(sock_, packet, state_, cdata_on_each_.get());
                     STDSC_LOG_TRACE("callback finished.");
-                    sock_.send_packet(make_packet(kControlCodeAccept));
+                    auto ack = make_packet(kControlCodeAccept);
+                    ack.request_id = packet.request_id;
+                    sock_.send_packet(ack);
                 }
                 catch (const CallbackException& e)
                 {
                     STDSC_LOG_TRACE(
                         "Failed to execute callback function. %s", e.what());
-                    sock_.send_packet(make_packet(kControlCodeReject));
+                    auto nack = make_packet(kControlCodeReject);
+                    nack.request_id = packet.request_id;
+                    sock_.send_packet(nack);
                 }
             }
             catch (const stdsc::AbstractException& e)
@@ -242,16 +388,62 @@ struct ServerThread<T>::Impl
                 break;
             }
         }
+
+        try
+        {
+            callback_.eval(sock_, make_packet(kControlCodeDisConnected), state_,
+                           cdata_on_each_.get());
+        }
+        catch (const stdsc::AbstractException& e)
+        {
+            STDSC_LOG_WARN("Failed to execute disconnect callback. %s", e.what());
+        }
+    }
+
+    void negotiate_compression(const Packet& packet)
+    {
+        // accept the codec requested by the client if this build has it
+        uint32_t codec = static_cast<uint32_t>(packet.u_body.compression.codec)
+                         & supported_codecs();
+        auto threshold = packet.u_body.compression.threshold;
+        sock_.set_compression(codec, threshold);
+        STDSC_LOG_INFO("Negotiated compression. (codec:0x%x, threshold:%lu)",
+                       codec, threshold);
+
+        auto ack = make_packet(kControlCodeAccept);
+        ack.request_id = packet.request_id;
+        ack.u_body.compression.codec = codec;
+        ack.u_body.compression.threshold = threshold;
+        sock_.send_packet(ack);
+    }
+
+    void negotiate_shared_memory(const Packet& packet)
+    {
+        // only possible if the client is on this host
+        auto threshold = packet.u_body.shared_memory.threshold;
+        sock_.set_shared_memory(0 != packet.u_body.shared_memory.enable,
+                                threshold);
+        STDSC_LOG_INFO("Negotiated shared memory. (enable:%d, threshold:%lu)",
+                       sock_.shared_memory(), threshold);
+
+        auto ack = make_packet(kControlCodeAccept);
+        ack.request_id = packet.request_id;
+        ack.u_body.shared_memory.enable = sock_.shared_memory() ? 1 : 0;
+        ack.u_body.shared_memory.threshold = threshold;
+        sock_.send_packet(ack);
     }
 
 public:
     std::shared_ptr<ThreadException> te_;
     ServerThreadParam param_;
+    uint32_t idle_timeout_sec_;
+    std::atomic<bool> is_finished_;
     
 private:
     Socket& sock_;
     StateContext& state_;
     CallbackFunctionContainer& callback_;
+    std::shared_ptr<void> cdata_on_each_; ///< destroyed with the connection
 };
 
 template <class T>
@@ -280,6 +472,18 @@ void ServerThread<T>::stop(void)
     pimpl_->param_.force_finish = true;
 }
 
+template <class T>
+void ServerThread<T>::set_idle_timeout(const uint32_t idle_timeout_sec)
+{
+    pimpl_->idle_timeout_sec_ = idle_timeout_sec;
+}
+
+template <class T>
+bool ServerThread<T>::is_finished(void) const
+{
+    return pimpl_->is_finished_;
+}
+
 template <class T>
 void ServerThread<T>::join(void)
 {
@@ -18,6 +18,8 @@
 #ifndef STDSC_SERVER_HPP
 #define STDSC_SERVER_HPP
 
+#include <cstddef>
+#include <cstdint>
 #include <memory>
 #include <stdsc/stdsc_thread.hpp>
 
@@ -46,6 +48,25 @@ public:
     void start(const bool async=false);
     void stop(void);
     void wait(void);
+
+    /**
+     * Set max number of connections. Further clients wait in the listen
+     * backlog until a connection is closed. Call this before start().
+     * @param[in] max_connections max number of connections
+     */
+    void set_max_connections(const std::size_t max_connections);
+
+    /**
+     * Close connections which send no request for a while.
+     * Call this before start().
+     * @param[in] idle_timeout_sec timeout (sec, STDSC_TIME_INFINITE: never)
+     */
+    void set_idle_timeout(const uint32_t idle_timeout_sec);
+
+    /**
+     * Number of open connections
+     */
+    std::size_t num_connections(void) const;
     
 private:
     virtual void exec(T& args, std::shared_ptr<ThreadException> te) const override;
@@ -78,6 +99,17 @@ public:
     void stop(void);
     void join(void);
 
+    /**
+     * Close the connection if no request arrives for idle_timeout_sec.
+     * @param[in] idle_timeout_sec timeout (sec, STDSC_TIME_INFINITE: never)
+     */
+    void set_idle_timeout(const uint32_t idle_timeout_sec);
+
+    /**
+     * Whether the connection was closed and the thread finished
+     */
+    bool is_finished(void) const;
+
 private:
     virtual void exec(T& args, std::shared_ptr<ThreadException> te) const override;
 
@@ -17,22 +17,34 @@
 
 #include <sys/types.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include <netinet/in.h>
 #include <netinet/tcp.h>
 #include <errno.h>
 #include <netdb.h>
 #include <unistd.h> // for fcntl
 #include <fcntl.h>  // for fcntl
+#if defined(__linux__)
+#include <sys/sendfile.h>
+#endif
 
 #include <cstdint>
 #include <climits>
 #include <cstring>
+#include <vector>
+#include <deque>
+#include <string>
+#include <algorithm>
 
 #include <stdsc/stdsc_socket.hpp>
 #include <stdsc/stdsc_exception.hpp>
 #include <stdsc/stdsc_log.hpp>
 #include <stdsc/stdsc_packet.hpp>
 #include <stdsc/stdsc_buffer.hpp>
+#include <stdsc/stdsc_compression.hpp>
 
 static constexpr int INVALID_SOCKET = -1;
 static constexpr int SOCKET_ERROR = -1;
@@ -114,6 +126,73 @@ static void make_blocking(int socket)
                     "Failed to make socket blocking using ioctlsocket");
 }
 
+static void set_tcp_options(int socket)
+{
+    int ret;
+    int onoff = 1;
+    int keepalivedelay_sec = KEEPALIVEDELAY_SEC;
+    int keepaliveinterval_sec = KEEPINTERVALTIME_SEC;
+    int keepalivecount = KEEPALIVECOUNT;
+
+    /* set nodelay option */
+    ret = setsockopt(socket, IPPROTO_TCP, TCP_NODELAY,
+                     reinterpret_cast<const char*>(&onoff), sizeof(onoff));
+    SOCKET_IF_CHECK_CLOSE(SOCKET_ERROR != ret, "Failed to setsockopt", socket);
+
+    /* set packet buffer size */
+    int buf_size = STDSC_TCP_BUFFER_SIZE;
+
+    ret =
+      setsockopt(socket, SOL_SOCKET, SO_RCVBUF,
+                 reinterpret_cast<const char*>(&buf_size), sizeof(buf_size));
+    SOCKET_IF_CHECK_CLOSE(SOCKET_ERROR != ret, "Failed to setsockopt", socket);
+
+    ret =
+      setsockopt(socket, SOL_SOCKET, SO_SNDBUF,
+                 reinterpret_cast<const char*>(&buf_size), sizeof(buf_size));
+    SOCKET_IF_CHECK_CLOSE(SOCKET_ERROR != ret, "Failed to setsockopt", socket);
+
+    /* set keepalive values */
+    ret = setsockopt(socket, SOL_SOCKET, SO_KEEPALIVE,
+                     reinterpret_cast<const char*>(&onoff), sizeof(onoff));
+    SOCKET_IF_CHECK_CLOSE(SOCKET_ERROR != ret, "Failed to setsockopt", socket);
+
+    ret = setsockopt(socket, IPPROTO_TCP, TCP_KEEPIDLE,
+                     reinterpret_cast<const char*>(&keepalivedelay_sec),
+                     sizeof(keepalivedelay_sec));
+    SOCKET_IF_CHECK_CLOSE(SOCKET_ERROR != ret, "Failed to setsockopt", socket);
+
+    ret = setsockopt(socket, IPPROTO_TCP, TCP_KEEPINTVL,
+                     reinterpret_cast<const char*>(&keepaliveinterval_sec),
+                     sizeof(keepaliveinterval_sec));
+    SOCKET_IF_CHECK_CLOSE(SOCKET_ERROR != ret, "Failed to setsockopt", socket);
+    ret = setsockopt(socket, IPPROTO_TCP, TCP_KEEPCNT,
+                     reinterpret_cast<const char*>(&keepalivecount),
+                     sizeof(keepalivecount));
+    SOCKET_IF_CHECK_CLOSE(SOCKET_ERROR != ret, "Failed to setsockopt", socket);
+}
+
+/* "unix:<path>" endpoint to path, false if not a unix-domain endpoint */
+static bool parse_unix_endpoint(const char* endpoint, std::string& path)
+{
+    static const char prefix[] = "unix:";
+    static const std::size_t prefix_len = sizeof(prefix) - 1;
+    if (endpoint && 0 == std::strncmp(endpoint, prefix, prefix_len))
+    {
+        path = endpoint + prefix_len;
+        return true;
+    }
+    return false;
+}
+
+static void make_unix_addr(const std::string& path, sockaddr_un& sa)
+{
+    STDSC_IF_CHECK(path.size() < sizeof(sa.sun_path), "too long socket path");
+    std::memset(&sa, 0, sizeof(sa));
+    sa.sun_family = AF_UNIX;
+    std::strncpy(sa.sun_path, path.c_str(), sizeof(sa.sun_path) - 1);
+}
+
 static bool wait_write(int socket, uint32_t timeout_sec)
 {
     STDSC_LOG_TRACE("wait write : %u : 0x%x", timeout_sec, socket);
@@ -180,9 +259,118 @@ static bool wait_read(int socket, uint32_t timeout_sec)
     return true;
 }
 
+/* closes fd when leaving the scope */
+struct ScopedFd
+{
+    explicit ScopedFd(int fd = -1) : fd_(fd)
+    {
+    }
+    ~ScopedFd()
+    {
+        if (0 <= fd_)
+        {
+            ::close(fd_);
+        }
+    }
+    ScopedFd(const ScopedFd&) = delete;
+    ScopedFd& operator=(const ScopedFd&) = delete;
+
+    int fd_;
+};
+
+static void write_fd(int fd, const char* ptr, std::size_t bytes)
+{
+    while (0 < bytes)
+    {
+        ssize_t ret = ::write(fd, ptr, bytes);
+        STDSC_THROW_FILE_IF_CHECK(0 <= ret, "Failed to write file");
+        ptr += ret;
+        bytes -= ret;
+    }
+}
+
+/* connection state shared by the copies of a socket */
+struct SocketShared
+{
+    std::size_t recv_bytes = 0;
+    Framing_t framing = kFramingCompact;
+    uint32_t peer_request_id = 0; ///< request ID of the last received packet
+    uint32_t codec = kCodecNone;  ///< negotiated codec
+    std::size_t threshold = STDSC_COMPRESSION_THRESHOLD;
+    Buffer pending;               ///< decompressed payload not read yet
+    std::size_t pending_pos = 0;
+    std::size_t framed_remain = 0; ///< inflated bytes of frames still on the socket
+    bool shm = false;             ///< pass large payloads by memfd
+    std::size_t shm_threshold = STDSC_SHM_THRESHOLD;
+    std::deque<int> fds;          ///< descriptors received, not used yet
+
+    ~SocketShared()
+    {
+        for (auto fd : fds)
+        {
+            ::close(fd);
+        }
+    }
+};
+
+static bool shared_memory_supported(void)
+{
+#if defined(__linux__) && defined(MFD_CLOEXEC)
+    return true;
+#else
+    return false;
+#endif
+}
+
+/* compresses a stream payload in frames, so that the receiver inflates
+   them one at a time. false if the frames are not smaller than the payload */
+static bool compress_frames(const uint32_t codec, const void* src,
+                            const std::size_t size, Buffer& dst)
+{
+    const auto frame_size = static_cast<std::size_t>(STDSC_COMPRESSION_FRAME_SIZE);
+    const auto num_frames = (size + frame_size - 1) / frame_size;
+
+    // a frame that does not get smaller is stored as is, so the frames
+    // never take more than this
+    dst.resize(num_frames * sizeof(CompactFrameHeader) + size);
+    char* out = static_cast<char*>(dst.data());
+    std::size_t wire = 0;
+    Buffer compressed;
+    for (std::size_t pos = 0; pos < size; pos += frame_size)
+    {
+        CompactFrameHeader frame;
+        frame.raw_size = static_cast<uint32_t>(std::min(size - pos, frame_size));
+        frame.wire_size = frame.raw_size;
+        const char* data = static_cast<const char*>(src) + pos;
+        if (compress(codec, data, frame.raw_size, compressed))
+        {
+            frame.wire_size = static_cast<uint32_t>(compressed.size());
+            data = static_cast<const char*>(compressed.data());
+        }
+        std::memcpy(out + wire, &frame, sizeof(frame));
+        wire += sizeof(frame);
+        std::memcpy(out + wire, data, frame.wire_size);
+        wire += frame.wire_size;
+    }
+    if (size <= wire)
+    {
+        return false;
+    }
+    dst.resize(wire);
+    return true;
+}
+
+static bool fits_compact(const Packet& packet)
+{
+    const auto* p = packet.u_body.padding;
+    return std::all_of(p + STDSC_COMPACT_BODY_SIZE, p + STDSC_PACKET_BODY_SIZE,
+                       [](uint8_t c) { return 0 == c; });
+}
+
 struct Socket::Impl
 {
-    Impl() : socket_(INVALID_SOCKET)
+    Impl()
+        : socket_(INVALID_SOCKET), is_local_(false), shared_(new SocketShared())
     {
     }
     ~Impl()
@@ -197,7 +385,7 @@ struct Socket::Impl
 
         while (0 < remain)
         {
-            int ret = ::recv(socket_, ptr, remain, 0);
+            auto ret = recv_some(ptr, remain);
             SOCKET_IF_CHECK(SOCKET_ERROR != ret, "Failed to receive");
             SOCKET_IF_CHECK(SOCKET_CLOSED != ret, "Socket closed");
             ptr += ret;
@@ -205,6 +393,56 @@ struct Socket::Impl
         }
     }
 
+    /* recv(2), keeping descriptors passed on unix-domain sockets */
+    ssize_t recv_some(char* ptr, std::size_t bytes) const
+    {
+        if (!is_local_)
+        {
+            return ::recv(socket_, ptr, bytes, 0);
+        }
+
+        struct iovec iov;
+        iov.iov_base = ptr;
+        iov.iov_len = bytes;
+        char control[CMSG_SPACE(sizeof(int))];
+        struct msghdr msg;
+        std::memset(&msg, 0, sizeof(msg));
+        msg.msg_iov = &iov;
+        msg.msg_iovlen = 1;
+        msg.msg_control = control;
+        msg.msg_controllen = sizeof(control);
+
+        ssize_t ret = ::recvmsg(socket_, &msg, MSG_CMSG_CLOEXEC);
+        bool truncated = (0 < ret) && (msg.msg_flags & MSG_CTRUNC);
+        for (auto* cmsg = CMSG_FIRSTHDR(&msg); cmsg;
+             cmsg = CMSG_NXTHDR(&msg, cmsg))
+        {
+            if (SOL_SOCKET != cmsg->cmsg_level || SCM_RIGHTS != cmsg->cmsg_type)
+            {
+                continue;
+            }
+            auto num = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+            for (std::size_t i = 0; i < num; ++i)
+            {
+                int fd;
+                std::memcpy(&fd, CMSG_DATA(cmsg) + i * sizeof(fd), sizeof(fd));
+                // one payload descriptor at a time, and only if negotiated
+                if (!truncated && shared_->shm && shared_->fds.empty())
+                {
+                    shared_->fds.push_back(fd);
+                }
+                else
+                {
+                    STDSC_LOG_WARN("Closed unexpected descriptor from peer.");
+                    ::close(fd);
+                }
+            }
+        }
+        STDSC_THROW_SOCKET_IF_CHECK(!truncated,
+                                    "Descriptors from peer were truncated");
+        return ret;
+    }
+
     void write(const void* buffer, std::size_t bytes) const
     {
         STDSC_LOG_DEBUG("write : 0x%x", socket_);
@@ -221,7 +459,449 @@ struct Socket::Impl
         }
     }
 
+    /* fd, if any, is passed along with the first byte */
+    void writev(struct iovec* iov, int iovcnt, int fd = -1) const
+    {
+        STDSC_LOG_DEBUG("writev : 0x%x", socket_);
+        char control[CMSG_SPACE(sizeof(int))];
+        while (0 < iovcnt)
+        {
+            struct msghdr msg;
+            std::memset(&msg, 0, sizeof(msg));
+            msg.msg_iov = iov;
+            msg.msg_iovlen = iovcnt;
+            if (0 <= fd)
+            {
+                std::memset(control, 0, sizeof(control));
+                msg.msg_control = control;
+                msg.msg_controllen = sizeof(control);
+                auto* cmsg = CMSG_FIRSTHDR(&msg);
+                cmsg->cmsg_level = SOL_SOCKET;
+                cmsg->cmsg_type = SCM_RIGHTS;
+                cmsg->cmsg_len = CMSG_LEN(sizeof(fd));
+                std::memcpy(CMSG_DATA(cmsg), &fd, sizeof(fd));
+                fd = -1;
+            }
+
+            ssize_t ret = ::sendmsg(socket_, &msg, 0);
+            SOCKET_IF_CHECK(SOCKET_ERROR != ret, "Failed to send");
+
+            std::size_t sent = static_cast<std::size_t>(ret);
+            while (0 < iovcnt && iov->iov_len <= sent)
+            {
+                sent -= iov->iov_len;
+                ++iov;
+                --iovcnt;
+            }
+            if (0 < iovcnt)
+            {
+                iov->iov_base = static_cast<char*>(iov->iov_base) + sent;
+                iov->iov_len -= sent;
+            }
+        }
+    }
+
+    void send_packet(const Packet& packet, const void* payload,
+                     std::size_t size) const
+    {
+        CompactHeader header;
+        struct iovec iov[2];
+        int iovcnt = 0;
+        Buffer compressed;
+        ScopedFd shm;
+
+        if (kFramingCompact == shared_->framing && fits_compact(packet))
+        {
+            std::memset(&header, 0, sizeof(header));
+            header.magic = STDSC_COMPACT_MAGIC;
+            header.version = STDSC_COMPACT_VERSION;
+            header.flags = (0 < size) ? STDSC_COMPACT_FLAG_PAYLOAD : 0;
+
+            // large payloads to a co-located peer are passed in a memfd,
+            // only the descriptor goes through the socket
+            if (shared_->shm && shared_->shm_threshold <= size
+                && packet.u_body.data.size == size)
+            {
+                shm.fd_ = create_shm(payload, size);
+            }
+
+            if (0 <= shm.fd_)
+            {
+                header.flags |= STDSC_COMPACT_FLAG_SHM;
+                STDSC_LOG_TRACE("passed payload by memfd. (%lu)", size);
+                size = 0;
+            }
+            // compress only whole payloads, i.e. not the head of a stream
+            // followed by files. streams are compressed in frames, as the
+            // receiver reads them in windows
+            else if (kCodecNone != shared_->codec && shared_->threshold <= size
+                && packet.u_body.data.size == size)
+            {
+                bool framed = (packet.control_code & kControlCodeGroupStream);
+                if (framed)
+                {
+                    if (compress_frames(shared_->codec, payload, size, compressed))
+                    {
+                        header.flags |= STDSC_COMPACT_FLAG_COMPRESSED
+                                        | STDSC_COMPACT_FLAG_FRAMED;
+                        STDSC_LOG_TRACE("compressed payload in frames. (%lu -> %lu)",
+                                        size, compressed.size());
+                        payload = compressed.data();
+                        size = compressed.size();
+                    }
+                }
+                else if (compress(shared_->codec, payload, size, compressed)
+                         && compressed.size() <= UINT32_MAX)
+                {
+                    header.flags |= STDSC_COMPACT_FLAG_COMPRESSED;
+                    header.wire_size = static_cast<uint32_t>(compressed.size());
+                    STDSC_LOG_TRACE("compressed payload. (%lu -> %lu)", size,
+                                    compressed.size());
+                    payload = compressed.data();
+                    size = compressed.size();
+                }
+            }
+
+            header.request_id = (0 != packet.request_id)
+                                  ? packet.request_id
+                                  : shared_->peer_request_id;
+            header.control_code = packet.control_code;
+            std::memcpy(header.body, packet.u_body.padding, sizeof(header.body));
+            iov[iovcnt].iov_base = &header;
+            iov[iovcnt].iov_len = sizeof(header);
+        }
+        else
+        {
+            iov[iovcnt].iov_base = const_cast<Packet*>(&packet);
+            iov[iovcnt].iov_len = STDSC_LEGACY_PACKET_SIZE;
+        }
+        ++iovcnt;
+
+        if (0 < size)
+        {
+            iov[iovcnt].iov_base = const_cast<void*>(payload);
+            iov[iovcnt].iov_len = size;
+            ++iovcnt;
+        }
+
+        writev(iov, iovcnt, shm.fd_);
+    }
+
+    /* sealed memfd holding payload, -1 if not available */
+    static int create_shm(const void* payload, std::size_t size)
+    {
+#if defined(__linux__) && defined(MFD_CLOEXEC) && defined(F_SEAL_WRITE)
+        int fd = ::memfd_create("stdsc", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+        if (0 <= fd)
+        {
+            try
+            {
+                write_fd(fd, static_cast<const char*>(payload), size);
+            }
+            catch (const AbstractException& e)
+            {
+                ::close(fd);
+                return -1;
+            }
+            // the receiver maps the payload, it must not change under it
+            if (0 != ::fcntl(fd, F_ADD_SEALS, F_SEAL_WRITE | F_SEAL_SHRINK
+                                                  | F_SEAL_GROW | F_SEAL_SEAL))
+            {
+                ::close(fd);
+                return -1;
+            }
+        }
+        return fd;
+#else
+        return -1;
+#endif
+    }
+
+    void recv_packet(Packet& packet) const
+    {
+        uint32_t magic;
+        read(&magic, sizeof(magic));
+
+        if (STDSC_COMPACT_MAGIC == magic)
+        {
+            CompactHeader header;
+            header.magic = magic;
+            read(reinterpret_cast<char*>(&header) + sizeof(magic),
+                 sizeof(header) - sizeof(magic));
+            SOCKET_IF_CHECK(STDSC_COMPACT_VERSION == header.version,
+                            "Unsupported packet version");
+            packet.control_code = header.control_code;
+            packet.request_id = header.request_id;
+            std::memcpy(packet.u_body.padding, header.body, sizeof(header.body));
+
+            if (header.flags & STDSC_COMPACT_FLAG_SHM)
+            {
+                // the payload is in the memfd passed with the header
+                STDSC_THROW_SOCKET_IF_CHECK(!shared_->fds.empty(),
+                                            "Descriptor of payload is missing");
+                ScopedFd fd(shared_->fds.front());
+                shared_->fds.pop_front();
+                shared_->pending = map_shm(
+                  fd.fd_, static_cast<std::size_t>(packet.u_body.data.size));
+                shared_->pending_pos = 0;
+            }
+            else if ((header.flags & STDSC_COMPACT_FLAG_COMPRESSED)
+                     && (header.flags & STDSC_COMPACT_FLAG_FRAMED))
+            {
+                // the frames are inflated as the payload is read
+                STDSC_THROW_SOCKET_IF_CHECK(kCodecNone != shared_->codec,
+                                            "Compression is not negotiated");
+                shared_->framed_remain =
+                  static_cast<std::size_t>(packet.u_body.data.size);
+            }
+            else if (header.flags & STDSC_COMPACT_FLAG_COMPRESSED)
+            {
+                // inflate the payload now, it is served to the following
+                // recv_buffer / recv_file calls
+                STDSC_THROW_SOCKET_IF_CHECK(kCodecNone != shared_->codec,
+                                            "Compression is not negotiated");
+                Buffer wire(header.wire_size);
+                read(wire.data(), wire.size());
+                Buffer pending(static_cast<std::size_t>(packet.u_body.data.size));
+                decompress(shared_->codec, wire.data(), wire.size(),
+                           pending.data(), pending.size());
+                shared_->pending = std::move(pending);
+                shared_->pending_pos = 0;
+            }
+
+            // a descriptor not announced by the header is not used
+            while (!shared_->fds.empty())
+            {
+                ::close(shared_->fds.front());
+                shared_->fds.pop_front();
+            }
+        }
+        else
+        {
+            char raw[STDSC_LEGACY_PACKET_SIZE];
+            std::memcpy(raw, &magic, sizeof(magic));
+            read(raw + sizeof(magic), sizeof(raw) - sizeof(magic));
+            std::memcpy(&packet.control_code, raw, sizeof(packet.control_code));
+            std::memcpy(packet.u_body.padding, raw + sizeof(packet.control_code),
+                        STDSC_PACKET_BODY_SIZE);
+            // answer the peer in its framing
+            shared_->framing = kFramingLegacy;
+        }
+
+        shared_->peer_request_id = packet.request_id;
+    }
+
+    std::size_t pending(void) const
+    {
+        return shared_->pending.size() - shared_->pending_pos;
+    }
+
+    const char* pending_data(void) const
+    {
+        return static_cast<const char*>(shared_->pending.data())
+               + shared_->pending_pos;
+    }
+
+    void consume_pending(std::size_t bytes) const
+    {
+        STDSC_THROW_SOCKET_IF_CHECK(bytes <= pending(),
+                                    "Read beyond the received payload");
+        shared_->pending_pos += bytes;
+        if (0 == pending())
+        {
+            shared_->pending.release();
+            shared_->pending_pos = 0;
+        }
+    }
+
+    /* bytes of the received payload served from memory, not read yet */
+    std::size_t payload_remain(void) const
+    {
+        return pending() + shared_->framed_remain;
+    }
+
+    /* passes the received payload to func in pieces, inflating the
+       following frames as they are needed */
+    template <class F>
+    void consume_payload(std::size_t bytes, F func) const
+    {
+        STDSC_THROW_SOCKET_IF_CHECK(bytes <= payload_remain(),
+                                    "Read beyond the received payload");
+        while (0 < bytes)
+        {
+            if (0 == pending())
+            {
+                inflate_frame();
+            }
+            auto len = std::min(bytes, pending());
+            func(pending_data(), len);
+            consume_pending(len);
+            bytes -= len;
+        }
+    }
+
+    /* reads the next frame of a framed payload into pending */
+    void inflate_frame(void) const
+    {
+        CompactFrameHeader frame;
+        read(&frame, sizeof(frame));
+        STDSC_THROW_SOCKET_IF_CHECK(
+          0 < frame.raw_size && frame.raw_size <= shared_->framed_remain
+            && frame.wire_size <= frame.raw_size,
+          "Broken frame of payload");
+
+        Buffer pending(frame.raw_size);
+        if (frame.wire_size == frame.raw_size)
+        {
+            read(pending.data(), pending.size());
+        }
+        else
+        {
+            Buffer wire(frame.wire_size);
+            read(wire.data(), wire.size());
+            decompress(shared_->codec, wire.data(), wire.size(),
+                       pending.data(), pending.size());
+        }
+        shared_->pending = std::move(pending);
+        shared_->pending_pos = 0;
+        shared_->framed_remain -= frame.raw_size;
+    }
+
+    void send_file(int fd, std::size_t bytes) const
+    {
+        STDSC_LOG_DEBUG("send file : 0x%x", socket_);
+        off_t offset = 0;
+        std::size_t remain = bytes;
+
+#if defined(__linux__)
+        while (0 < remain)
+        {
+            ssize_t ret = ::sendfile(socket_, fd, &offset, remain);
+            if (SOCKET_ERROR == ret && (EINVAL == errno || ENOSYS == errno)
+                && 0 == offset)
+            {
+                break; // not supported for this fd, use the copy path
+            }
+            SOCKET_IF_CHECK(SOCKET_ERROR != ret, "Failed to send file");
+            SOCKET_IF_CHECK(0 != ret, "File was truncated while sending");
+            remain -= ret;
+        }
+#endif
+
+        std::vector<char> chunk(std::min<std::size_t>(remain, STDSC_FILE_CHUNK_SIZE));
+        while (0 < remain)
+        {
+            auto len = std::min(remain, chunk.size());
+            ssize_t ret = ::pread(fd, chunk.data(), len, offset);
+            STDSC_THROW_FILE_IF_CHECK(0 < ret, "Failed to read file");
+            write(chunk.data(), ret);
+            offset += ret;
+            remain -= ret;
+        }
+    }
+
+    void recv_file(int fd, std::size_t bytes) const
+    {
+        STDSC_LOG_DEBUG("recv file : 0x%x", socket_);
+        std::size_t remain = bytes;
+
+#if defined(__linux__)
+        /* socket -> pipe -> file, the payload never enters user space */
+        int pipefd[2] = {-1, -1};
+        bool spliceable = (0 == ::pipe(pipefd));
+        ScopedFd rfd(pipefd[0]), wfd(pipefd[1]);
+        const unsigned int flags = SPLICE_F_MOVE | SPLICE_F_MORE;
+
+        while (spliceable && 0 < remain)
+        {
+            auto len = std::min<std::size_t>(remain, STDSC_FILE_CHUNK_SIZE);
+            ssize_t ret = ::splice(socket_, NULL, wfd.fd_, NULL, len, flags);
+            if (SOCKET_ERROR == ret && (EINVAL == errno || ENOSYS == errno)
+                && bytes == remain)
+            {
+                spliceable = false; // not supported, use the copy path
+                break;
+            }
+            SOCKET_IF_CHECK(SOCKET_ERROR != ret, "Failed to receive");
+            SOCKET_IF_CHECK(SOCKET_CLOSED != ret, "Socket closed");
+            remain -= ret;
+
+            ssize_t inpipe = ret;
+            while (0 < inpipe)
+            {
+                ssize_t n = ::splice(rfd.fd_, NULL, fd, NULL, inpipe, flags);
+                if (0 > n && EINVAL == errno)
+                {
+                    // destination does not support splice, drain the pipe
+                    // by hand and continue with the copy path
+                    std::vector<char> chunk(inpipe);
+                    read_fd(rfd.fd_, chunk.data(), inpipe);
+                    write_fd(fd, chunk.data(), inpipe);
+                    spliceable = false;
+                    break;
+                }
+                STDSC_THROW_FILE_IF_CHECK(0 < n, "Failed to write file");
+                inpipe -= n;
+            }
+        }
+#endif
+
+        std::vector<char> chunk(std::min<std::size_t>(remain, STDSC_FILE_CHUNK_SIZE));
+        while (0 < remain)
+        {
+            auto len = std::min(remain, chunk.size());
+            read(chunk.data(), len);
+            write_fd(fd, chunk.data(), len);
+            remain -= len;
+        }
+    }
+
     int socket_;
+    bool is_local_;          ///< unix-domain socket
+    std::string unix_path_;  ///< path to unlink on close (listening socket)
+    std::shared_ptr<SocketShared> shared_;
+
+private:
+    /* maps the sealed memfd, the buffer unmaps it on release */
+    static Buffer map_shm(int fd, std::size_t bytes)
+    {
+#if defined(__linux__) && defined(F_SEAL_WRITE)
+        int seals = ::fcntl(fd, F_GET_SEALS);
+        STDSC_THROW_SOCKET_IF_CHECK(
+          0 <= seals && (seals & F_SEAL_WRITE) && (seals & F_SEAL_SHRINK),
+          "Descriptor of payload is not sealed");
+        struct stat st;
+        STDSC_THROW_SOCKET_IF_CHECK(
+          0 == ::fstat(fd, &st) && bytes <= static_cast<std::size_t>(st.st_size),
+          "Descriptor of payload is too small");
+        if (0 == bytes)
+        {
+            return Buffer();
+        }
+        // private mapping: the contents cannot change, and writes made by
+        // the receiver through the buffer stay local
+        void* p = ::mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE,
+                         fd, 0);
+        STDSC_THROW_SOCKET_IF_CHECK(MAP_FAILED != p, "Failed to map payload");
+        return Buffer(p, bytes, [](void* data, std::size_t size) {
+            ::munmap(data, size);
+        });
+#else
+        STDSC_THROW_SOCKET("Passing payload by descriptor is not supported");
+        return Buffer();
+#endif
+    }
+
+    static void read_fd(int fd, char* ptr, std::size_t bytes)
+    {
+        while (0 < bytes)
+        {
+            ssize_t ret = ::read(fd, ptr, bytes);
+            STDSC_THROW_FILE_IF_CHECK(0 < ret, "Failed to read pipe");
+            ptr += ret;
+            bytes -= ret;
+        }
+    }
 };
 
 Socket::Socket(void) : pimpl_(new Impl())
@@ -246,8 +926,78 @@ Socket::~Socket(void)
 {
 }
 
+Socket Socket::make_local_listen_socket(const std::string& path, int backlog)
+{
+    int ret;
+
+    sockaddr_un sa;
+    make_unix_addr(path, sa);
+
+    int listen_socket = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    SOCKET_IF_CHECK(INVALID_SOCKET != listen_socket, "Failed to create socket");
+
+    // remove the socket file left by a previous run, but nothing else:
+    // only a socket nobody listens on any more
+    struct stat st;
+    if (0 == ::lstat(path.c_str(), &st) && S_ISSOCK(st.st_mode))
+    {
+        int probe = ::socket(AF_UNIX, SOCK_STREAM, 0);
+        if (INVALID_SOCKET != probe)
+        {
+            ret = ::connect(probe, reinterpret_cast<sockaddr*>(&sa), sizeof(sa));
+            bool stale = (SOCKET_ERROR == ret && ECONNREFUSED == errno);
+            ::close(probe);
+            if (stale)
+            {
+                STDSC_LOG_INFO("Removed stale socket file. (%s)", path.c_str());
+                ::unlink(path.c_str());
+            }
+        }
+    }
+
+    ret = ::bind(listen_socket, reinterpret_cast<sockaddr*>(&sa), sizeof(sa));
+    SOCKET_IF_CHECK_CLOSE(SOCKET_ERROR != ret, "Failed to bind", listen_socket);
+
+    ret = ::listen(listen_socket, backlog);
+    SOCKET_IF_CHECK_CLOSE(SOCKET_ERROR != ret, "Failed to listen",
+                          listen_socket);
+
+    Socket socket;
+    socket.pimpl_->socket_ = listen_socket;
+    socket.pimpl_->is_local_ = true;
+    socket.pimpl_->unix_path_ = path;
+
+    return socket;
+}
+
+Socket Socket::establish_local_connection(const std::string& path)
+{
+    sockaddr_un sa;
+    make_unix_addr(path, sa);
+
+    int socket = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    SOCKET_IF_CHECK(SOCKET_ERROR != socket, "Failed to create socket");
+
+    int ret =
+      ::connect(socket, reinterpret_cast<sockaddr*>(&sa), sizeof(sa));
+    SOCKET_IF_CHECK_CLOSE(SOCKET_ERROR != ret, "Failed to connect", socket);
+
+    STDSC_LOG_DEBUG("Connected to %s", path.c_str());
+
+    Socket connected_socket;
+    connected_socket.pimpl_->socket_ = socket;
+    connected_socket.pimpl_->is_local_ = true;
+    return connected_socket;
+}
+
 Socket Socket::make_listen_socket(const char* port, int optname, int backlog)
 {
+    std::string path;
+    if (parse_unix_endpoint(port, path))
+    {
+        return make_local_listen_socket(path, backlog);
+    }
+
     int ret;
     int onoff = 1;
 
@@ -283,12 +1033,6 @@ Socket Socket::make_listen_socket(const char* port, int optname, int backlog)
 
 Socket Socket::accept_connection(Socket& listen_sock, uint32_t timeout_sec)
 {
-    int ret;
-    int onoff = 1;
-    int keepalivedelay_sec = KEEPALIVEDELAY_SEC;
-    int keepaliveinterval_sec = KEEPINTERVALTIME_SEC;
-    int keepalivecount = KEEPALIVECOUNT;
-
     int listen_socket = listen_sock.pimpl_->socket_;
     STDSC_LOG_TRACE("accept connection : 0x%x", listen_socket);
 
@@ -299,7 +1043,7 @@ Socket Socket::accept_connection(Socket& listen_sock, uint32_t timeout_sec)
     STDSC_LOG_DEBUG("wait_read.");
 
     /* accept */
-    sockaddr_in client;
+    sockaddr_storage client;
     socklen_t addr_len = sizeof(client);
     int socket =
       ::accept(listen_socket, reinterpret_cast<sockaddr*>(&client), &addr_len);
@@ -307,47 +1051,17 @@ Socket Socket::accept_connection(Socket& listen_sock, uint32_t timeout_sec)
 
     STDSC_LOG_DEBUG("accepted.");
 
-    /* set nodelay option */
-    ret = setsockopt(socket, IPPROTO_TCP, TCP_NODELAY,
-                     reinterpret_cast<const char*>(&onoff), sizeof(onoff));
-    SOCKET_IF_CHECK_CLOSE(SOCKET_ERROR != ret, "Failed to setsockopt", socket);
-
-    /* set packet buffer size */
-    int buf_size = STDSC_TCP_BUFFER_SIZE;
-
-    ret =
-      setsockopt(socket, SOL_SOCKET, SO_RCVBUF,
-                 reinterpret_cast<const char*>(&buf_size), sizeof(buf_size));
-    SOCKET_IF_CHECK_CLOSE(SOCKET_ERROR != ret, "Failed to setsockopt", socket);
-
-    ret =
-      setsockopt(socket, SOL_SOCKET, SO_SNDBUF,
-                 reinterpret_cast<const char*>(&buf_size), sizeof(buf_size));
-    SOCKET_IF_CHECK_CLOSE(SOCKET_ERROR != ret, "Failed to setsockopt", socket);
-
-    /* set keepalive values */
-    ret = setsockopt(socket, SOL_SOCKET, SO_KEEPALIVE,
-                     reinterpret_cast<const char*>(&onoff), sizeof(onoff));
-    SOCKET_IF_CHECK_CLOSE(SOCKET_ERROR != ret, "Failed to setsockopt", socket);
-
-    ret = setsockopt(socket, IPPROTO_TCP, TCP_KEEPIDLE,
-                     reinterpret_cast<const char*>(&keepalivedelay_sec),
-                     sizeof(keepalivedelay_sec));
-    SOCKET_IF_CHECK_CLOSE(SOCKET_ERROR != ret, "Failed to setsockopt", socket);
-
-    ret = setsockopt(socket, IPPROTO_TCP, TCP_KEEPINTVL,
-                     reinterpret_cast<const char*>(&keepaliveinterval_sec),
-                     sizeof(keepaliveinterval_sec));
-    SOCKET_IF_CHECK_CLOSE(SOCKET_ERROR != ret, "Failed to setsockopt", socket);
-    ret = setsockopt(socket, IPPROTO_TCP, TCP_KEEPCNT,
-                     reinterpret_cast<const char*>(&keepalivecount),
-                     sizeof(keepalivecount));
-    SOCKET_IF_CHECK_CLOSE(SOCKET_ERROR != ret, "Failed to setsockopt", socket);
+    /* TCP options */
+    if (!listen_sock.pimpl_->is_local_)
+    {
+        set_tcp_options(socket);
+    }
 
     STDSC_LOG_DEBUG("setsocketopt.");
 
     Socket accept_socket;
     accept_socket.pimpl_->socket_ = socket;
+    accept_socket.pimpl_->is_local_ = listen_sock.pimpl_->is_local_;
     return accept_socket;
 }
 
@@ -357,10 +1071,12 @@ Socket Socket::establish_connection(const char* host, const char* port,
     STDSC_LOG_TRACE("establish connection");
 
     int ret;
-    int onoff = 1;
-    int keepalivedelay_sec = KEEPALIVEDELAY_SEC;
-    int keepaliveinterval_sec = KEEPINTERVALTIME_SEC;
-    int keepalivecount = KEEPALIVECOUNT;
+
+    std::string path;
+    if (parse_unix_endpoint(host, path) || parse_unix_endpoint(port, path))
+    {
+        return establish_local_connection(path);
+    }
 
     uint32_t uint32_port = atoi(port);
     STDSC_IF_CHECK(uint32_port <= USHRT_MAX, "invalid port number");
@@ -369,42 +1085,7 @@ Socket Socket::establish_connection(const char* host, const char* port,
     int socket = ::socket(AF_INET, SOCK_STREAM, 0);
     SOCKET_IF_CHECK(SOCKET_ERROR != socket, "Failed to create socket");
 
-    /* set nodelay option */
-    ret = setsockopt(socket, IPPROTO_TCP, TCP_NODELAY,
-                     reinterpret_cast<const char*>(&onoff), sizeof(onoff));
-    SOCKET_IF_CHECK_CLOSE(SOCKET_ERROR != ret, "Failed to setsockopt", socket);
-
-    /* set packet buffer size */
-    int buf_size = STDSC_TCP_BUFFER_SIZE;
-
-    ret =
-      setsockopt(socket, SOL_SOCKET, SO_RCVBUF,
-                 reinterpret_cast<const char*>(&buf_size), sizeof(buf_size));
-    SOCKET_IF_CHECK_CLOSE(SOCKET_ERROR != ret, "Failed to setsockopt", socket);
-
-    ret =
-      setsockopt(socket, SOL_SOCKET, SO_SNDBUF,
-                 reinterpret_cast<const char*>(&buf_size), sizeof(buf_size));
-    SOCKET_IF_CHECK_CLOSE(SOCKET_ERROR != ret, "Failed to setsockopt", socket);
-
-    /* set keepalive values */
-    ret = setsockopt(socket, SOL_SOCKET, SO_KEEPALIVE,
-                     reinterpret_cast<const char*>(&onoff), sizeof(onoff));
-    SOCKET_IF_CHECK_CLOSE(SOCKET_ERROR != ret, "Failed to setsockopt", socket);
-
-    ret = setsockopt(socket, IPPROTO_TCP, TCP_KEEPIDLE,
-                     reinterpret_cast<const char*>(&keepalivedelay_sec),
-                     sizeof(keepalivedelay_sec));
-    SOCKET_IF_CHECK_CLOSE(SOCKET_ERROR != ret, "Failed to setsockopt", socket);
-
-    ret = setsockopt(socket, IPPROTO_TCP, TCP_KEEPINTVL,
-                     reinterpret_cast<const char*>(&keepaliveinterval_sec),
-                     sizeof(keepaliveinterval_sec));
-    SOCKET_IF_CHECK_CLOSE(SOCKET_ERROR != ret, "Failed to setsockopt", socket);
-    ret = setsockopt(socket, IPPROTO_TCP, TCP_KEEPCNT,
-                     reinterpret_cast<const char*>(&keepalivecount),
-                     sizeof(keepalivecount));
-    SOCKET_IF_CHECK_CLOSE(SOCKET_ERROR != ret, "Failed to setsockopt", socket);
+    set_tcp_options(socket);
 
     /* convert hostname to addr */
     addrinfo* info;
@@ -478,11 +1159,69 @@ void Socket::shutdown(void)
 void Socket::close(void)
 {
     close_socket(pimpl_->socket_);
+    if (!pimpl_->unix_path_.empty())
+    {
+        ::unlink(pimpl_->unix_path_.c_str());
+        pimpl_->unix_path_.clear();
+    }
+}
+
+bool Socket::wait_readable(uint32_t timeout_sec) const
+{
+    return wait_read(pimpl_->socket_, timeout_sec);
+}
+
+bool Socket::peer_closed(void) const
+{
+    char c;
+    return 0 == ::recv(pimpl_->socket_, &c, 1, MSG_PEEK | MSG_DONTWAIT);
+}
+
+bool Socket::is_local(void) const
+{
+    return pimpl_->is_local_;
+}
+
+void Socket::set_shared_memory(const bool enable, const std::size_t threshold)
+{
+    pimpl_->shared_->shm = enable && pimpl_->is_local_ && shared_memory_supported();
+    pimpl_->shared_->shm_threshold = threshold;
+}
+
+bool Socket::shared_memory(void) const
+{
+    return pimpl_->shared_->shm;
+}
+
+void Socket::set_framing(const Framing_t framing)
+{
+    pimpl_->shared_->framing = framing;
+}
+
+Framing_t Socket::framing(void) const
+{
+    return pimpl_->shared_->framing;
+}
+
+void Socket::set_compression(const uint32_t codec, const std::size_t threshold)
+{
+    pimpl_->shared_->codec = codec;
+    pimpl_->shared_->threshold = threshold;
+}
+
+uint32_t Socket::compression(void) const
+{
+    return pimpl_->shared_->codec;
 }
 
 void Socket::send_packet(const Packet& packet) const
 {
-    pimpl_->write(reinterpret_cast<const void*>(&packet), sizeof(Packet));
+    pimpl_->send_packet(packet, nullptr, 0);
+}
+
+void Socket::send_packet(const Packet& packet, const Buffer& buffer) const
+{
+    pimpl_->send_packet(packet, buffer.data(), buffer.size());
 }
 
 void Socket::recv_packet(Packet& packet, uint32_t timeout_sec) const
@@ -493,7 +1232,7 @@ void Socket::recv_packet(Packet& packet, uint32_t timeout_sec) const
 
     SOCKET_IF_CHECK(true == wait_result, "Receive timed out");
 
-    pimpl_->read(reinterpret_cast<void*>(&packet), sizeof(Packet));
+    pimpl_->recv_packet(packet);
 }
 
 void Socket::send_buffer(const Buffer& buffer) const
@@ -507,14 +1246,90 @@ void Socket::send_buffer(const Buffer& buffer) const
 
 void Socket::recv_buffer(Buffer& buffer, uint32_t timeout_sec) const
 {
-    if (0 < buffer.size())
+    auto size = buffer.size();
+    if (0 < size && 0 < pimpl_->payload_remain())
+    {
+        auto& shared = *pimpl_->shared_;
+        if (0 == shared.pending_pos && size == shared.pending.size())
+        {
+            buffer = std::move(shared.pending); // take the whole payload
+            shared.pending_pos = 0;
+        }
+        else
+        {
+            char* dst = static_cast<char*>(buffer.data());
+            pimpl_->consume_payload(size, [&](const char* p, std::size_t len) {
+                std::memcpy(dst, p, len);
+                dst += len;
+            });
+        }
+    }
+    else if (0 < size)
     {
         bool wait_result = wait_read(pimpl_->socket_, timeout_sec);
 
         SOCKET_IF_CHECK(true == wait_result, "Receive timed out");
 
-        pimpl_->read(reinterpret_cast<void*>(buffer.data()), buffer.size());
+        pimpl_->read(reinterpret_cast<void*>(buffer.data()), size);
     }
+    pimpl_->shared_->recv_bytes += size;
+}
+
+void Socket::send_file(const std::string& filepath, std::size_t size) const
+{
+    if (0 < size)
+    {
+        ScopedFd fd(::open(filepath.c_str(), O_RDONLY));
+        STDSC_THROW_FILE_IF_CHECK(0 <= fd.fd_,
+                                  "Failed to open. (" + filepath + ")");
+        pimpl_->send_file(fd.fd_, size);
+    }
+}
+
+void Socket::recv_file(const std::string& filepath, std::size_t size,
+                       uint32_t timeout_sec) const
+{
+    ScopedFd fd(::open(filepath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644));
+    STDSC_THROW_FILE_IF_CHECK(0 <= fd.fd_,
+                              "Failed to open. (" + filepath + ")");
+    if (0 < size && 0 < pimpl_->payload_remain())
+    {
+        pimpl_->consume_payload(size, [&](const char* p, std::size_t len) {
+            write_fd(fd.fd_, p, len);
+        });
+    }
+    else if (0 < size)
+    {
+        bool wait_result = wait_read(pimpl_->socket_, timeout_sec);
+
+        SOCKET_IF_CHECK(true == wait_result, "Receive timed out");
+
+        pimpl_->recv_file(fd.fd_, size);
+    }
+    pimpl_->shared_->recv_bytes += size;
+}
+
+void Socket::discard(std::size_t size) const
+{
+    pimpl_->shared_->recv_bytes += size;
+    if (0 < pimpl_->payload_remain())
+    {
+        pimpl_->consume_payload(size, [](const char*, std::size_t) {});
+        return;
+    }
+
+    std::vector<char> chunk(std::min<std::size_t>(size, STDSC_FILE_CHUNK_SIZE));
+    while (0 < size)
+    {
+        auto len = std::min(size, chunk.size());
+        pimpl_->read(chunk.data(), len);
+        size -= len;
+    }
+}
+
+std::size_t Socket::received_bytes(void) const
+{
+    return pimpl_->shared_->recv_bytes;
 }
 
 } /* stdsc */
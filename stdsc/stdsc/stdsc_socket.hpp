@@ -21,8 +21,10 @@
 #include <sys/socket.h>
 
 #include <memory>
+#include <string>
 
 #include <stdsc/stdsc_define.hpp>
+#include <stdsc/stdsc_packet.hpp>
 
 #define STDSC_SO_EXCLUSIVEADDRUSE ((int)(~SO_REUSEADDR))
 #define STDSC_SOMAXCONN 0x7fffffff
@@ -30,7 +32,6 @@
 namespace stdsc
 {
 
-struct Packet;
 class Buffer;
 
 /**
@@ -46,6 +47,9 @@ public:
 
     ~Socket();
 
+    /**
+     * Listen on TCP port, or on unix-domain socket if port is "unix:<path>".
+     */
     static Socket make_listen_socket(const char* port,
                                      int optname = STDSC_SO_EXCLUSIVEADDRUSE,
                                      int backlog = STDSC_SOMAXCONN);
@@ -53,6 +57,10 @@ public:
     static Socket accept_connection(Socket& listen_sock,
                                     uint32_t timeout_sec = STDSC_TIME_INFINITE);
 
+    /**
+     * Connect to host:port, or to unix-domain socket if host or port is
+     * "unix:<path>".
+     */
     static Socket establish_connection(const char* host,
                                        const char* port,
                                        uint32_t timeout_sec =
@@ -60,12 +68,70 @@ public:
     
     int connection_id(void) const;
 
+    /**
+     * Wait until data arrives
+     * @param[in] timeout_sec timeout (sec)
+     * @return false if timed out
+     */
+    bool wait_readable(uint32_t timeout_sec = STDSC_TIME_INFINITE) const;
+
+    /**
+     * Whether the peer closed the connection and no data is left to read
+     */
+    bool peer_closed(void) const;
+
+    /**
+     * Whether this is a unix-domain socket, i.e. the peer is on this host.
+     */
+    bool is_local(void) const;
+
     void shutdown(void);
 
     void close(void);
 
+    /**
+     * Select framing of packets to send. A socket which receives a legacy
+     * packet switches to the legacy framing to answer the peer.
+     * @param[in] framing framing
+     */
+    void set_framing(const Framing_t framing);
+
+    Framing_t framing(void) const;
+
+    /**
+     * Compress payloads sent on this socket. The codec must be negotiated
+     * with the peer (see kControlCodeCompression). Stream payloads are
+     * compressed in frames, which the peer inflates as it reads the stream.
+     * @param[in] codec     codec (Codec_t, kCodecNone to disable)
+     * @param[in] threshold payloads smaller than this are sent raw
+     */
+    void set_compression(const uint32_t codec,
+                         const std::size_t threshold = STDSC_COMPRESSION_THRESHOLD);
+
+    uint32_t compression(void) const;
+
+    /**
+     * Pass payloads of at least `threshold` bytes in a sealed memfd whose
+     * descriptor is sent over the socket; the receiver maps it instead of
+     * copying. Only for local sockets and must be negotiated with the peer
+     * (see kControlCodeSharedMemory).
+     * @param[in] enable    enable or disable
+     * @param[in] threshold min size of payload passed by memfd
+     */
+    void set_shared_memory(const bool enable,
+                           const std::size_t threshold = STDSC_SHM_THRESHOLD);
+
+    bool shared_memory(void) const;
+
     void send_packet(const Packet& packet) const;
 
+    /**
+     * Send packet and its payload in one syscall.
+     * @param[in] packet packet
+     * @param[in] buffer payload
+     */
+    void send_packet(const Packet& packet, const Buffer& buffer) const;
+
     void recv_packet(Packet& packet,
                      uint32_t timeout_sec = STDSC_TIME_INFINITE) const;
 
@@ -74,7 +140,39 @@ public:
     void recv_buffer(Buffer& buffer,
                      uint32_t timeout_sec = STDSC_TIME_INFINITE) const;
 
+    /**
+     * Send the first `size` bytes of file without copying into user space.
+     * @param[in] filepath file path
+     * @param[in] size     bytes to send
+     */
+    void send_file(const std::string& filepath, std::size_t size) const;
+
+    /**
+     * Receive `size` bytes and write them straight into file.
+     * @param[in] filepath    destination file path (truncated)
+     * @param[in] size        bytes to receive
+     * @param[in] timeout_sec timeout
+     */
+    void recv_file(const std::string& filepath, std::size_t size,
+                   uint32_t timeout_sec = STDSC_TIME_INFINITE) const;
+
+    /**
+     * Receive and drop `size` bytes.
+     * @param[in] size bytes to drop
+     */
+    void discard(std::size_t size) const;
+
+    /**
+     * Total payload bytes received on this socket so far
+     * (packet headers excluded, compressed payloads counted inflated).
+     */
+    std::size_t received_bytes(void) const;
+
 private:
+    static Socket make_local_listen_socket(const std::string& path,
+                                           int backlog);
+    static Socket establish_local_connection(const std::string& path);
+
     struct Impl;
     std::shared_ptr<Impl> pimpl_;
 };
@@ -0,0 +1,83 @@
+/*
+ * Copyright 2018 Yamana Laboratory, Waseda University
+ * Supported by JST CREST Grant Number JPMJCR1503, Japan.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE‐2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+#include <vector>
+#include <stdsc/stdsc_socket_stream.hpp>
+#include <stdsc/stdsc_socket.hpp>
+#include <stdsc/stdsc_buffer.hpp>
+#include <stdsc/stdsc_log.hpp>
+
+namespace stdsc
+{
+
+struct SocketStreamBuf::Impl
+{
+    Impl(const Socket& sock, std::size_t size, std::size_t window)
+        : sock_(sock), remain_(size), window_(std::min(size, window))
+    {
+    }
+
+    /* receive next window, returns received bytes */
+    std::size_t fill(void)
+    {
+        auto len = std::min(remain_, window_.size());
+        if (len < window_.size())
+        {
+            window_.resize(len); // last window
+        }
+        sock_.recv_buffer(window_);
+        remain_ -= len;
+        STDSC_LOG_TRACE("received window. (sz:%lu, remain:%lu)", len, remain_);
+        return len;
+    }
+
+    const Socket& sock_;
+    std::size_t remain_;
+    Buffer window_;
+};
+
+SocketStreamBuf::SocketStreamBuf(const Socket& sock, std::size_t size,
+                                 std::size_t window)
+    : pimpl_(new Impl(sock, size, window))
+{
+    setg(nullptr, nullptr, nullptr);
+}
+
+std::size_t SocketStreamBuf::remain(void) const
+{
+    return pimpl_->remain_;
+}
+
+SocketStreamBuf::int_type SocketStreamBuf::underflow(void)
+{
+    if (gptr() < egptr())
+    {
+        return traits_type::to_int_type(*gptr());
+    }
+    if (0 == pimpl_->remain_)
+    {
+        return traits_type::eof();
+    }
+
+    auto len = pimpl_->fill();
+    char* p = reinterpret_cast<char*>(pimpl_->window_.data());
+    setg(p, p, p + len);
+    return traits_type::to_int_type(*gptr());
+}
+
+} /* namespace stdsc */
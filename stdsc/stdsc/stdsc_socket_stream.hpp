@@ -0,0 +1,65 @@
+/*
+ * Copyright 2018 Yamana Laboratory, Waseda University
+ * Supported by JST CREST Grant Number JPMJCR1503, Japan.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE‐2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef STDSC_SOCKET_STREAM_HPP
+#define STDSC_SOCKET_STREAM_HPP
+
+#include <iostream>
+#include <memory>
+#include <stdsc/stdsc_define.hpp>
+
+namespace stdsc
+{
+
+class Socket;
+
+/**
+ * @brief Provides a streambuf interface to read data still on a socket.
+ * At most `window` bytes are held in memory, so the reader can decode
+ * the data while the rest is still on the wire.
+ */
+class SocketStreamBuf : public std::streambuf
+{
+public:
+    /**
+     * @param[in] sock   socket
+     * @param[in] size   bytes available on the socket for this stream
+     * @param[in] window max bytes to buffer
+     */
+    SocketStreamBuf(const Socket& sock, std::size_t size,
+                    std::size_t window = STDSC_STREAM_WINDOW_SIZE);
+    virtual ~SocketStreamBuf(void) = default;
+
+    SocketStreamBuf(const SocketStreamBuf&) = delete;
+    SocketStreamBuf& operator=(const SocketStreamBuf&) = delete;
+
+    /**
+     * Bytes not yet received from the socket.
+     */
+    std::size_t remain(void) const;
+
+protected:
+    int_type underflow(void) override;
+
+private:
+    struct Impl;
+    std::shared_ptr<Impl> pimpl_;
+};
+
+} /* namespace stdsc */
+
+#endif /* STDSC_SOCKET_STREAM_HPP */